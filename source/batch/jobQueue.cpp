@@ -0,0 +1,67 @@
+#include "jobQueue.h"
+
+void JobQueue::init(uint32 numWorkers, uint32 numJobs)
+{
+    this->numWorkers = numWorkers;
+    workers = new WorkerJobs[numWorkers];
+
+    for (uint32 job = 0; job < numJobs; ++job)
+    {
+        workers[job % numWorkers].jobs.push_back(job);
+    }
+}
+
+void JobQueue::shutdown()
+{
+    delete[] workers;
+    workers = 0;
+    numWorkers = 0;
+}
+
+bool JobQueue::pop(uint32 worker, uint32* job, bool* wasStolen)
+{
+    *wasStolen = false;
+    if (popBack(workers + worker, job))
+    {
+        return true;
+    }
+
+    // Start with the next worker over so thieves spread out instead of all hitting worker 0
+    for (uint32 i = 1; i < numWorkers; ++i)
+    {
+        if (popFront(workers + ((worker + i) % numWorkers), job))
+        {
+            *wasStolen = true;
+            return true;
+        }
+    }
+
+    // Jobs are never added once running, so if every queue was empty we're done
+    return false;
+}
+
+bool JobQueue::popBack(WorkerJobs* worker, uint32* job)
+{
+    std::lock_guard<std::mutex> guard(worker->lock);
+    if (worker->jobs.empty())
+    {
+        return false;
+    }
+
+    *job = worker->jobs.back();
+    worker->jobs.pop_back();
+    return true;
+}
+
+bool JobQueue::popFront(WorkerJobs* worker, uint32* job)
+{
+    std::lock_guard<std::mutex> guard(worker->lock);
+    if (worker->jobs.empty())
+    {
+        return false;
+    }
+
+    *job = worker->jobs.front();
+    worker->jobs.pop_front();
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "platform.h"
+
+#include <mutex>
+#include <deque>
+
+// Hands out job indices to a fixed set of worker threads.
+// Jobs get dealt out round robin up front, then each worker takes from the back of its own deque and
+// when that runs dry it steals from the front of someone else's. Rom runs vary a lot in length, so
+// this keeps a worker that drew a few long ones from holding up work the others could be doing.
+class JobQueue
+{
+public:
+    void init(uint32 numWorkers, uint32 numJobs);
+    void shutdown();
+
+    // Gets the next job for the worker, false once there's nothing left anywhere
+    bool pop(uint32 worker, uint32* job, bool* wasStolen);
+
+private:
+    struct WorkerJobs
+    {
+        std::mutex lock;
+        std::deque<uint32> jobs;
+    };
+
+    WorkerJobs* workers;
+    uint32 numWorkers;
+
+    bool popBack(WorkerJobs* worker, uint32* job);
+    bool popFront(WorkerJobs* worker, uint32* job);
+};
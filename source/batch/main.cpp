@@ -0,0 +1,386 @@
+// Runs a list of rom jobs spread over every core and reports the combined throughput
+// Meant for regression runs over lots of roms and input scripts, ex: romulus-batch jobs.txt
+//
+// Each line of the job list is: <rom> [frames] [input script]. Blank lines and lines starting with # are skipped.
+// Input scripts have a line for each change: <frame> <pad 1> [pad 2], where a pad is 8 characters in RLDUTSBA
+// order (right, left, down, up, start, select, b, a) with '.' for released, ex: "120 ....T...".
+// Buttons stay held until a later line changes them.
+//
+// --audio <dir> records each job's audio to <dir>/<job number>.wav, numbered from 0 in list order.
+// --video <dir> does the same for the frames, as <dir>/<job number>.rmv (see romulus-videodecode).
+// --cpu instructions steps the cpu a whole instruction at a time for quicker smoke tests (see NES::setCPUMode),
+// --cpu cycles runs nsfs a cycle at a time too.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "nes/nes.h"
+#include "jobQueue.h"
+
+const real32 SECONDS_PER_FRAME = 1.0f / 60.0f;
+const uint32 DEFAULT_FRAMES = 3600;
+const uint32 MAX_PATH_LENGTH = 512;
+
+struct Job
+{
+    char romPath[MAX_PATH_LENGTH];
+    char scriptPath[MAX_PATH_LENGTH];
+    uint32 frames;
+
+    // Filled in by whichever worker ran it
+    uint32 worker;
+    uint32 framesRun;
+    real64 seconds;
+    uint64 stateHash;
+    bool wasLoaded;
+    bool wasStolen;
+};
+
+struct InputEvent
+{
+    uint32 frame;
+    uint8 pads[2];
+    bool hasSecondPad;
+};
+
+struct Worker
+{
+    uint32 index;
+    uint32 jobsRun;
+    uint32 jobsStolen;
+    real64 busySeconds;
+};
+
+static real64 getSeconds()
+{
+    using namespace std::chrono;
+    return duration<real64>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool loadJobs(const char* path, std::vector<Job>* jobs)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        printf("Failed to open job list %s\n", path);
+        return false;
+    }
+
+    char line[MAX_PATH_LENGTH * 2 + 32];
+    while (fgets(line, sizeof(line), file))
+    {
+        Job job = {};
+        job.frames = DEFAULT_FRAMES;
+
+        int fields = sscanf(line, "%511s %u %511s", job.romPath, &job.frames, job.scriptPath);
+        if (fields <= 0 || job.romPath[0] == '#')
+        {
+            continue;
+        }
+
+        jobs->push_back(job);
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Pads are in RLDUTSBA order, the controller has A in the lowest bit
+static uint8 parsePad(const char* pad)
+{
+    uint8 state = 0;
+    for (int i = 0; i < 8 && pad[i]; ++i)
+    {
+        if (pad[i] != '.')
+        {
+            state |= 0x80 >> i;
+        }
+    }
+
+    return state;
+}
+
+static bool loadInputScript(const char* path, std::vector<InputEvent>* events)
+{
+    events->clear();
+
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        logError("Failed to open input script %s\n", path);
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), file))
+    {
+        InputEvent event = {};
+        char pad1[16] = {};
+        char pad2[16] = {};
+
+        int fields = sscanf(line, "%u %15s %15s", &event.frame, pad1, pad2);
+        if (fields < 2)
+        {
+            continue;
+        }
+
+        event.pads[0] = parsePad(pad1);
+        event.pads[1] = parsePad(pad2);
+        event.hasSecondPad = fields > 2;
+        events->push_back(event);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static void applyInput(NES* nes, const InputEvent& event)
+{
+    nes->inputBus.controllers[0].currentState = event.pads[0];
+
+    // Port 2 has the zapper by default, scripts that drive it get a controller plugged in instead
+    if (event.hasSecondPad)
+    {
+        nes->inputBus.ports[1].device = STANDARD_CONTROLLER;
+        nes->inputBus.ports[1].index = 1;
+        nes->inputBus.controllers[1].currentState = event.pads[1];
+    }
+}
+
+static void runJob(NES* nes, Job* job, uint32 jobIndex, const char* audioDir, const char* videoDir, std::vector<InputEvent>* events)
+{
+    // The last job's script may have plugged a controller into port 2 and left buttons held
+    nes->inputBus.init(&nes->ppu);
+    nes->inputBus.clearState();
+
+    events->clear();
+    if (job->scriptPath[0] && !loadInputScript(job->scriptPath, events))
+    {
+        return;
+    }
+
+    if (!nes->loadRom(job->romPath))
+    {
+        return;
+    }
+
+    job->wasLoaded = true;
+
+    // Numbered by the job's line in the list, so the same job always lands in the same file
+    int32 audioCapture = -1;
+    if (audioDir)
+    {
+        char audioPath[MAX_PATH_LENGTH + 32];
+        snprintf(audioPath, sizeof(audioPath), "%s/%04u.wav", audioDir, jobIndex);
+        audioCapture = nes->startAudioCapture(audioPath, CAPTURE_WAV);
+    }
+
+    if (videoDir)
+    {
+        char videoPath[MAX_PATH_LENGTH + 32];
+        snprintf(videoPath, sizeof(videoPath), "%s/%04u.rmv", videoDir, jobIndex);
+        nes->startVideoCapture(videoPath);
+    }
+
+    real64 start = getSeconds();
+
+    uint32 nextEvent = 0;
+    uint32 frame = 0;
+    while (frame < job->frames && nes->isRunning)
+    {
+        while (nextEvent < events->size() && (*events)[nextEvent].frame <= frame)
+        {
+            applyInput(nes, (*events)[nextEvent]);
+            ++nextEvent;
+        }
+
+        nes->update(SECONDS_PER_FRAME);
+        ++frame;
+    }
+
+    job->seconds = getSeconds() - start;
+    job->framesRun = frame;
+    job->stateHash = nes->getStateHash();
+
+    nes->stopAudioCapture(audioCapture);
+    nes->stopVideoCapture();
+    nes->unloadRom();
+}
+
+static void runWorker(Worker* worker, JobQueue* queue, RomStore* roms, const char* audioDir, const char* videoDir,
+    CPUMode cpuMode, std::vector<Job>* jobs)
+{
+    // Too big for the stack, and reused for every job this worker runs. Loading a rom powers it on from scratch,
+    // so the results don't depend on which jobs the worker ran before
+    NES* nes = new NES();
+
+    // Other workers could be running the same rom
+    nes->cartridge.setSaveFileDisabled(true);
+    nes->cartridge.setRomStore(roms);
+    nes->setCPUMode(cpuMode);
+    std::vector<InputEvent> events;
+
+    uint32 jobIndex;
+    bool wasStolen;
+    while (queue->pop(worker->index, &jobIndex, &wasStolen))
+    {
+        Job* job = &(*jobs)[jobIndex];
+        job->worker = worker->index;
+        job->wasStolen = wasStolen;
+
+        real64 start = getSeconds();
+        runJob(nes, job, jobIndex, audioDir, videoDir, &events);
+        worker->busySeconds += getSeconds() - start;
+
+        ++worker->jobsRun;
+        if (wasStolen)
+        {
+            ++worker->jobsStolen;
+        }
+    }
+
+    nes->shutdown();
+    delete nes;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: romulus-batch <job list> [threads] [--audio <dir>] [--video <dir>] [--cpu <cycles|instructions>]\n");
+        return 1;
+    }
+
+    uint32 numThreads = std::thread::hardware_concurrency();
+    const char* audioDir = 0;
+    const char* videoDir = 0;
+    CPUMode cpuMode = CPU_MODE_AUTO;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--audio") == 0 && i + 1 < argc)
+        {
+            audioDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--video") == 0 && i + 1 < argc)
+        {
+            videoDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc)
+        {
+            ++i;
+            cpuMode = CPU_MODE_CYCLES;
+            if (strcmp(argv[i], "instructions") == 0)
+            {
+                cpuMode = CPU_MODE_INSTRUCTIONS;
+            }
+        }
+        else
+        {
+            numThreads = atoi(argv[i]);
+        }
+    }
+
+    std::vector<Job> jobs;
+    if (!loadJobs(argv[1], &jobs))
+    {
+        return 1;
+    }
+
+    if (jobs.empty())
+    {
+        printf("No jobs in %s\n", argv[1]);
+        return 1;
+    }
+
+    if (numThreads == 0)
+    {
+        numThreads = 1;
+    }
+
+    if (numThreads > jobs.size())
+    {
+        numThreads = (uint32)jobs.size();
+    }
+
+    // Every job holds a reference to its rom for the whole run, so each file is mapped and checked once up front
+    // and every console running it shares the one copy
+    RomStore roms;
+    std::vector<const RomImage*> romImages;
+    for (const Job& job : jobs)
+    {
+        romImages.push_back(roms.acquire(job.romPath));
+    }
+
+    JobQueue queue = {};
+    queue.init(numThreads, (uint32)jobs.size());
+
+    std::vector<Worker> workers(numThreads);
+    std::vector<std::thread> threads;
+
+    real64 start = getSeconds();
+
+    for (uint32 i = 0; i < numThreads; ++i)
+    {
+        workers[i] = {};
+        workers[i].index = i;
+        threads.emplace_back(runWorker, &workers[i], &queue, &roms, audioDir, videoDir, cpuMode, &jobs);
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    real64 elapsed = getSeconds() - start;
+    queue.shutdown();
+
+    uint32 uniqueRoms = roms.getImageCount();
+    for (const RomImage* image : romImages)
+    {
+        roms.release(image);
+    }
+
+    // Results come out in job list order no matter how the work was split up
+    uint64 totalFrames = 0;
+    uint32 failedJobs = 0;
+    for (const Job& job : jobs)
+    {
+        if (!job.wasLoaded)
+        {
+            printf("FAILED  %s\n", job.romPath);
+            ++failedJobs;
+            continue;
+        }
+
+        const char* status = job.framesRun < job.frames ? "STOPPED" : "OK     ";
+        printf("%s %s%s%s: %u frames, %.1f frames/sec, state hash %016llX\n", status, job.romPath,
+            job.scriptPath[0] ? " + " : "", job.scriptPath, job.framesRun, job.framesRun / job.seconds,
+            (unsigned long long)job.stateHash);
+
+        totalFrames += job.framesRun;
+    }
+
+    printf("\n");
+    for (const Worker& worker : workers)
+    {
+        printf("worker %2u: %u jobs (%u stolen), busy %.1f%%\n",
+            worker.index, worker.jobsRun, worker.jobsStolen, 100.0 * worker.busySeconds / elapsed);
+    }
+
+    printf("\n%u jobs (%u failed, %u unique roms) on %u threads in %.3fs\n", (uint32)jobs.size(), failedJobs, uniqueRoms, numThreads, elapsed);
+    printf("%12.2f frames/sec total\n", totalFrames / elapsed);
+    // More threads than cores just time slice, so don't count them as extra cores
+    uint32 numCores = std::thread::hardware_concurrency();
+    if (numCores == 0 || numCores > numThreads)
+    {
+        numCores = numThreads;
+    }
+
+    printf("%12.2f frames/sec per core (%u cores)\n", totalFrames / elapsed / numCores, numCores);
+
+    return failedJobs > 0 ? 1 : 0;
+}
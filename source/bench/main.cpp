@@ -0,0 +1,214 @@
+// Command line benchmarks for the emulator core
+// Run from the repo root so the default test roms can be found, ex: romulus-bench test/nestest/nestest.nes
+//
+// romulus-bench --mix [rom] [frames] runs a whole console instead (all_instrs by default, which goes through every
+// opcode) and reports the throughput along with which opcodes and sequences it spent its time on.
+// Test roms that report through $6000 (blargg's) stop as soon as they're done, so the mix isn't swamped by the idle loop after
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+#include "nes/nes.h"
+
+// Number of instructions in the automated (0xC000) run of nestest before it returns
+const uint32 NESTEST_INSTRUCTIONS = 8991;
+
+const real32 SECONDS_PER_FRAME = 1.0f / 60.0f;
+
+static const char* sequenceNames[] =
+{
+    "interrupt",
+    "rti",
+    "rts",
+    "push",
+    "pull",
+    "jsr",
+    "two cycle",
+    "absolute",
+    "zeropage",
+    "zeropage indexed",
+    "absolute indexed",
+    "relative",
+    "indirect x",
+    "indirect y",
+    "indirect",
+};
+
+// Too big for the stack
+static NES nes;
+
+static real64 getSeconds()
+{
+    using namespace std::chrono;
+    return duration<real64>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs the cpu only portion of nestest the given number of times, returns the number of instructions executed
+// Either a cycle at a time or a whole instruction at a time (MOS6502::step)
+template <class Bus>
+static uint64 runNestest(MOS6502<Bus>* cpu, uint32 passes, bool stepInstructions)
+{
+    uint64 instructions = 0;
+    for (uint32 pass = 0; pass < passes; ++pass)
+    {
+        cpu->start();
+        while (cpu->isExecuting())
+        {
+            cpu->tick();
+        }
+
+        // Same starting state as the nestest log
+        cpu->pc = 0xC000;
+        cpu->stack = 0xFD;
+        cpu->status = 0x24;
+
+        for (uint32 i = 0; i < NESTEST_INSTRUCTIONS && !cpu->hasHalted(); ++i)
+        {
+            if (stepInstructions)
+            {
+                cpu->step();
+            }
+            else
+            {
+                do
+                {
+                    cpu->tick();
+                } while (cpu->isExecuting());
+            }
+
+            ++instructions;
+        }
+    }
+
+    return instructions;
+}
+
+template <class Bus>
+static real64 benchmarkCpu(const char* name, Bus* bus, uint32 passes, bool stepInstructions)
+{
+    MOS6502<Bus> cpu = {};
+    cpu.connect(bus);
+
+    // Warm up the caches before timing
+    runNestest(&cpu, 1, stepInstructions);
+
+    real64 start = getSeconds();
+    uint64 instructions = runNestest(&cpu, passes, stepInstructions);
+    real64 elapsed = getSeconds() - start;
+
+    real64 instructionsPerSecond = instructions / elapsed;
+    printf("%-24s %10llu instructions in %.3fs = %.2f M instructions/sec\n",
+        name, instructions, elapsed, instructionsPerSecond / 1000000.0);
+
+    return instructionsPerSecond;
+}
+
+// blargg's test roms write DE B0 61 to $6001 once $6000 holds their status, which is under $80 when they've finished
+static bool hasTestFinished()
+{
+    nes.cpuBus.setReadOnly(true);
+    bool hasFinished = nes.cpuBus.read(0x6001) == 0xDE && nes.cpuBus.read(0x6002) == 0xB0 && nes.cpuBus.read(0x6003) == 0x61
+        && nes.cpuBus.read(0x6000) < 0x80;
+    nes.cpuBus.setReadOnly(false);
+
+    return hasFinished;
+}
+
+static int benchmarkOpcodeMix(const char* romPath, uint32 frames)
+{
+    if (!nes.loadRom(romPath))
+    {
+        printf("Failed to load %s\n", romPath);
+        return 1;
+    }
+
+    uint64 startInstructions = nes.cpu.instructionCount;
+    real64 start = getSeconds();
+
+    uint32 frame = 0;
+    while (frame < frames && nes.isRunning && !hasTestFinished())
+    {
+        nes.update(SECONDS_PER_FRAME);
+        ++frame;
+    }
+
+    real64 elapsed = getSeconds() - start;
+    uint64 instructions = nes.cpu.instructionCount - startInstructions;
+
+    printf("%s: %u frames in %.3fs, %llu instructions = %.2f M instructions/sec\n\n", romPath, frame, elapsed,
+        instructions, instructions / elapsed / 1000000.0);
+
+    uint64 sequenceCounts[NUM_MICROCODE_SEQUENCES] = {};
+    uint32 opcodesUsed = 0;
+    uint32 order[256];
+    for (uint32 i = 0; i < 256; ++i)
+    {
+        order[i] = i;
+        if (nes.cpu.opcodeCounts[i] > 0)
+        {
+            ++opcodesUsed;
+        }
+
+        MicrocodeSequence sequence = getOpcodeSequence((uint8)i);
+        if (sequence < NUM_MICROCODE_SEQUENCES)
+        {
+            sequenceCounts[sequence] += nes.cpu.opcodeCounts[i];
+        }
+    }
+
+    std::sort(order, order + 256, [](uint32 a, uint32 b) { return nes.cpu.opcodeCounts[a] > nes.cpu.opcodeCounts[b]; });
+
+    // Counts cover the reset too, so they can be a few off from the instructions timed
+    uint64 total = nes.cpu.instructionCount;
+    printf("%u of 256 opcodes used, top 20:\n", opcodesUsed);
+    for (uint32 i = 0; i < 20 && nes.cpu.opcodeCounts[order[i]] > 0; ++i)
+    {
+        const Operation& operation = operations[order[i]];
+        printf("  %02X %s %-12s %12llu %6.2f%%\n", order[i], opCodeNames[operation.opCode],
+            addressModeNames[operation.addressMode], nes.cpu.opcodeCounts[order[i]],
+            100.0 * nes.cpu.opcodeCounts[order[i]] / total);
+    }
+
+    printf("\nBy sequence:\n");
+    for (uint32 i = 0; i < NUM_MICROCODE_SEQUENCES; ++i)
+    {
+        printf("  %-18s %12llu %6.2f%%\n", sequenceNames[i], sequenceCounts[i], 100.0 * sequenceCounts[i] / total);
+    }
+
+    nes.unloadRom();
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--mix") == 0)
+    {
+        const char* romPath = argc > 2 ? argv[2] : "test/instr_test-v5/all_instrs.nes";
+        uint32 frames = argc > 3 ? atoi(argv[3]) : 3600;
+        return benchmarkOpcodeMix(romPath, frames);
+    }
+
+    const char* romPath = argc > 1 ? argv[1] : "test/nestest/nestest.nes";
+    uint32 passes = argc > 2 ? atoi(argv[2]) : 2000;
+
+    if (!nes.loadRom(romPath))
+    {
+        printf("Failed to load %s\n", romPath);
+        return 1;
+    }
+
+    // Virtual dispatch through IBus is what the cpu used before it was templated on the bus
+    real64 generic = benchmarkCpu<IBus>("MOS6502<IBus>", &nes.cpuBus, passes, false);
+    real64 direct = benchmarkCpu<CPUBus>("MOS6502<CPUBus>", &nes.cpuBus, passes, false);
+    printf("Speedup: %.2fx\n", direct / generic);
+
+    // The instruction stepping mode nsfs use, on the same bus
+    real64 stepped = benchmarkCpu<CPUBus>("MOS6502<CPUBus> step", &nes.cpuBus, passes, true);
+    printf("Stepping instructions: %.2fx\n", stepped / direct);
+
+    nes.unloadRom();
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Runs a rom with no window, audio or input and reports how fast the core is going (audio and video can be captured to files)
+// Input can come from a movie instead, played back as fast as the core can go and checked frame by frame against the recording
+// Meant for soak testing and measuring throughput on machines without a display, ex: romulus-headless test/nestest/nestest.nes 3600
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "nes/nes.h"
+
+// NTSC runs at 60.0988 frames per second, but the emulator is fed whole display frames the same as the win32 layer
+const real32 SECONDS_PER_FRAME = 1.0f / 60.0f;
+
+// Too big for the stack
+static NES nes;
+static uint32 screenPixels[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT];
+
+static real64 getSeconds()
+{
+    using namespace std::chrono;
+    return duration<real64>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: romulus-headless <rom> [frames] [--dots] [--wav <file>] [--video <file>] [--record <movie>] [--play <movie>] [--hashes <file>] [--cpu <cycles|instructions>] [--no-idle-skip] [--trace <file>] [--pc <address>]\n");
+        return 1;
+    }
+
+    const char* romPath = argv[1];
+    uint32 frames = argc > 2 ? atoi(argv[2]) : 3600;
+    const char* wavPath = 0;
+    const char* videoPath = 0;
+    const char* recordPath = 0;
+    const char* playPath = 0;
+    const char* hashPath = 0;
+    const char* tracePath = 0;
+    int32 startAddress = -1;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        // Runs every ppu dot through the per dot path, to compare against the scanline renderer
+        if (strcmp(argv[i], "--dots") == 0)
+        {
+            nes.scheduler.setScanlineRendering(false);
+        }
+        // Runs every pass of the games' idle loops, to compare against skipping them
+        else if (strcmp(argv[i], "--no-idle-skip") == 0)
+        {
+            nes.setIdleLoopSkipping(false);
+        }
+        else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc)
+        {
+            wavPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--video") == 0 && i + 1 < argc)
+        {
+            videoPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        // Runs for as long as the movie instead of the frame count
+        else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc)
+        {
+            playPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--hashes") == 0 && i + 1 < argc)
+        {
+            hashPath = argv[++i];
+        }
+        // Every instruction from the reset on, see romulus-tracedecode for reading it
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        // Starts running from an address (in hex) instead of the reset vector, ex: --pc C000 for nestest's automated mode
+        else if (strcmp(argv[i], "--pc") == 0 && i + 1 < argc)
+        {
+            startAddress = (int32)(strtoul(argv[++i], 0, 16) & 0xFFFF);
+        }
+        // Overrides the default of stepping whole instructions for nsfs and single cycles for everything else
+        else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc)
+        {
+            ++i;
+            CPUMode mode = CPU_MODE_CYCLES;
+            if (strcmp(argv[i], "instructions") == 0)
+            {
+                mode = CPU_MODE_INSTRUCTIONS;
+            }
+
+            nes.setCPUMode(mode);
+        }
+    }
+
+    if (!nes.loadRom(romPath))
+    {
+        printf("Failed to load %s\n", romPath);
+        return 1;
+    }
+
+    if (startAddress >= 0)
+    {
+        nes.runFrom((uint16)startAddress);
+    }
+
+    // Anything that fails from here on has to close what was already started, so captures are left finished
+    int32 audioCapture = -1;
+    if (wavPath)
+    {
+        audioCapture = nes.startAudioCapture(wavPath, CAPTURE_WAV);
+        if (audioCapture < 0)
+        {
+            printf("Failed to start capturing audio to %s\n", wavPath);
+            nes.shutdown();
+            return 1;
+        }
+    }
+
+    if (videoPath && !nes.startVideoCapture(videoPath))
+    {
+        printf("Failed to start capturing video to %s\n", videoPath);
+        nes.shutdown();
+        return 1;
+    }
+
+    if (hashPath && !nes.startStateHashLog(hashPath))
+    {
+        printf("Failed to start logging state hashes to %s\n", hashPath);
+        nes.shutdown();
+        return 1;
+    }
+
+    if (tracePath && !nes.startTrace(tracePath))
+    {
+        printf("Failed to start tracing the cpu to %s\n", tracePath);
+        nes.shutdown();
+        return 1;
+    }
+
+    if (recordPath && !nes.startMovieRecording(recordPath))
+    {
+        printf("Failed to start recording %s\n", recordPath);
+        nes.shutdown();
+        return 1;
+    }
+
+    if (playPath)
+    {
+        if (!nes.startMoviePlayback(playPath))
+        {
+            printf("Failed to play %s\n", playPath);
+            nes.shutdown();
+            return 1;
+        }
+
+        frames = nes.getMovieLength();
+    }
+
+    ScreenBuffer screen = {};
+    screen.width = NES_SCREEN_WIDTH;
+    screen.height = NES_SCREEN_HEIGHT;
+    screen.pitch = NES_SCREEN_WIDTH * sizeof(uint32);
+    screen.memory = screenPixels;
+
+    uint64 startInstructions = nes.cpu.instructionCount;
+    uint64 startDots = nes.scheduler.getPPUDotsRun();
+    uint64 startCpuCycles = nes.getCpuCyclesRun();
+    uint64 startIdleCycles = nes.getIdleCyclesSkipped();
+
+    real64 start = getSeconds();
+
+    uint32 frame = 0;
+    while (frame < frames && nes.isRunning)
+    {
+        nes.update(SECONDS_PER_FRAME);
+        nes.render(screen);
+        ++frame;
+    }
+
+    real64 elapsed = getSeconds() - start;
+
+    uint64 instructions = nes.cpu.instructionCount - startInstructions;
+    uint64 dots = nes.scheduler.getPPUDotsRun() - startDots;
+    uint64 cpuCycles = nes.getCpuCyclesRun() - startCpuCycles;
+    uint64 idleCycles = nes.getIdleCyclesSkipped() - startIdleCycles;
+
+    if (frame < frames)
+    {
+        printf("Emulation stopped after %u of %u frames\n", frame, frames);
+    }
+
+    printf("%u frames in %.3fs\n", frame, elapsed);
+    printf("%12.2f frames/sec (%.1fx realtime)\n", frame / elapsed, (frame / elapsed) * SECONDS_PER_FRAME);
+    printf("%12.2f M instructions/sec\n", instructions / elapsed / 1000000.0);
+    printf("%12.2f M ppu dots/sec\n", dots / elapsed / 1000000.0);
+    printf("%12.2f%% of cpu cycles skipped in idle loops\n", cpuCycles > 0 ? 100.0 * idleCycles / cpuCycles : 0.0);
+
+    int result = 0;
+    if (playPath)
+    {
+        int32 desyncFrame = nes.getMovieDesyncFrame();
+        if (desyncFrame >= 0)
+        {
+            printf("Movie desynced at frame %d\n", desyncFrame);
+            result = 1;
+        }
+        else
+        {
+            printf("Movie matched the recording on all %u frames\n", frame);
+        }
+    }
+
+    nes.stopMovie();
+    nes.stopStateHashLog();
+    nes.stopAudioCapture(audioCapture);
+    nes.stopVideoCapture();
+    nes.stopTrace();
+    nes.unloadRom();
+    return result;
+}
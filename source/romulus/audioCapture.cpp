@@ -0,0 +1,169 @@
+#include "audioCapture.h"
+
+#include <string.h>
+#include <errno.h>
+
+bool AudioCapture::open(const char* path, AudioCaptureFormat format, uint32 sampleRate)
+{
+    if (isOpen())
+    {
+        logError("Audio capture is already open, close it before starting %s\n", path);
+        return false;
+    }
+
+    // The file gets opened here rather than on the writer so a bad path is reported right away
+    this->format = format;
+    if (format == CAPTURE_WAV)
+    {
+        if (!wave.openStream(path, 1, sampleRate))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        rawFile = fopen(path, "wb");
+        if (!rawFile)
+        {
+            logError("Failed to open %s for writing: %s\n", path, strerror(errno));
+            return false;
+        }
+    }
+
+    buffers[0] = new int16[BUFFER_SAMPLES];
+    buffers[1] = new int16[BUFFER_SAMPLES];
+    fillingBuffer = 0;
+    fillCount = 0;
+    droppedSamples = 0;
+
+    writingBuffer = -1;
+    writingCount = 0;
+    isClosing = false;
+    writer = std::thread(&AudioCapture::writerLoop, this);
+
+    return true;
+}
+
+void AudioCapture::write(const int16* samples, uint32 count)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+
+    while (count > 0)
+    {
+        uint32 space = BUFFER_SAMPLES - fillCount;
+        uint32 copyCount = count < space ? count : space;
+
+        memcpy(buffers[fillingBuffer] + fillCount, samples, copyCount * sizeof(int16));
+        fillCount += copyCount;
+        samples += copyCount;
+        count -= copyCount;
+
+        if (fillCount == BUFFER_SAMPLES)
+        {
+            submit();
+        }
+    }
+}
+
+void AudioCapture::submit()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        // Still busy with the other buffer, throw this one away and start filling it again
+        if (writingBuffer >= 0)
+        {
+            droppedSamples += fillCount;
+            fillCount = 0;
+            return;
+        }
+
+        writingBuffer = fillingBuffer;
+        writingCount = fillCount;
+    }
+
+    wake.notify_all();
+
+    fillingBuffer ^= 1;
+    fillCount = 0;
+}
+
+uint32 AudioCapture::close()
+{
+    if (!isOpen())
+    {
+        return 0;
+    }
+
+    // Closing is the one place it's fine to wait, the last partial buffer can't be dropped
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [this] { return writingBuffer < 0; });
+
+        writingBuffer = fillingBuffer;
+        writingCount = fillCount;
+        isClosing = true;
+    }
+
+    wake.notify_all();
+    writer.join();
+
+    if (format == CAPTURE_WAV)
+    {
+        wave.finalizeStream();
+    }
+    else
+    {
+        fclose(rawFile);
+        rawFile = 0;
+    }
+
+    delete[] buffers[0];
+    delete[] buffers[1];
+    buffers[0] = 0;
+    buffers[1] = 0;
+
+    if (droppedSamples > 0)
+    {
+        logWarn("Audio capture fell behind and dropped %u samples\n", droppedSamples);
+    }
+
+    return droppedSamples;
+}
+
+void AudioCapture::writerLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        wake.wait(guard, [this] { return writingBuffer >= 0 || isClosing; });
+
+        if (writingBuffer >= 0)
+        {
+            int16* samples = buffers[writingBuffer];
+            uint32 count = writingCount;
+
+            // The buffer belongs to this thread until writingBuffer is cleared, so the disk write can happen unlocked
+            guard.unlock();
+            if (format == CAPTURE_WAV)
+            {
+                wave.write(samples, count);
+            }
+            else
+            {
+                fwrite(samples, sizeof(int16), count, rawFile);
+            }
+            guard.lock();
+
+            writingBuffer = -1;
+            wake.notify_all();
+        }
+        else
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "romulus.h"
+#include "wavefile.h"
+
+#include <stdio.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+enum AudioCaptureFormat
+{
+    CAPTURE_WAV,
+
+    // Headerless 16 bit mono samples, ex: for diffing between runs
+    CAPTURE_RAW
+};
+
+// Streams audio out to a file without holding up the thread producing it
+// Samples are copied into one of two large buffers, and when it fills up it's handed to a writer thread
+// while the other one fills. If the writer ever falls a whole buffer behind, the new samples are dropped
+// (and counted) rather than waiting on the disk.
+class AudioCapture
+{
+public:
+    // ~1.4 seconds at 48khz
+    static const uint32 BUFFER_SAMPLES = 65536;
+
+    // The writer thread has to be joined before it goes away, even if nothing got around to closing it
+    ~AudioCapture() { close(); }
+
+    bool open(const char* path, AudioCaptureFormat format, uint32 sampleRate);
+    bool isOpen() { return buffers[0] != 0; }
+
+    void write(const int16* samples, uint32 count);
+
+    // Writes out whatever is left and waits for the writer to finish. Returns the number of samples that had to be dropped
+    uint32 close();
+
+private:
+    AudioCaptureFormat format = CAPTURE_WAV;
+    WaveFile wave;
+    FILE* rawFile = 0;
+
+    int16* buffers[2] = {};
+    uint32 fillingBuffer = 0;
+    uint32 fillCount = 0;
+    uint32 droppedSamples = 0;
+
+    // Hand off to the writer, the buffer it's writing stays untouched until it goes back to -1
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread writer;
+    int32 writingBuffer = -1;
+    uint32 writingCount = 0;
+    bool isClosing = false;
+
+    void submit();
+    void writerLoop();
+};
@@ -1,10 +1,16 @@
 #include "log.h"
 
-// TODO: Shift the actual outputting part of this to the platform specific layer
-#include <windows.h>
 #include <stdio.h>
 #include <stdarg.h>
 
+// TODO: Shift the actual outputting part of this to the platform specific layer
+#ifdef _WIN32
+#include <windows.h>
+#define outputLogText(text) OutputDebugStringA(text)
+#else
+#define outputLogText(text) fputs(text, stderr)
+#endif
+
 const char* logLevelNames[] =
 {
     "TRACE",
@@ -42,8 +48,8 @@ void logRaw(LogLevel level, const char* message)
     *cursor = 0;
 
     // TODO: Make this go to different output streams
-    OutputDebugStringA(levelText);
-    OutputDebugStringA(message);
+    outputLogText(levelText);
+    outputLogText(message);
 }
 
 void logl(LogLevel level, const char* message, va_list args)
@@ -53,12 +59,13 @@ void logl(LogLevel level, const char* message, va_list args)
         return;
     }
 
-    static char logLine[MAX_LOG_LINE] = {};
+    // On the stack so threads logging at the same time don't write over each other
+    char logLine[MAX_LOG_LINE];
     char* cursor = formatLevelName(level, logLine);
     int remainingLength = MAX_LOG_LINE - (int)(cursor - logLine);
     int bytesWritten = vsnprintf(cursor, remainingLength, message, args);
     // TODO: Considering validating this printed the full amount and pronting an error
-    OutputDebugStringA(logLine);
+    outputLogText(logLine);
 }
 
 void log(LogLevel level, const char* message, ...)
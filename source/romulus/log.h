@@ -26,7 +26,7 @@ static LogLevel minimumLogLevel = LOG_INFO;
 void logRaw(LogLevel level, const char* message);
 
 // For any lines longer than this the variadic functions will fail
-// And not necessarily in a pretty way (allocates a static temp buffer of x bytes)
+// And not necessarily in a pretty way (formats into a temp buffer of x bytes on the stack)
 #define MAX_LOG_LINE 1024
 
 void log(LogLevel level, const char* message, ...);
@@ -1,11 +1,13 @@
 #include "log.h"
 #include "6502.h"
+#include "cpuBus.h"
 
 const uint16 NMI_VECTOR = 0xFFFA;
 const uint16 RESET_VECTOR = 0xFFFC;
 const uint16 IRQ_VECTOR = 0xFFFE;
 
-void MOS6502::start()
+template <class Bus>
+void MOS6502<Bus>::start()
 {
     stack = 0;
     accumulator = 0;
@@ -13,10 +15,18 @@ void MOS6502::start()
     y = 0;
     status = 0;
 
+    // Nothing pending from before the power went off
+    nmiWasActive = false;
+    nmiPending = false;
+    irqActive = false;
+    interruptPending = false;
+    isBreakRequested = false;
+
     reset();
 }
 
-void MOS6502::reset()
+template <class Bus>
+void MOS6502<Bus>::reset()
 {
     isHalted = false;
     isResetRequested = true;
@@ -24,12 +34,14 @@ void MOS6502::reset()
     pc = 0;
 }
 
-bool MOS6502::isExecuting()
+template <class Bus>
+bool MOS6502<Bus>::isExecuting()
 {
     return isResetRequested || stage > 0;
 }
 
-bool MOS6502::tick()
+template <class Bus>
+bool MOS6502<Bus>::tick()
 {
     if (isHalted)
     {
@@ -41,7 +53,9 @@ bool MOS6502::tick()
         if (interruptPending || isResetRequested)
         {
             sequence = HANDLE_INTERRUPT;
+            tickHandler = &MOS6502::tickInterrupt;
             interruptPending = false;
+            ++interruptCount;
             // Still does a dummy read and takes 7 cycles
             bus->read(pc);
         }
@@ -49,10 +63,13 @@ bool MOS6502::tick()
         {
             instAddr = pc;
             inst = bus->read(pc++);
-            Operation operation = operations[inst];
+            ++instructionCount;
+            ++opcodeCounts[inst];
+
+            const OpcodeDispatch& dispatch = dispatchTable[inst];
 
             // TODO: From what I've found there are no true "KILL" instructions, just undocumented ones that could be problematic
-            if (operation.opCode == KILL)
+            if (dispatch.sequence == NUM_MICROCODE_SEQUENCES)
             {
                 --pc;
                 instAddr = pc;
@@ -60,96 +77,66 @@ bool MOS6502::tick()
                 return false;
             }
 
-            // NOTE: I'm using enums and switches here, these could be function pointers
-            // Will see if that becomes appealing later on
-            switch (operation.opCode)
+            // BRK is the only opcode that runs the interrupt sequence
+            if (dispatch.sequence == HANDLE_INTERRUPT)
             {
-                case BRK:
-                    isBreakRequested = true;
-                    sequence = HANDLE_INTERRUPT;
-                    break;
-
-                case PHA:
-                case PHP:
-                    sequence = PUSH_REGISTER;
-                    break;
-
-                case PLA:
-                case PLP:
-                    sequence = PULL_REGISTER;
-                    break;
-
-                case RTI: sequence = RETURN_INTERRUPT; break;
-                case RTS: sequence = RETURN_SUBROUTINE; break;
-                case JSR: sequence = JUMP_SUBROUTINE; break;
-
-                default:
-                {
-                    switch (operation.addressMode)
-                    {
-                        case Accumulator:
-                        case Implied:
-                        case Immediate:
-                            sequence = TWO_CYCLE_MODES;
-                            break;
-
-                        case ZeroPage: sequence = SEQ_ZEROPAGE; break;
-                        case Absolute: sequence = SEQ_ABSOLUTE; break;
-
-                        case ZeroPageX:
-                        case ZeroPageY:
-                            sequence = SEQ_ZEROPAGE_INDEXED;
-                            break;
-
-                        case AbsoluteX:
-                        case AbsoluteY:
-                            sequence = SEQ_ABSOLUTE_INDEXED;
-                            break;
-
-                        case Relative: sequence = SEQ_RELATIVE; break;
-                        case IndirectX: sequence = SEQ_INDIRECTX; break;
-                        case IndirectY: sequence = SEQ_INDIRECTY; break;
-
-                        // Only used by the JMP instruction, but here in case its on some undocumented one or something
-                        case Indirect: sequence = SEQ_INDIRECT; break;
-                    }
-                }
+                isBreakRequested = true;
             }
+
+            sequence = dispatch.sequence;
+            tickHandler = dispatch.tick;
         }
 
         ++stage;
     }
     else
     {
-        switch (sequence)
+        (this->*tickHandler)();
+    }
+
+    return true;
+}
+
+template <class Bus>
+uint32 MOS6502<Bus>::step()
+{
+    if (isHalted)
+    {
+        return 0;
+    }
+
+    if (stage > 0)
+    {
+        uint32 cycles = 0;
+        while (stage > 0 && !isHalted)
         {
-            case HANDLE_INTERRUPT: tickInterrupt(); break; // BRK/NMI/IRQ/RESET
-            case RETURN_INTERRUPT: tickReturnInterrupt(); break; // RTI
-            case RETURN_SUBROUTINE: tickReturnSubroutine(); break; // RTS
-            case PUSH_REGISTER: tickPushRegister(); break; // PHA, PHX
-            case PULL_REGISTER: tickPullRegister(); break; // PLA, PLX
-            case JUMP_SUBROUTINE: tickJumpSubroutine(); break; // JSR
-            case TWO_CYCLE_MODES: tickTwoCycleInstruction(); break; // Absolute, Immediate, and Implied all do basically the same thing
-            case SEQ_ABSOLUTE: tickAbsoluteInstruction(); break;
-            case SEQ_ZEROPAGE: tickZeropageInstruction(); break;
-            case SEQ_ZEROPAGE_INDEXED: tickZeropageIndexedInstruction(); break;
-            case SEQ_ABSOLUTE_INDEXED: tickAbsoluteIndexedInstruction(); break;
-            case SEQ_RELATIVE: tickRelativeInstruction(); break;
-            case SEQ_INDIRECTX: tickIndirectXInstruction(); break; // These two seem similar but are quite differenct conceptually, (Indirect Indexed, and Indexed Indirect in some docs)
-            case SEQ_INDIRECTY: tickIndirectYInstruction(); break;
-            case SEQ_INDIRECT: tickIndirectInstruction(); break;
-            default:
-            {
-                isHalted = true;
-                return false;
-            }
+            (this->*tickHandler)();
+            ++cycles;
         }
+
+        return cycles;
     }
 
-    return true;
+    if (interruptPending || isResetRequested)
+    {
+        sequence = HANDLE_INTERRUPT;
+        interruptPending = false;
+        ++interruptCount;
+        return stepInterrupt();
+    }
+
+    instAddr = pc;
+    inst = bus->read(pc++);
+    ++instructionCount;
+    ++opcodeCounts[inst];
+
+    const OpcodeDispatch& dispatch = dispatchTable[inst];
+    sequence = dispatch.sequence;
+    return (this->*dispatch.step)();
 }
 
-void MOS6502::jumpSubroutine(uint16 address)
+template <class Bus>
+void MOS6502<Bus>::jumpSubroutine(uint16 address)
 {
     pc = address;
 
@@ -158,7 +145,8 @@ void MOS6502::jumpSubroutine(uint16 address)
     push(returnAddress & 0x00FF);
 }
 
-void MOS6502::addWithCarry(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::addWithCarry(uint8 data)
 {
     uint8 carry = status & STATUS_CARRY;
     uint8 sum = data + carry + accumulator;
@@ -177,18 +165,21 @@ void MOS6502::addWithCarry(uint8 data)
     updateNZ(accumulator);
 }
 
-void MOS6502::subtractWithCarry(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::subtractWithCarry(uint8 data)
 {
     addWithCarry(~data);
 }
 
-void MOS6502::andA(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::andA(uint8 data)
 {
     accumulator &= data;
     updateNZ(accumulator);
 }
 
-uint8 MOS6502::shiftLeft(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::shiftLeft(uint8 data)
 {
     status &= ~STATUS_CARRY;
     status |= (data & 0b10000000) >> 7;
@@ -197,7 +188,8 @@ uint8 MOS6502::shiftLeft(uint8 data)
     return data;
 }
 
-uint8 MOS6502::shiftRight(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::shiftRight(uint8 data)
 {
     status &= ~STATUS_CARRY;
     status |= data & 0b00000001;
@@ -206,7 +198,8 @@ uint8 MOS6502::shiftRight(uint8 data)
     return data;
 }
 
-void MOS6502::bitTest(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::bitTest(uint8 data)
 {
     clearFlags(STATUS_NEGATIVE|STATUS_OVERFLOW|STATUS_ZERO);
     status |= (data & (STATUS_NEGATIVE|STATUS_OVERFLOW));
@@ -217,96 +210,112 @@ void MOS6502::bitTest(uint8 data)
     }
 }
 
-uint8 MOS6502::decrement(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::decrement(uint8 data)
 {
     --data;
     updateNZ(data);
     return data;
 }
 
-void MOS6502::decrementX()
+template <class Bus>
+void MOS6502<Bus>::decrementX()
 {
     --x;
     updateNZ(x);
 }
 
-void MOS6502::decrementY()
+template <class Bus>
+void MOS6502<Bus>::decrementY()
 {
     --y;
     updateNZ(y);
 }
 
-void MOS6502::exclusiveOrA(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::exclusiveOrA(uint8 data)
 {
     accumulator ^= data;
     updateNZ(accumulator);
 }
 
-void MOS6502::orA(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::orA(uint8 data)
 {
     accumulator |= data;
     updateNZ(accumulator);
 }
 
-uint8 MOS6502::increment(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::increment(uint8 data)
 {
     ++data;
     updateNZ(data);
     return data;
 }
 
-void MOS6502::incrementX()
+template <class Bus>
+void MOS6502<Bus>::incrementX()
 {
     ++x;
     updateNZ(x);
 }
 
-void MOS6502::incrementY()
+template <class Bus>
+void MOS6502<Bus>::incrementY()
 {
     ++y;
     updateNZ(y);
 }
 
-void MOS6502::loadA(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::loadA(uint8 data)
 {
     accumulator = data;
     updateNZ(accumulator);
 }
 
-void MOS6502::loadX(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::loadX(uint8 data)
 {
     x = data;
     updateNZ(x);
 }
 
-void MOS6502::loadY(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::loadY(uint8 data)
 {
     y = data;
     updateNZ(y);
 }
 
-void MOS6502::pushA()
+template <class Bus>
+void MOS6502<Bus>::pushA()
 {
     push(accumulator);
 }
 
-void MOS6502::pushStatus()
+template <class Bus>
+void MOS6502<Bus>::pushStatus()
 {
     push(status | 0b00110000);
 }
 
-void MOS6502::pullA()
+template <class Bus>
+void MOS6502<Bus>::pullA()
 {
     accumulator = pull();
     updateNZ(accumulator);
 }
 
-void MOS6502::pullStatus()
+template <class Bus>
+void MOS6502<Bus>::pullStatus()
 {
     status = (pull() & 0b11101111) | 0b00100000;
 }
 
-uint8 MOS6502::rotateLeft(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::rotateLeft(uint8 data)
 {
     uint8 carry = status & STATUS_CARRY;
     clearFlags(STATUS_CARRY);
@@ -316,7 +325,8 @@ uint8 MOS6502::rotateLeft(uint8 data)
     return data;
 }
 
-uint8 MOS6502::rotateRight(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::rotateRight(uint8 data)
 {
     uint8 carry = status & STATUS_CARRY;
     clearFlags(STATUS_CARRY);
@@ -326,62 +336,72 @@ uint8 MOS6502::rotateRight(uint8 data)
     return data;
 }
 
-void MOS6502::transferAtoX()
+template <class Bus>
+void MOS6502<Bus>::transferAtoX()
 {
     x = accumulator;
     updateNZ(x);
 }
 
-void MOS6502::transferAtoY()
+template <class Bus>
+void MOS6502<Bus>::transferAtoY()
 {
     y = accumulator;
     updateNZ(y);
 }
 
-void MOS6502::transferStoX()
+template <class Bus>
+void MOS6502<Bus>::transferStoX()
 {
     x = stack;
     updateNZ(x);
 }
 
-void MOS6502::transferXtoA()
+template <class Bus>
+void MOS6502<Bus>::transferXtoA()
 {
     accumulator = x;
     updateNZ(accumulator);
 }
 
-void MOS6502::transferXtoS()
+template <class Bus>
+void MOS6502<Bus>::transferXtoS()
 {
     stack = x;
 }
 
-void MOS6502::transferYtoA()
+template <class Bus>
+void MOS6502<Bus>::transferYtoA()
 {
     accumulator = y;
     updateNZ(accumulator);
 }
 
-void MOS6502::alr(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::alr(uint8 data)
 {
     andA(data);
     shiftRight(data);
 }
 
-void MOS6502::anc(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::anc(uint8 data)
 {
     andA(data);
     clearFlags(STATUS_CARRY);
     status |= (status & STATUS_NEGATIVE) >> 7;
 }
 
-void MOS6502::arr(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::arr(uint8 data)
 {
     // TODO: Implement
     // Similar to AND #i then ROR A, except sets the flags differently. N and Z are normal, but C is bit 6 and V is bit 6 xor bit 5
     KillUnimplemented("Illegal opcode");
 }
 
-void MOS6502::axs(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::axs(uint8 data)
 {
     // https://www.masswerk.at/6502/6502_instruction_set.html#SBX
     // TODO: Implement
@@ -389,68 +409,78 @@ void MOS6502::axs(uint8 data)
     KillUnimplemented("Illegal opcode");
 }
 
-void MOS6502::atx(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::atx(uint8 data)
 {
     andA(data);
     transferAtoX();
 }
 
-void MOS6502::lax(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::lax(uint8 data)
 {
     loadA(data);
     transferAtoX();
 }
 
-void MOS6502::sxa(uint8 data)
+template <class Bus>
+void MOS6502<Bus>::sxa(uint8 data)
 {
     // TODO: Implement
     // AND X register with the high byte of the target address of the argument +1. Store the result in memory.
     KillUnimplemented("Illegal opcode");
 }
 
-uint8 MOS6502::dcp(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::dcp(uint8 data)
 {
     data = decrement(data);
     compare(accumulator, data);
     return data;
 }
 
-uint8 MOS6502::isc(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::isc(uint8 data)
 {
     data = increment(data);
     subtractWithCarry(data);
     return data;
 }
 
-uint8 MOS6502::rla(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::rla(uint8 data)
 {
     data = rotateLeft(data);
     andA(data);
     return data;
 }
 
-uint8 MOS6502::rra(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::rra(uint8 data)
 {
     data = rotateRight(data);
     addWithCarry(data);
     return data;
 }
 
-uint8 MOS6502::slo(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::slo(uint8 data)
 {
     data = shiftLeft(data);
     orA(data);
     return data;
 }
 
-uint8 MOS6502::sre(uint8 data)
+template <class Bus>
+uint8 MOS6502<Bus>::sre(uint8 data)
 {
     data = shiftRight(data);
     exclusiveOrA(data);
     return data;
 }
 
-uint16 MOS6502::calcAddress(AddressingMode addressMode, uint16 address, uint8 a, uint8 b)
+template <class Bus>
+uint16 MOS6502<Bus>::calcAddress(AddressingMode addressMode, uint16 address, uint8 a, uint8 b)
 {
     switch (addressMode)
     {
@@ -502,17 +532,20 @@ uint16 MOS6502::calcAddress(AddressingMode addressMode, uint16 address, uint8 a,
 // =========
 // Utils
 // =========
-void MOS6502::setFlags(uint8 flags)
+template <class Bus>
+void MOS6502<Bus>::setFlags(uint8 flags)
 {
     status |= flags;
 }
 
-void MOS6502::clearFlags(uint8 flags)
+template <class Bus>
+void MOS6502<Bus>::clearFlags(uint8 flags)
 {
     status &= ~flags;
 }
 
-void MOS6502::updateNZ(uint8 val)
+template <class Bus>
+void MOS6502<Bus>::updateNZ(uint8 val)
 {
     clearFlags(STATUS_NEGATIVE | STATUS_ZERO);
     status |= val & STATUS_NEGATIVE;
@@ -522,7 +555,8 @@ void MOS6502::updateNZ(uint8 val)
     }
 }
 
-void MOS6502::compare(uint8 a, uint8 b)
+template <class Bus>
+void MOS6502<Bus>::compare(uint8 a, uint8 b)
 {
     clearFlags(STATUS_NEGATIVE | STATUS_ZERO | STATUS_CARRY);
     if (a >= b)
@@ -534,19 +568,22 @@ void MOS6502::compare(uint8 a, uint8 b)
 }
 
 
-uint8 MOS6502::pull()
+template <class Bus>
+uint8 MOS6502<Bus>::pull()
 {
     ++stack;
     return bus->read(0x0100 | stack);
 }
 
-void MOS6502::push(uint8 v)
+template <class Bus>
+void MOS6502<Bus>::push(uint8 v)
 {
     bus->write(0x0100 | stack, v);
     stack--;
 }
 
-void MOS6502::setNMI(bool active)
+template <class Bus>
+void MOS6502<Bus>::setNMI(bool active)
 {
     if (!nmiWasActive && active)
     {
@@ -558,20 +595,23 @@ void MOS6502::setNMI(bool active)
     nmiWasActive = active;
 }
 
-void MOS6502::setIRQ(bool active)
+template <class Bus>
+void MOS6502<Bus>::setIRQ(bool active)
 {
     irqActive = active;
 }
 
 // This seems like it could be done at the start of every microcode tick, but some
 // operate very specifically. Therefore I'm sprinkling it around as needed.
-void MOS6502::pollInterrupts()
+template <class Bus>
+void MOS6502<Bus>::pollInterrupts()
 {
     interruptPending = nmiPending || (irqActive && !isFlagSet(STATUS_INT_DISABLE));
 }
 
 // TODO: Find timing of address evaluation, I'm putting it in the first vector read cycle for now
-void MOS6502::tickInterrupt()
+template <class Bus>
+void MOS6502<Bus>::tickInterrupt()
 {    
     // read next instruction byte (and throw it away)
     if (stage == 1)
@@ -646,7 +686,8 @@ void MOS6502::tickInterrupt()
     ++stage;
 }
 
-void MOS6502::tickReturnInterrupt()
+template <class Bus>
+void MOS6502<Bus>::tickReturnInterrupt()
 {
     switch (stage)
     {
@@ -668,7 +709,8 @@ void MOS6502::tickReturnInterrupt()
     ++stage;
 }
 
-void MOS6502::tickReturnSubroutine()
+template <class Bus>
+void MOS6502<Bus>::tickReturnSubroutine()
 {
     switch (stage)
     {
@@ -689,7 +731,9 @@ void MOS6502::tickReturnSubroutine()
     ++stage;
 }
 
-void MOS6502::tickPushRegister()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickPushRegister()
 {
     if (stage == 1)
     {
@@ -700,8 +744,7 @@ void MOS6502::tickPushRegister()
     {
         pollInterrupts();
 
-        Operation operation = operations[inst];
-        if (operation.opCode == PHA)
+        if (operations[Opcode].opCode == PHA)
         {
             pushA();
         }
@@ -714,7 +757,9 @@ void MOS6502::tickPushRegister()
     }
 }
 
-void MOS6502::tickPullRegister()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickPullRegister()
 {
     if (stage == 1)
     {
@@ -729,8 +774,7 @@ void MOS6502::tickPullRegister()
     {
         pollInterrupts();
 
-        Operation operation = operations[inst];
-        if (operation.opCode == PLA)
+        if (operations[Opcode].opCode == PLA)
         {
             pullA();
         }
@@ -743,7 +787,8 @@ void MOS6502::tickPullRegister()
     }
 }
 
-void MOS6502::tickJumpSubroutine()
+template <class Bus>
+void MOS6502<Bus>::tickJumpSubroutine()
 {
     // NOTE: The odd pattern in this and RTS is to hop over p2
     switch (stage)
@@ -764,13 +809,15 @@ void MOS6502::tickJumpSubroutine()
     ++stage;
 }
 
-void MOS6502::tickTwoCycleInstruction()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickTwoCycleInstruction()
 {
     pollInterrupts();
 
     // NOTE: This one almost doesn't feel worth a function, but I kinda want to isolate
     // things as much as possible cause its already a lot to keep in mind at once
-    Operation operation = operations[inst];
+    constexpr Operation operation = operations[Opcode];
     if (operation.addressMode == Immediate)
     {
         tempData = bus->read(pc++);
@@ -781,7 +828,7 @@ void MOS6502::tickTwoCycleInstruction()
         tempData = accumulator;
     }
 
-    if (executeReadInstruction(operation.opCode))
+    if (executeReadInstruction<operation.opCode>())
     {
         stage = 0;
         return;
@@ -824,9 +871,11 @@ void MOS6502::tickTwoCycleInstruction()
     stage = 0;
 }
 
-bool MOS6502::executeReadInstruction(OpCode opcode)
+template <class Bus>
+template <OpCode Op>
+bool MOS6502<Bus>::executeReadInstruction()
 {
-    switch (opcode)
+    switch (Op)
     {
         case LDA: loadA(tempData); break;
         case LDX: loadX(tempData); break;
@@ -861,9 +910,11 @@ bool MOS6502::executeReadInstruction(OpCode opcode)
     return true;
 }
 
-bool MOS6502::executeWriteInstruction(OpCode opcode)
+template <class Bus>
+template <OpCode Op>
+bool MOS6502<Bus>::executeWriteInstruction()
 {
-    switch (opcode)
+    switch (Op)
     {
         case STA: bus->write(address, accumulator); break;
         case STX: bus->write(address, x); break;
@@ -881,9 +932,11 @@ bool MOS6502::executeWriteInstruction(OpCode opcode)
 }
 
 // always the last/longest in a sequence so not bool like the other two
-void MOS6502::executeModifyInstruction(OpCode opcode)
+template <class Bus>
+template <OpCode Op>
+void MOS6502<Bus>::executeModifyInstruction()
 {
-    switch (opcode)
+    switch (Op)
     {
         case ASL: bus->write(address, shiftLeft(tempData)); break;
         case LSR: bus->write(address, shiftRight(tempData)); break;
@@ -905,11 +958,13 @@ void MOS6502::executeModifyInstruction(OpCode opcode)
     }
 }
 
-void MOS6502::tickAbsoluteInstruction()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickAbsoluteInstruction()
 {
     pollInterrupts();
 
-    Operation operation = operations[inst];
+    constexpr Operation operation = operations[Opcode];
 
     switch (stage)
     {
@@ -930,14 +985,14 @@ void MOS6502::tickAbsoluteInstruction()
         }
         case 3:
         {
-            if (executeWriteInstruction(operation.opCode))
+            if (executeWriteInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
             }
 
             tempData = bus->read(address);
-            if (executeReadInstruction(operation.opCode))
+            if (executeReadInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -953,7 +1008,7 @@ void MOS6502::tickAbsoluteInstruction()
         }
         case 5:
         {
-            executeModifyInstruction(operation.opCode);
+            executeModifyInstruction<operation.opCode>();
             stage = 0;
             return;
         }
@@ -962,25 +1017,27 @@ void MOS6502::tickAbsoluteInstruction()
     ++stage;
 }
 
-void MOS6502::tickZeropageInstruction()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickZeropageInstruction()
 {
     pollInterrupts();
 
-    Operation operation = operations[inst];
+    constexpr Operation operation = operations[Opcode];
 
     switch (stage)
     {
         case 1: address = bus->read(pc++); break;
         case 2:
         {
-            if (executeWriteInstruction(operation.opCode))
+            if (executeWriteInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
             }
 
             tempData = bus->read(address);
-            if (executeReadInstruction(operation.opCode))
+            if (executeReadInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -996,7 +1053,7 @@ void MOS6502::tickZeropageInstruction()
         }
         case 4:
         {
-            executeModifyInstruction(operation.opCode);
+            executeModifyInstruction<operation.opCode>();
             stage = 0;
             return;
         }
@@ -1005,11 +1062,13 @@ void MOS6502::tickZeropageInstruction()
     ++stage;
 }
 
-void MOS6502::tickZeropageIndexedInstruction()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickZeropageIndexedInstruction()
 {
     pollInterrupts();
 
-    Operation operation = operations[inst];
+    constexpr Operation operation = operations[Opcode];
 
     switch (stage)
     {
@@ -1030,14 +1089,14 @@ void MOS6502::tickZeropageIndexedInstruction()
         }
         case 3:
         {
-            if (executeWriteInstruction(operation.opCode))
+            if (executeWriteInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
             }
 
             tempData = bus->read(address);
-            if (executeReadInstruction(operation.opCode))
+            if (executeReadInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -1052,7 +1111,7 @@ void MOS6502::tickZeropageIndexedInstruction()
         }
         case 5:
         {
-            executeModifyInstruction(operation.opCode);
+            executeModifyInstruction<operation.opCode>();
             stage = 0;
             return;
         }
@@ -1061,11 +1120,13 @@ void MOS6502::tickZeropageIndexedInstruction()
     ++stage;
 }
 
-void MOS6502::tickAbsoluteIndexedInstruction()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickAbsoluteIndexedInstruction()
 {
     pollInterrupts();
 
-    Operation operation = operations[inst];
+    constexpr Operation operation = operations[Opcode];
 
     switch (stage)
     {
@@ -1097,7 +1158,7 @@ void MOS6502::tickAbsoluteIndexedInstruction()
                 address += 0x0100;
                 pageBoundaryCrossed = false;
             }
-            else if (executeReadInstruction(operation.opCode))
+            else if (executeReadInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -1107,14 +1168,14 @@ void MOS6502::tickAbsoluteIndexedInstruction()
         }
         case 4:
         {
-            if (executeWriteInstruction(operation.opCode))
+            if (executeWriteInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
             }
 
             tempData = bus->read(address);
-            if (executeReadInstruction(operation.opCode))
+            if (executeReadInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -1129,7 +1190,7 @@ void MOS6502::tickAbsoluteIndexedInstruction()
         }
         case 6:
         {
-            executeModifyInstruction(operation.opCode);
+            executeModifyInstruction<operation.opCode>();
             stage = 0;
             return;
         }
@@ -1138,10 +1199,29 @@ void MOS6502::tickAbsoluteIndexedInstruction()
     ++stage;
 }
 
-void MOS6502::tickRelativeInstruction()
+template <class Bus>
+template <OpCode Op>
+bool MOS6502<Bus>::isBranchTaken()
 {
-    // TODO: Fetch this on decode and keep around
-    Operation operation = operations[inst];
+    switch (Op)
+    {
+        case BCC: return isFlagClear(STATUS_CARRY);
+        case BCS: return isFlagSet(STATUS_CARRY);
+        case BVC: return isFlagClear(STATUS_OVERFLOW);
+        case BVS: return isFlagSet(STATUS_OVERFLOW);
+        case BNE: return isFlagClear(STATUS_ZERO);
+        case BEQ: return isFlagSet(STATUS_ZERO);
+        case BPL: return isFlagClear(STATUS_NEGATIVE);
+        case BMI: return isFlagSet(STATUS_NEGATIVE);
+        default: return false;
+    }
+}
+
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickRelativeInstruction()
+{
+    constexpr Operation operation = operations[Opcode];
 
     switch (stage)
     {
@@ -1151,21 +1231,7 @@ void MOS6502::tickRelativeInstruction()
 
             p1 = bus->read(pc++);
 
-            bool shouldBranch = false;
-
-            switch (operation.opCode)
-            {
-                case BCC: shouldBranch = isFlagClear(STATUS_CARRY); break;
-                case BCS: shouldBranch = isFlagSet(STATUS_CARRY); break;
-                case BVC: shouldBranch = isFlagClear(STATUS_OVERFLOW); break;
-                case BVS: shouldBranch = isFlagSet(STATUS_OVERFLOW); break;
-                case BNE: shouldBranch = isFlagClear(STATUS_ZERO); break;
-                case BEQ: shouldBranch = isFlagSet(STATUS_ZERO); break;
-                case BPL: shouldBranch = isFlagClear(STATUS_NEGATIVE); break;
-                case BMI: shouldBranch = isFlagSet(STATUS_NEGATIVE); break;
-            }
-
-            if (!shouldBranch)
+            if (!isBranchTaken<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -1206,11 +1272,13 @@ void MOS6502::tickRelativeInstruction()
     ++stage;
 }
 
-void MOS6502::tickIndirectXInstruction()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickIndirectXInstruction()
 {
     pollInterrupts();
 
-    Operation operation = operations[inst];
+    constexpr Operation operation = operations[Opcode];
 
     switch (stage)
     {
@@ -1234,14 +1302,14 @@ void MOS6502::tickIndirectXInstruction()
         }
         case 5:
         {
-            if (executeWriteInstruction(operation.opCode))
+            if (executeWriteInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
             }
 
             tempData = bus->read(address);
-            if (executeReadInstruction(operation.opCode))
+            if (executeReadInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -1257,7 +1325,7 @@ void MOS6502::tickIndirectXInstruction()
         }
         case 7:
         {
-            executeModifyInstruction(operation.opCode);
+            executeModifyInstruction<operation.opCode>();
             stage = 0;
             return;
         }
@@ -1266,11 +1334,13 @@ void MOS6502::tickIndirectXInstruction()
     ++stage;
 }
 
-void MOS6502::tickIndirectYInstruction()
+template <class Bus>
+template <uint8 Opcode>
+void MOS6502<Bus>::tickIndirectYInstruction()
 {
     pollInterrupts();
 
-    Operation operation = operations[inst];
+    constexpr Operation operation = operations[Opcode];
 
     switch (stage)
     {
@@ -1301,7 +1371,7 @@ void MOS6502::tickIndirectYInstruction()
                 address += 0x0100;
                 pageBoundaryCrossed = false;
             }
-            else if (executeReadInstruction(operation.opCode))
+            else if (executeReadInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -1311,14 +1381,14 @@ void MOS6502::tickIndirectYInstruction()
         }
         case 5:
         {
-            if (executeWriteInstruction(operation.opCode))
+            if (executeWriteInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
             }
 
             tempData = bus->read(address);
-            if (executeReadInstruction(operation.opCode))
+            if (executeReadInstruction<operation.opCode>())
             {
                 stage = 0;
                 return;
@@ -1334,7 +1404,7 @@ void MOS6502::tickIndirectYInstruction()
         }
         case 7:
         {
-            executeModifyInstruction(operation.opCode);
+            executeModifyInstruction<operation.opCode>();
             stage = 0;
             return;
         }
@@ -1343,7 +1413,8 @@ void MOS6502::tickIndirectYInstruction()
     ++stage;
 }
 
-void MOS6502::tickIndirectInstruction()
+template <class Bus>
+void MOS6502<Bus>::tickIndirectInstruction()
 {
     switch (stage)
     {
@@ -1365,29 +1436,342 @@ void MOS6502::tickIndirectInstruction()
     ++stage;
 }
 
-void MOS6502::pullPCL()
+template <class Bus>
+uint32 MOS6502<Bus>::stepInterrupt()
+{
+    if (isBreakRequested)
+    {
+        ++pc;
+    }
+
+    if (isResetRequested)
+    {
+        // R/W is held read until the reset finishes so only sp can update
+        stack -= 3;
+        address = RESET_VECTOR;
+        isResetRequested = 0;
+    }
+    else
+    {
+        pushPCH();
+        pushPCL();
+
+        if (isBreakRequested)
+        {
+            // Sets the "B" flag
+            push(status | 0b00110000);
+        }
+        else
+        {
+            push(status | 0b00100000);
+        }
+
+        if (nmiPending)
+        {
+            address = NMI_VECTOR;
+            nmiPending = false;
+        }
+        else
+        {
+            address = IRQ_VECTOR;
+            isBreakRequested = false;
+        }
+    }
+
+    setFlags(STATUS_INT_DISABLE);
+    uint8 pcl = bus->read(address++);
+    pc = ((uint16)bus->read(address) << 8) | pcl;
+    return 7;
+}
+
+template <class Bus>
+uint32 MOS6502<Bus>::stepBreak()
+{
+    isBreakRequested = true;
+    return stepInterrupt();
+}
+
+template <class Bus>
+uint32 MOS6502<Bus>::stepReturnInterrupt()
+{
+    pullStatus();
+    pullPCL();
+    pollInterrupts();
+    pullPCH();
+    return 6;
+}
+
+template <class Bus>
+uint32 MOS6502<Bus>::stepReturnSubroutine()
+{
+    pullPCL();
+    pullPCH();
+    pollInterrupts();
+    ++pc;
+    return 6;
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepPushRegister()
+{
+    pollInterrupts();
+
+    if (operations[Opcode].opCode == PHA)
+    {
+        pushA();
+    }
+    else
+    {
+        pushStatus();
+    }
+
+    return 3;
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepPullRegister()
+{
+    // Polled before the pull, so PLP changing the interrupt flag takes an instruction to kick in
+    pollInterrupts();
+
+    if (operations[Opcode].opCode == PLA)
+    {
+        pullA();
+    }
+    else
+    {
+        pullStatus();
+    }
+
+    return 4;
+}
+
+template <class Bus>
+uint32 MOS6502<Bus>::stepJumpSubroutine()
+{
+    p1 = bus->read(pc++);
+    pushPCH();
+    pushPCL();
+    pollInterrupts();
+    pc = ((uint16)bus->read(pc) << 8) | p1;
+    return 6;
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepTwoCycleInstruction()
+{
+    // Already a single cycle after the fetch
+    tickTwoCycleInstruction<Opcode>();
+    return 2;
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepMemoryAccess(uint32 cycles)
+{
+    constexpr Operation operation = operations[Opcode];
+
+    if (executeWriteInstruction<operation.opCode>())
+    {
+        return cycles;
+    }
+
+    tempData = bus->read(address);
+    if (executeReadInstruction<operation.opCode>())
+    {
+        return cycles;
+    }
+
+    // dummy write, mappers watching for back to back writes still see both
+    bus->write(address, tempData);
+    executeModifyInstruction<operation.opCode>();
+    return cycles + 2;
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepAbsoluteInstruction()
+{
+    p1 = bus->read(pc++);
+    pollInterrupts();
+
+    if (operations[Opcode].opCode == JMP)
+    {
+        pc = ((uint16)bus->read(pc) << 8) | p1;
+        return 3;
+    }
+
+    p2 = bus->read(pc++);
+    address = ((uint16)p2 << 8) | p1;
+    return stepMemoryAccess<Opcode>(4);
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepZeropageInstruction()
+{
+    address = bus->read(pc++);
+    pollInterrupts();
+    return stepMemoryAccess<Opcode>(3);
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepZeropageIndexedInstruction()
+{
+    p1 = bus->read(pc++);
+    if (operations[Opcode].addressMode == ZeroPageX)
+    {
+        address = (uint8)(p1 + x);
+    }
+    else
+    {
+        address = (uint8)(p1 + y);
+    }
+
+    pollInterrupts();
+    return stepMemoryAccess<Opcode>(4);
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepAbsoluteIndexedInstruction()
+{
+    constexpr Operation operation = operations[Opcode];
+
+    uint8 index = operation.addressMode == AbsoluteY ? y : x;
+    p1 = bus->read(pc++);
+    p2 = bus->read(pc++);
+    address = ((uint16)p2 << 8) | (uint8)(p1 + index);
+    pollInterrupts();
+
+    // Kept since it's a real read (and can hit a register), the same as the cycle version
+    tempData = bus->read(address);
+    if ((uint16)p1 + index >= 0x0100)
+    {
+        address += 0x0100;
+    }
+    else if (executeReadInstruction<operation.opCode>())
+    {
+        return 4;
+    }
+
+    return stepMemoryAccess<Opcode>(5);
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepRelativeInstruction()
+{
+    pollInterrupts();
+
+    p1 = bus->read(pc++);
+    if (!isBranchTaken<operations[Opcode].opCode>())
+    {
+        return 2;
+    }
+
+    uint16 oldHi = pc & 0xFF00;
+    pc += (int8)p1;
+    if ((pc & 0xFF00) == oldHi)
+    {
+        return 3;
+    }
+
+    pollInterrupts();
+    return 4;
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepIndirectXInstruction()
+{
+    p1 = bus->read(pc++) + x;
+    address = bus->read(p1++);
+    address |= (uint16)bus->read(p1) << 8;
+    pollInterrupts();
+    return stepMemoryAccess<Opcode>(6);
+}
+
+template <class Bus>
+template <uint8 Opcode>
+uint32 MOS6502<Bus>::stepIndirectYInstruction()
+{
+    constexpr Operation operation = operations[Opcode];
+
+    p1 = bus->read(pc++);
+    uint16 lo = (uint16)bus->read(p1++) + y;
+    uint8 hi = bus->read(p1);
+    address = ((uint16)hi << 8) | (lo & 0x00FF);
+    pollInterrupts();
+
+    tempData = bus->read(address);
+    if (lo >= 0x0100)
+    {
+        address += 0x0100;
+    }
+    else if (executeReadInstruction<operation.opCode>())
+    {
+        return 5;
+    }
+
+    return stepMemoryAccess<Opcode>(6);
+}
+
+template <class Bus>
+uint32 MOS6502<Bus>::stepIndirectInstruction()
+{
+    p1 = bus->read(pc++);
+    p2 = bus->read(pc++);
+
+    // page boundaries not handled for this mode
+    tempData = bus->read((uint16)p2 << 8 | p1);
+    uint16 hi = bus->read((uint16)p2 << 8 | (uint8)(p1 + 1));
+    pollInterrupts();
+    pc = ((uint16)hi << 8) + tempData;
+    return 5;
+}
+
+template <class Bus>
+uint32 MOS6502<Bus>::stepKill()
+{
+    --pc;
+    instAddr = pc;
+    KillUnimplemented("Illegal opcode");
+    return 0;
+}
+
+template <class Bus>
+void MOS6502<Bus>::pullPCL()
 {
     pc &= 0xFF00;
     pc |= pull();
 }
 
-void MOS6502::pullPCH()
+template <class Bus>
+void MOS6502<Bus>::pullPCH()
 {
     pc &= 0x00FF;
     pc |= (uint16)pull() << 8;
 }
 
-void MOS6502::pushPCL()
+template <class Bus>
+void MOS6502<Bus>::pushPCL()
 {
     push(pc & 0x00FF);
 }
 
-void MOS6502::pushPCH()
+template <class Bus>
+void MOS6502<Bus>::pushPCH()
 {
     push((pc & 0xFF00) >> 8);
 }
 
-void MOS6502::KillUnimplemented(const char* message)
+template <class Bus>
+void MOS6502<Bus>::KillUnimplemented(const char* message)
 {
     Operation operation = operations[inst];
     logError("[CPU] %s: 0x%04X 0x%02X %s (%s, %d)\n",
@@ -1398,11 +1782,58 @@ void MOS6502::KillUnimplemented(const char* message)
         addressModeNames[operation.addressMode],
         stage);
 
+    // A rom running an opcode that isn't handled isn't a bug in the emulator, so it only halts the cpu and leaves the
+    // caller to notice (batch runs report the job as stopped rather than losing the whole run)
     isHalted = true;
-    assert(false);
 }
 
-void MOS6502::forceClearNMI()
+template <class Bus>
+void MOS6502<Bus>::forceClearNMI()
 {
     nmiPending = false;
-}
\ No newline at end of file
+}
+
+template <class Bus>
+void MOS6502<Bus>::serialize(SaveState* state)
+{
+    state->value(pc);
+    state->value(stack);
+    state->value(status);
+    state->value(accumulator);
+    state->value(x);
+    state->value(y);
+
+    state->value(inst);
+    state->value(instAddr);
+    state->value(address);
+    state->enumValue(sequence, NUM_MICROCODE_SEQUENCES);
+    state->value(stage);
+
+    state->value(isHalted);
+    state->value(nmiWasActive);
+    state->value(nmiPending);
+    state->value(irqActive);
+    state->value(isResetRequested);
+    state->value(isBreakRequested);
+    state->value(interruptPending);
+
+    state->value(p1);
+    state->value(p2);
+    state->value(tempData);
+    state->value(pageBoundaryCrossed);
+
+    // Pointers can't go in a save state, but the handler always follows from the sequence and the instruction
+    if (state->isLoading())
+    {
+        tickHandler = sequence == HANDLE_INTERRUPT ? &MOS6502::tickInterrupt : dispatchTable[inst].tick;
+    }
+}
+
+template <class Bus>
+const std::array<typename MOS6502<Bus>::OpcodeDispatch, 256> MOS6502<Bus>::dispatchTable =
+    MOS6502<Bus>::buildDispatchTable(std::make_index_sequence<256>());
+
+// The nes only ever runs on the cpu bus, so that gets its own copy with direct calls.
+// The generic version is kept around for tests and debug tools that want to swap out memory
+template class MOS6502<CPUBus>;
+template class MOS6502<IBus>;
@@ -1,5 +1,10 @@
 #pragma once
 #include "bus.h"
+#include "saveState.h"
+
+#include <array>
+#include <utility>
+#include <type_traits>
 
 // TODO: If this becomes a bottleneck, consider converting some instructions into intrisics or taking more advantage of asm in some way
 
@@ -198,7 +203,7 @@ struct Operation
     bool isUnofficial;
 };
 
-static Operation operations[] = {
+static constexpr Operation operations[] = {
     { 0x00, 7, BRK, Implied, false },
     { 0x01, 6, ORA, IndirectX, false },
     { 0x02, 0, KILL, Implied, true },
@@ -497,6 +502,53 @@ enum MicrocodeSequence
     NUM_MICROCODE_SEQUENCES
 };
 
+// Which sequence an opcode runs, NUM_MICROCODE_SEQUENCES for the ones that kill the chip
+constexpr MicrocodeSequence getOpcodeSequence(uint8 opcode)
+{
+    switch (operations[opcode].opCode)
+    {
+        case KILL: return NUM_MICROCODE_SEQUENCES;
+        case BRK: return HANDLE_INTERRUPT;
+        case PHA: case PHP: return PUSH_REGISTER;
+        case PLA: case PLP: return PULL_REGISTER;
+        case RTI: return RETURN_INTERRUPT;
+        case RTS: return RETURN_SUBROUTINE;
+        case JSR: return JUMP_SUBROUTINE;
+        default: break;
+    }
+
+    switch (operations[opcode].addressMode)
+    {
+        case Accumulator: case Implied: case Immediate: return TWO_CYCLE_MODES;
+        case ZeroPage: return SEQ_ZEROPAGE;
+        case Absolute: return SEQ_ABSOLUTE;
+        case ZeroPageX: case ZeroPageY: return SEQ_ZEROPAGE_INDEXED;
+        case AbsoluteX: case AbsoluteY: return SEQ_ABSOLUTE_INDEXED;
+        case Relative: return SEQ_RELATIVE;
+        case IndirectX: return SEQ_INDIRECTX;
+        case IndirectY: return SEQ_INDIRECTY;
+
+        // Only used by the JMP instruction, but here in case its on some undocumented one or something
+        case Indirect: return SEQ_INDIRECT;
+    }
+
+    return NUM_MICROCODE_SEQUENCES;
+}
+
+// Bytes taken by the opcode and its operand
+constexpr uint32 getInstructionLength(AddressingMode addressMode)
+{
+    switch (addressMode)
+    {
+        case Absolute: case AbsoluteX: case AbsoluteY: case Indirect: return 3;
+        case Accumulator: case Implied: return 1;
+        default: return 2;
+    }
+}
+
+// Templated on the bus so the common case (CPUBus) can resolve reads and writes at compile time
+// instead of going through the vtable on every access. MOS6502<IBus> works with any bus implementation.
+template <class Bus>
 class MOS6502
 {
 public:
@@ -520,7 +572,16 @@ public:
     // Tells us how far into a given sequence we are
     uint8 stage;
 
-    void connect(IBus* bus) { this->bus = bus; }
+    // Total opcodes fetched since the cpu was created, used for throughput stats
+    uint64 instructionCount;
+
+    // The same broken down by opcode, for the opcode mix benchmark
+    uint64 opcodeCounts[256];
+
+    // Interrupt sequences started (including resets), so anything watching can tell whether one ran in between
+    uint64 interruptCount;
+
+    void connect(Bus* bus) { this->bus = bus; }
 
     void start();
 
@@ -529,7 +590,21 @@ public:
     void stop() { isHalted = true; };
 
     bool tick();
+
+    // Runs a whole instruction (or interrupt) in one go and returns how many cycles it took, 0 if the cpu halted.
+    // Bus accesses all land at once instead of on their own cycles and dummy reads of the program are skipped,
+    // so it's for things that don't watch the timing within an instruction (nsf playback, bulk smoke tests).
+    // Can be mixed freely with tick, an instruction that was started a cycle at a time gets finished that way
+    uint32 step();
+
     bool hasHalted() { return isHalted; }
+
+    // Whether step is going to start an interrupt (or the reset) rather than the instruction at pc
+    bool isInterruptPending() { return interruptPending || isResetRequested; }
+
+    // Whether the interrupt lines are asking for one, what the next poll will see
+    bool isInterruptRequested() { return nmiPending || (irqActive && !isFlagSet(STATUS_INT_DISABLE)); }
+
     bool isExecuting();
 
     bool isFlagSet(uint8 flags) { return status & flags; }
@@ -552,6 +627,9 @@ public:
     // See: https://www.nesdev.org/wiki/IRQ
     void setIRQ(bool active);
 
+    // Reads or writes everything needed to resume mid instruction
+    void serialize(SaveState* state);
+
     bool isNMIStarting() { return interruptPending && nmiPending && stage == 0; }
     bool isNMIRunning() { return sequence == HANDLE_INTERRUPT && nmiPending; }
 
@@ -572,7 +650,7 @@ private:
     uint8 p2;
     uint8 tempData; // temp storage
 
-    IBus* bus;
+    Bus* bus;
 
     bool interruptPending;
     void pollInterrupts();
@@ -649,30 +727,125 @@ private:
     bool pageBoundaryCrossed;
     
     // SequenceHandlers
+    // Anything that depends on the opcode is a template, so every opcode gets its own copy of its sequence with
+    // the operation baked in. Picking one of those when the opcode is fetched replaces switching on the sequence
+    // every cycle and then on the opcode again inside it. The cycles each one takes are exactly the same.
     void tickInterrupt(); // BRK/NMI/IRQ/RESET
     void tickReturnInterrupt();
     void tickReturnSubroutine();
-    void tickPushRegister();
-    void tickPullRegister();
+    template <uint8 Opcode> void tickPushRegister();
+    template <uint8 Opcode> void tickPullRegister();
     void tickJumpSubroutine();
-    void tickTwoCycleInstruction();
-    void tickAbsoluteInstruction();
-    void tickZeropageInstruction();
-    void tickZeropageIndexedInstruction();
-    void tickAbsoluteIndexedInstruction();
-    void tickRelativeInstruction();
-    void tickIndirectXInstruction();
-    void tickIndirectYInstruction();
+    template <uint8 Opcode> void tickTwoCycleInstruction();
+    template <uint8 Opcode> void tickAbsoluteInstruction();
+    template <uint8 Opcode> void tickZeropageInstruction();
+    template <uint8 Opcode> void tickZeropageIndexedInstruction();
+    template <uint8 Opcode> void tickAbsoluteIndexedInstruction();
+    template <uint8 Opcode> void tickRelativeInstruction();
+    template <uint8 Opcode> void tickIndirectXInstruction();
+    template <uint8 Opcode> void tickIndirectYInstruction();
     void tickIndirectInstruction();
 
+    // The same sequences for step, each runs everything after the fetch and returns the cycles it took.
+    // They share the operations (and the execute helpers) with the cycle handlers, only the timing differs
+    uint32 stepInterrupt();
+    uint32 stepBreak();
+    uint32 stepReturnInterrupt();
+    uint32 stepReturnSubroutine();
+    template <uint8 Opcode> uint32 stepPushRegister();
+    template <uint8 Opcode> uint32 stepPullRegister();
+    uint32 stepJumpSubroutine();
+    template <uint8 Opcode> uint32 stepTwoCycleInstruction();
+    template <uint8 Opcode> uint32 stepAbsoluteInstruction();
+    template <uint8 Opcode> uint32 stepZeropageInstruction();
+    template <uint8 Opcode> uint32 stepZeropageIndexedInstruction();
+    template <uint8 Opcode> uint32 stepAbsoluteIndexedInstruction();
+    template <uint8 Opcode> uint32 stepRelativeInstruction();
+    template <uint8 Opcode> uint32 stepIndirectXInstruction();
+    template <uint8 Opcode> uint32 stepIndirectYInstruction();
+    uint32 stepIndirectInstruction();
+    uint32 stepKill();
+
+    // Everything from the address being known on, reads and writes take the cycles given and modifies 2 more
+    template <uint8 Opcode> uint32 stepMemoryAccess(uint32 cycles);
+
+    typedef void (MOS6502::*TickHandler)();
+    typedef uint32 (MOS6502::*StepHandler)();
+
+    struct OpcodeDispatch
+    {
+        TickHandler tick;
+        StepHandler step;
+        MicrocodeSequence sequence;
+    };
+
+    // Every cycle after the fetch goes straight to the handler picked for the instruction
+    TickHandler tickHandler;
+
+    // Built at compile time, indexed by opcode
+    static const std::array<OpcodeDispatch, 256> dispatchTable;
+
+    template <size_t... Opcodes>
+    static constexpr std::array<OpcodeDispatch, 256> buildDispatchTable(std::index_sequence<Opcodes...>)
+    {
+        return {{ { getTickHandler<Opcodes>(), getStepHandler<Opcodes>(), getOpcodeSequence(Opcodes) }... }};
+    }
+
+    // Overloaded on the sequence so only the handler that's picked gets instantiated
+    template <MicrocodeSequence Sequence>
+    using SequenceTag = std::integral_constant<MicrocodeSequence, Sequence>;
+
+    template <uint8 Opcode>
+    static constexpr TickHandler getTickHandler() { return getTickHandler<Opcode>(SequenceTag<getOpcodeSequence(Opcode)>()); }
+
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<HANDLE_INTERRUPT>) { return &MOS6502::tickInterrupt; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<RETURN_INTERRUPT>) { return &MOS6502::tickReturnInterrupt; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<RETURN_SUBROUTINE>) { return &MOS6502::tickReturnSubroutine; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<PUSH_REGISTER>) { return &MOS6502::tickPushRegister<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<PULL_REGISTER>) { return &MOS6502::tickPullRegister<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<JUMP_SUBROUTINE>) { return &MOS6502::tickJumpSubroutine; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<TWO_CYCLE_MODES>) { return &MOS6502::tickTwoCycleInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<SEQ_ABSOLUTE>) { return &MOS6502::tickAbsoluteInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<SEQ_ZEROPAGE>) { return &MOS6502::tickZeropageInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<SEQ_ZEROPAGE_INDEXED>) { return &MOS6502::tickZeropageIndexedInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<SEQ_ABSOLUTE_INDEXED>) { return &MOS6502::tickAbsoluteIndexedInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<SEQ_RELATIVE>) { return &MOS6502::tickRelativeInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<SEQ_INDIRECTX>) { return &MOS6502::tickIndirectXInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<SEQ_INDIRECTY>) { return &MOS6502::tickIndirectYInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<SEQ_INDIRECT>) { return &MOS6502::tickIndirectInstruction; }
+
+    // Never actually run, the fetch stops on these before a handler is needed
+    template <uint8 Opcode> static constexpr TickHandler getTickHandler(SequenceTag<NUM_MICROCODE_SEQUENCES>) { return &MOS6502::tickInterrupt; }
+
+    template <uint8 Opcode>
+    static constexpr StepHandler getStepHandler() { return getStepHandler<Opcode>(SequenceTag<getOpcodeSequence(Opcode)>()); }
+
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<HANDLE_INTERRUPT>) { return &MOS6502::stepBreak; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<RETURN_INTERRUPT>) { return &MOS6502::stepReturnInterrupt; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<RETURN_SUBROUTINE>) { return &MOS6502::stepReturnSubroutine; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<PUSH_REGISTER>) { return &MOS6502::stepPushRegister<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<PULL_REGISTER>) { return &MOS6502::stepPullRegister<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<JUMP_SUBROUTINE>) { return &MOS6502::stepJumpSubroutine; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<TWO_CYCLE_MODES>) { return &MOS6502::stepTwoCycleInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<SEQ_ABSOLUTE>) { return &MOS6502::stepAbsoluteInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<SEQ_ZEROPAGE>) { return &MOS6502::stepZeropageInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<SEQ_ZEROPAGE_INDEXED>) { return &MOS6502::stepZeropageIndexedInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<SEQ_ABSOLUTE_INDEXED>) { return &MOS6502::stepAbsoluteIndexedInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<SEQ_RELATIVE>) { return &MOS6502::stepRelativeInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<SEQ_INDIRECTX>) { return &MOS6502::stepIndirectXInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<SEQ_INDIRECTY>) { return &MOS6502::stepIndirectYInstruction<Opcode>; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<SEQ_INDIRECT>) { return &MOS6502::stepIndirectInstruction; }
+    template <uint8 Opcode> static constexpr StepHandler getStepHandler(SequenceTag<NUM_MICROCODE_SEQUENCES>) { return &MOS6502::stepKill; }
+
     void pullPCL();
     void pushPCL();
     void pullPCH();
     void pushPCH();
 
-    bool executeReadInstruction(OpCode opcode);
-    bool executeWriteInstruction(OpCode opcode);
-    void executeModifyInstruction(OpCode opcode);
+    template <OpCode Op> bool executeReadInstruction();
+    template <OpCode Op> bool executeWriteInstruction();
+    template <OpCode Op> void executeModifyInstruction();
+    template <OpCode Op> bool isBranchTaken();
 
     // TEMP: used to debug new per cycle execution
     void KillUnimplemented(const char* message);
@@ -1,10 +1,28 @@
 #include "apu.h"
 
-const bool DEBUG_PULSE1_MUTE = 0;
-const bool DEBUG_PULSE2_MUTE = 0;
-const bool DEBUG_TRIANGLE_MUTE = 0;
-const bool DEBUG_NOISE_MUTE = 0;
-const bool DEBUG_DMC_MUTE = 0;
+void APU::init(uint32 clockRate, uint32 sampleRate)
+{
+    output.setRates(clockRate, sampleRate);
+    filters.setDefault(sampleRate);
+
+    for (uint32 i = 0; i < APU_CHANNEL_COUNT; ++i)
+    {
+        channelGains[i] = MIXER_GAIN_UNIT;
+    }
+
+    buildMixerTables(1.0f);
+}
+
+void APU::powerOn()
+{
+    pulse1 = PulseChannel();
+    pulse2 = PulseChannel();
+    triangle = TriangleChannel();
+    noise = NoiseChannel();
+    dmc = DeltaModulationChannel();
+
+    reset();
+}
 
 void APU::reset()
 {
@@ -19,10 +37,17 @@ void APU::reset()
     isFrameInteruptFlagSet = false;
     isFiveStepMode = false;
     isInterruptInhibited = false;
+
+    isOutputDirty = true;
+    lastAmplitude = 0;
+    output.clear();
+    filters.reset();
 }
 
 void APU::quarterClock()
 {
+    isOutputDirty = true;
+
     // Tick the envelopes and triangle linear counter
     pulse1.envelope.tick();
     pulse2.envelope.tick();
@@ -43,8 +68,15 @@ void APU::halfClock()
 
 void APU::tick(uint32 cpuCycleCount)
 {
+    // Outside of frame counter clocks and register writes, the outputs only move when a channel steps its sequence
+    uint8 triangleIndex = triangle.sequenceIndex;
     triangle.tick();
 
+    if (triangle.sequenceIndex != triangleIndex)
+    {
+        isOutputDirty = true;
+    }
+
     if (cpuCycleCount % 2 == 0)
     {
         return;
@@ -88,11 +120,25 @@ void APU::tick(uint32 cpuCycleCount)
         sequenceComplete = true;
     }
 
+    uint8 pulse1Index = pulse1.dutySequenceIndex;
+    uint8 pulse2Index = pulse2.dutySequenceIndex;
+    uint16 noiseBit = noise.shiftRegister & 0x0001;
+    uint8 dmcOutput = dmc.getOutput();
+
     pulse1.tick();
     pulse2.tick();
     noise.tick();
     dmc.tick();
 
+    // Disabled channels still step, but they can't be heard until a register write turns them on
+    if ((pulse1.isEnabled && pulse1.dutySequenceIndex != pulse1Index)
+        || (pulse2.isEnabled && pulse2.dutySequenceIndex != pulse2Index)
+        || (noise.isEnabled && (noise.shiftRegister & 0x0001) != noiseBit)
+        || dmc.getOutput() != dmcOutput)
+    {
+        isOutputDirty = true;
+    }
+
     if (sequenceComplete)
     {
         frameCounter = 0;
@@ -147,46 +193,137 @@ void APU::writeFrameCounterControl(uint8 value)
     frameCounterResetRequested = true;
 }
 
-real32 APU::getOutput()
+int32 APU::getOutput()
 {
-    // Using the linear approximation for now
-    // https://www.nesdev.org/wiki/APU_Mixer#Linear_Approximation
+    // The pulse and tnd groups mix nonlinearly, each is looked up by the weighted sum of its channels' levels
+    uint32 pulseLevel = (pulse1.getOutput() * channelGains[APU_PULSE1])
+        + (pulse2.getOutput() * channelGains[APU_PULSE2]);
 
-    real32 pulseOutput = 0.0f;
-    
-    if (!DEBUG_PULSE1_MUTE)
+    uint32 tndLevel = (3 * triangle.getOutput() * channelGains[APU_TRIANGLE])
+        + (2 * noise.getOutput() * channelGains[APU_NOISE])
+        + (dmc.getOutput() * channelGains[APU_DMC]);
+
+    return pulseTable[pulseLevel] + tndTable[tndLevel];
+}
+
+void APU::setChannelGain(APUChannel channel, real32 gain)
+{
+    if (gain < 0.0f)
     {
-        pulseOutput += pulse1.getOutput();
+        gain = 0.0f;
     }
+    else if (gain > 1.0f)
+    {
+        gain = 1.0f;
+    }
+
+    channelGains[channel] = (uint32)((gain * MIXER_GAIN_UNIT) + 0.5f);
+    isOutputDirty = true;
+}
 
-    if (!DEBUG_PULSE2_MUTE)
+void APU::setMasterGain(real32 gain)
+{
+    // The blip buffer sums in 17.15 fixed point, so the mix (plus the kernel's overshoot) has to stay under 65536
+    if (gain < 0.0f)
+    {
+        gain = 0.0f;
+    }
+    else if (gain > 1.75f)
     {
-        pulseOutput += pulse2.getOutput();
+        gain = 1.75f;
     }
 
-    pulseOutput *= 0.00752f;
-    
-    real32 tndOut = 0.0f;
+    buildMixerTables(gain);
+    isOutputDirty = true;
+}
+
+void APU::buildMixerTables(real32 masterGain)
+{
+    // Straight from the formulas on the wiki, with the levels scaled back down from 16ths
+    real32 scale = 32767.0f * masterGain;
 
-    if (!DEBUG_TRIANGLE_MUTE)
+    pulseTable[0] = 0;
+    for (uint32 i = 1; i < MIXER_PULSE_TABLE_SIZE; ++i)
     {
-        tndOut += 0.00851f * triangle.getOutput();
+        real32 level = (real32)i / MIXER_GAIN_UNIT;
+        pulseTable[i] = (int32)((95.52f / ((8128.0f / level) + 100.0f)) * scale + 0.5f);
     }
 
-    if (!DEBUG_NOISE_MUTE)
+    tndTable[0] = 0;
+    for (uint32 i = 1; i < MIXER_TND_TABLE_SIZE; ++i)
     {
-        tndOut += 0.00494f * noise.getOutput();
+        real32 level = (real32)i / MIXER_GAIN_UNIT;
+        tndTable[i] = (int32)((163.67f / ((24329.0f / level) + 100.0f)) * scale + 0.5f);
     }
+}
 
-    if (!DEBUG_DMC_MUTE)
+void APU::updateOutput(uint32 time)
+{
+    if (!isOutputDirty)
     {
-        tndOut += 0.00335f * dmc.getOutput();
+        return;
     }
 
-    if (pulseOutput + tndOut > 1.0)
+    isOutputDirty = false;
+
+    int32 amplitude = getOutput();
+    if (amplitude != lastAmplitude)
+    {
+        output.addDelta(time, amplitude - lastAmplitude);
+        lastAmplitude = amplitude;
+    }
+}
+
+void APU::endFrame(uint32 time)
+{
+    output.endFrame(time);
+}
+
+uint32 APU::readSamples(int16* samples, uint32 count)
+{
+    // The mix is read out at full range and only clamped once the filters have centred it on zero,
+    // in chunks so the scratch space can live on the stack
+    int32 mixed[512];
+
+    uint32 read = 0;
+    while (read < count)
     {
-        return 1.0f;
+        uint32 chunk = count - read;
+        if (chunk > 512)
+        {
+            chunk = 512;
+        }
+
+        chunk = output.readSamples(mixed, chunk);
+        if (chunk == 0)
+        {
+            break;
+        }
+
+        filters.process(mixed, samples + read, chunk);
+        read += chunk;
     }
 
-    return pulseOutput + tndOut;
-}
\ No newline at end of file
+    return read;
+}
+
+void APU::serialize(SaveState* state)
+{
+    pulse1.serialize(state);
+    pulse2.serialize(state);
+    triangle.serialize(state);
+    noise.serialize(state);
+    dmc.serialize(state);
+
+    state->value(isFrameInteruptFlagSet);
+    state->value(frameCounter);
+    state->value(isFiveStepMode);
+    state->value(isInterruptInhibited);
+    state->value(frameCounterResetRequested);
+
+    // Everything could be different after a load, so the next update has to remix
+    if (state->isLoading())
+    {
+        isOutputDirty = true;
+    }
+}
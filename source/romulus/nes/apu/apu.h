@@ -5,6 +5,23 @@
 #include "triangleChannel.h"
 #include "noiseChannel.h"
 #include "deltaModulationChannel.h"
+#include "blipBuffer.h"
+#include "audioFilter.h"
+
+enum APUChannel
+{
+    APU_PULSE1,
+    APU_PULSE2,
+    APU_TRIANGLE,
+    APU_NOISE,
+    APU_DMC,
+    APU_CHANNEL_COUNT
+};
+
+// Levels going into the mixer are in 16ths so the per channel gains can scale them and still index the tables
+const uint32 MIXER_GAIN_UNIT = 16;
+const uint32 MIXER_PULSE_TABLE_SIZE = (30 * MIXER_GAIN_UNIT) + 1;
+const uint32 MIXER_TND_TABLE_SIZE = (((3 * 15) + (2 * 15) + 127) * MIXER_GAIN_UNIT) + 1;
 
 // References:
 // http://www.nesdev.com/wiki/2A03
@@ -12,7 +29,11 @@
 class APU
 {
 public:
+    // Sets up the audio output, everything starts at full volume with the console's filters
+    void init(uint32 clockRate, uint32 sampleRate);
 
+    // Clears every channel, reset leaves the timers and sequencers where they were like the real reset line does
+    void powerOn();
     void reset();
 
     void tick(uint32 cpuCycleCount);
@@ -26,13 +47,27 @@ public:
     // Write 0x4017
     void writeFrameCounterControl(uint8 value);
 
-    // Does the mixdown of all the channels at the current moment in time
-    // According to https://www.nesdev.org/wiki/APU_Mixer has a range of 0.0 - 1.0
-    real32 getOutput();
-    
+    // Does the mixdown of all the channels at the current moment in time, in 16 bit sample units
+    int32 getOutput();
+
+    // Gains are from 0.0 (muted) to 1.0 (as loud as the console)
+    void setChannelGain(APUChannel channel, real32 gain);
+    // Master gain can go up to 1.75, the output is clamped to 16 bits after filtering
+    void setMasterGain(real32 gain);
+
+    // Adds a step to the output buffer if the mix changed this cycle. Time is the master clock within the frame
+    void updateOutput(uint32 time);
+
+    // Finishes the frame's audio, then the samples can be read out (filtered) in as many pieces as needed
+    void endFrame(uint32 time);
+    uint32 samplesAvailable() { return output.samplesAvailable(); }
+    uint32 readSamples(int16* samples, uint32 count);
+
     void quarterClock();
     void halfClock();
 
+    void serialize(SaveState* state);
+
     PulseChannel pulse1;
     PulseChannel pulse2;
     TriangleChannel triangle;
@@ -47,4 +82,23 @@ public:
     bool isFiveStepMode;
     bool isInterruptInhibited;
     bool frameCounterResetRequested;
+
+    // Set by anything that could change a channel's output (sequencers stepping, frame counter clocks,
+    // register writes) so the channels only get remixed on cycles where something happened
+    bool isOutputDirty;
+    int32 lastAmplitude;
+
+    // Steps in the mixed output, turned into samples at the end of each frame
+    BlipBuffer output;
+    AudioFilter filters;
+
+private:
+    // https://www.nesdev.org/wiki/APU_Mixer#Lookup_Table with the master gain baked in
+    int32 pulseTable[MIXER_PULSE_TABLE_SIZE];
+    int32 tndTable[MIXER_TND_TABLE_SIZE];
+
+    // In MIXER_GAIN_UNITs
+    uint32 channelGains[APU_CHANNEL_COUNT];
+
+    void buildMixerTables(real32 masterGain);
 };
\ No newline at end of file
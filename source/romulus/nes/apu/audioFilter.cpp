@@ -0,0 +1,97 @@
+#include "audioFilter.h"
+
+void AudioFilter::setDefault(uint32 sampleRate)
+{
+    clear();
+    addHighPass(90.0f, sampleRate);
+    addHighPass(440.0f, sampleRate);
+    addLowPass(14000.0f, sampleRate);
+}
+
+void AudioFilter::clear()
+{
+    stageCount = 0;
+}
+
+bool AudioFilter::addHighPass(real32 cutoffHz, uint32 sampleRate)
+{
+    return addStage(true, cutoffHz, sampleRate);
+}
+
+bool AudioFilter::addLowPass(real32 cutoffHz, uint32 sampleRate)
+{
+    return addStage(false, cutoffHz, sampleRate);
+}
+
+bool AudioFilter::addStage(bool isHighPass, real32 cutoffHz, uint32 sampleRate)
+{
+    if (stageCount >= MAX_STAGES)
+    {
+        logError("Audio filter chain is full, can't add another stage\n");
+        return false;
+    }
+
+    // RC filter discretized with the sample period, see https://en.wikipedia.org/wiki/High-pass_filter
+    real32 rc = 1.0f / (2.0f * 3.14159265f * cutoffHz);
+    real32 dt = 1.0f / sampleRate;
+
+    Stage* stage = stages + stageCount++;
+    stage->isHighPass = isHighPass;
+    stage->coefficient = isHighPass ? rc / (rc + dt) : dt / (rc + dt);
+    stage->lastInput = 0.0f;
+    stage->lastOutput = 0.0f;
+
+    return true;
+}
+
+void AudioFilter::reset()
+{
+    for (uint32 i = 0; i < stageCount; ++i)
+    {
+        stages[i].lastInput = 0.0f;
+        stages[i].lastOutput = 0.0f;
+    }
+}
+
+void AudioFilter::process(const int32* input, int16* output, uint32 count)
+{
+    for (uint32 i = 0; i < count; ++i)
+    {
+        real32 value = (real32)input[i];
+
+        for (uint32 s = 0; s < stageCount; ++s)
+        {
+            Stage* stage = stages + s;
+            real32 stageInput = value;
+
+            if (stage->isHighPass)
+            {
+                value = stage->coefficient * (stage->lastOutput + stageInput - stage->lastInput);
+            }
+            else
+            {
+                value = stage->lastOutput + (stage->coefficient * (stageInput - stage->lastOutput));
+            }
+
+            // Way below what a 16 bit sample can show, but left alone silence decays into denormals which are really slow
+            if (value > -0.0001f && value < 0.0001f)
+            {
+                value = 0.0f;
+            }
+
+            stage->lastInput = stageInput;
+            stage->lastOutput = value;
+        }
+
+        if (value > 32767.0f)
+        {
+            value = 32767.0f;
+        }
+        else if (value < -32768.0f)
+        {
+            value = -32768.0f;
+        }
+
+        output[i] = (int16)value;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "romulus.h"
+
+// A chain of first order high and low pass filters run over the finished samples
+// The defaults match the filters between the apu and the audio out on the console
+// https://www.nesdev.org/wiki/APU_Mixer
+class AudioFilter
+{
+public:
+    static const uint32 MAX_STAGES = 4;
+
+    // Replaces the chain with the console's: high pass at 90hz and 440hz, low pass at 14khz
+    void setDefault(uint32 sampleRate);
+
+    // Removes every stage, leaving the samples untouched (other than clamping)
+    void clear();
+
+    // Stages run in the order they're added, returns false if the chain is full
+    bool addHighPass(real32 cutoffHz, uint32 sampleRate);
+    bool addLowPass(real32 cutoffHz, uint32 sampleRate);
+
+    // Forgets the previous samples without changing the chain (ex: on reset)
+    void reset();
+
+    // Filters the mixed samples into output, which is the one place they get clamped to 16 bits
+    void process(const int32* input, int16* output, uint32 count);
+
+private:
+    struct Stage
+    {
+        bool isHighPass;
+        real32 coefficient;
+
+        real32 lastInput;
+        real32 lastOutput;
+    };
+
+    Stage stages[MAX_STAGES];
+    uint32 stageCount;
+
+    bool addStage(bool isHighPass, real32 cutoffHz, uint32 sampleRate);
+};
@@ -0,0 +1,70 @@
+#include "audioRing.h"
+#include <string.h>
+
+void AudioRing::setSize(uint32 requestedSize)
+{
+    size = 1;
+    while (size < requestedSize && size < MAX_SIZE)
+    {
+        size <<= 1;
+    }
+
+    writeIndex.store(0);
+    readIndex.store(0);
+}
+
+uint32 AudioRing::getFillLevel()
+{
+    return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+}
+
+uint32 AudioRing::write(const int16* samples, uint32 count)
+{
+    // Only this side changes the write index, so it doesn't need to be synchronized with itself
+    uint32 index = writeIndex.load(std::memory_order_relaxed);
+    uint32 space = size - (index - readIndex.load(std::memory_order_acquire));
+    if (count > space)
+    {
+        count = space;
+    }
+
+    copyIn(index, samples, count);
+
+    // Release so the samples are visible before the reader can see the index past them
+    writeIndex.store(index + count, std::memory_order_release);
+    return count;
+}
+
+uint32 AudioRing::read(int16* samples, uint32 count)
+{
+    uint32 index = readIndex.load(std::memory_order_relaxed);
+    uint32 available = writeIndex.load(std::memory_order_acquire) - index;
+    if (count > available)
+    {
+        count = available;
+    }
+
+    copyOut(index, samples, count);
+
+    // Release so the writer doesn't reuse the space until the samples have been copied out
+    readIndex.store(index + count, std::memory_order_release);
+    return count;
+}
+
+void AudioRing::copyIn(uint32 index, const int16* samples, uint32 count)
+{
+    uint32 start = index & (size - 1);
+    uint32 firstPart = count < size - start ? count : size - start;
+
+    memcpy(buffer + start, samples, firstPart * sizeof(int16));
+    memcpy(buffer, samples + firstPart, (count - firstPart) * sizeof(int16));
+}
+
+void AudioRing::copyOut(uint32 index, int16* samples, uint32 count)
+{
+    uint32 start = index & (size - 1);
+    uint32 firstPart = count < size - start ? count : size - start;
+
+    memcpy(samples, buffer + start, firstPart * sizeof(int16));
+    memcpy(samples + firstPart, buffer, (count - firstPart) * sizeof(int16));
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "romulus.h"
+#include <atomic>
+
+// Hands samples from the emulator to the audio device without any locking
+// Safe with exactly one thread writing (the one running the console) and one reading (ex: the device callback)
+// Each side only ever moves its own index, and the other side sees the samples before it sees the index move.
+class AudioRing
+{
+public:
+    static const uint32 MAX_SIZE = 32768;
+
+    // Rounded up to a power of two so the indices can just keep counting and wrap, and capped at MAX_SIZE
+    // Empties the ring, so only call this while nothing is reading or writing
+    void setSize(uint32 size);
+    uint32 getSize() { return size; }
+
+    // Samples written but not read yet. Can be called from either side, but is only a snapshot
+    uint32 getFillLevel();
+
+    // Producer side, returns how many fit. Anything past that is dropped rather than overwriting unread samples
+    uint32 write(const int16* samples, uint32 count);
+
+    // Consumer side, returns how many were there to read
+    uint32 read(int16* samples, uint32 count);
+
+private:
+    int16 buffer[MAX_SIZE];
+    uint32 size;
+
+    std::atomic<uint32> writeIndex;
+    std::atomic<uint32> readIndex;
+
+    void copyIn(uint32 index, const int16* samples, uint32 count);
+    void copyOut(uint32 index, int16* samples, uint32 count);
+};
@@ -0,0 +1,127 @@
+#include "blipBuffer.h"
+#include <math.h>
+#include <string.h>
+
+// One band limited impulse for each fraction of a sample the step can land on
+struct BlipKernel
+{
+    int16 taps[BlipBuffer::PHASE_COUNT][BlipBuffer::KERNEL_WIDTH];
+
+    BlipKernel()
+    {
+        const real64 pi = 3.14159265358979323846;
+
+        // Cut off a bit under nyquist so the window has room to roll off before it
+        const real64 cutoff = 0.9;
+        const real64 unit = (real64)(1 << 15);
+        const int32 width = BlipBuffer::KERNEL_WIDTH;
+
+        for (int32 phase = 0; phase < (int32)BlipBuffer::PHASE_COUNT; ++phase)
+        {
+            real64 center = (width / 2) - 1 + ((real64)phase / BlipBuffer::PHASE_COUNT);
+
+            real64 values[BlipBuffer::KERNEL_WIDTH];
+            real64 total = 0.0;
+            for (int32 i = 0; i < width; ++i)
+            {
+                // Windowed sinc, blackman window centered on the step
+                real64 x = i - center;
+                real64 sinc = x == 0.0 ? 1.0 : sin(pi * cutoff * x) / (pi * cutoff * x);
+                real64 windowPosition = (x / width) + 0.5;
+                real64 window = 0.42 - (0.5 * cos(2.0 * pi * windowPosition)) + (0.08 * cos(4.0 * pi * windowPosition));
+                values[i] = sinc * window;
+                total += values[i];
+            }
+
+            // Every phase has to add up to exactly one step, otherwise the rounding error
+            // builds up as a dc offset that drifts with every change in amplitude
+            int32 sum = 0;
+            for (int32 i = 0; i < width; ++i)
+            {
+                taps[phase][i] = (int16)floor((values[i] / total * unit) + 0.5);
+                sum += taps[phase][i];
+            }
+
+            taps[phase][width / 2] += (int16)((int32)unit - sum);
+        }
+    }
+};
+
+void BlipBuffer::setRates(uint32 clockRate, uint32 sampleRate)
+{
+    baseFactor = ((real64)sampleRate / clockRate) * (1ull << TIME_BITS);
+    factor = (uint64)baseFactor;
+
+    // Built the first time any console needs it and shared after that
+    static const BlipKernel blipKernel;
+    kernel = blipKernel.taps;
+
+    clear();
+}
+
+void BlipBuffer::adjustSampleRate(real64 ratio)
+{
+    factor = (uint64)(baseFactor * ratio);
+}
+
+void BlipBuffer::clear()
+{
+    offset = 0;
+    integrator = 0;
+    memset(impulses, 0, sizeof(impulses));
+}
+
+void BlipBuffer::addDelta(uint32 time, int32 delta)
+{
+    uint64 position = offset + (time * factor);
+    uint32 index = (uint32)(position >> TIME_BITS);
+    uint32 phase = (uint32)(position >> (TIME_BITS - PHASE_BITS)) & (PHASE_COUNT - 1);
+
+    // Frames longer than the buffer lose the audio past the end
+    if (index >= MAX_SAMPLES)
+    {
+        return;
+    }
+
+    const int16* taps = kernel[phase];
+    int32* out = impulses + index;
+    for (uint32 i = 0; i < KERNEL_WIDTH; ++i)
+    {
+        out[i] += taps[i] * delta;
+    }
+}
+
+void BlipBuffer::endFrame(uint32 time)
+{
+    offset += time * factor;
+
+    if (samplesAvailable() > MAX_SAMPLES)
+    {
+        offset = (uint64)MAX_SAMPLES << TIME_BITS;
+    }
+}
+
+uint32 BlipBuffer::readSamples(int32* output, uint32 count)
+{
+    if (count > samplesAvailable())
+    {
+        count = samplesAvailable();
+    }
+
+    int32 sum = integrator;
+    for (uint32 i = 0; i < count; ++i)
+    {
+        sum += impulses[i];
+        output[i] = sum >> KERNEL_BITS;
+    }
+
+    integrator = sum;
+
+    // Slide whatever is left (unread samples, the partial one, and the tails of the last impulses) back to the start
+    uint32 remaining = samplesAvailable() - count + KERNEL_WIDTH;
+    memmove(impulses, impulses + count, remaining * sizeof(int32));
+    memset(impulses + remaining, 0, count * sizeof(int32));
+    offset -= (uint64)count << TIME_BITS;
+
+    return count;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "romulus.h"
+
+// Band limited step synthesis, see http://www.slack.net/~ant/bl-synth/
+// Rather than sampling the mixer output at the sample rate (which aliases anything above 24khz back down
+// into what you can hear), the apu adds a step here each time its output changes, at the clock it changed on.
+// Each step is drawn into the buffer as a band limited impulse, then the samples for the whole frame are made
+// in one pass by summing the impulses back up into a waveform.
+class BlipBuffer
+{
+public:
+    static const uint32 KERNEL_WIDTH = 16;
+    static const uint32 PHASE_BITS = 5;
+    static const uint32 PHASE_COUNT = 1 << PHASE_BITS;
+
+    // Longest frame that can be buffered before samples have to be read out (~170ms at 48khz)
+    static const uint32 MAX_SAMPLES = 8192;
+
+    void setRates(uint32 clockRate, uint32 sampleRate);
+
+    // Scales the sample rate by a small amount (ex: 1.005), for keeping up with an audio device running a little fast or slow
+    // Only safe between frames
+    void adjustSampleRate(real64 ratio);
+
+    void clear();
+
+    // Time is in clocks since the start of the current frame, delta is the change in amplitude
+    void addDelta(uint32 time, int32 delta);
+
+    // Marks the given number of clocks as finished, making their samples available to read
+    void endFrame(uint32 time);
+
+    uint32 samplesAvailable() { return (uint32)(offset >> TIME_BITS); }
+
+    // Returns the number of samples actually read. They aren't clamped, the mix only fits in 16 bits once
+    // the filters have taken out its dc offset
+    uint32 readSamples(int32* output, uint32 count);
+
+private:
+    static const uint32 TIME_BITS = 32;
+    static const uint32 KERNEL_BITS = 15;
+
+    // Samples per clock as 32.32 fixed point, and what it is before any adjustment
+    uint64 factor;
+    real64 baseFactor;
+
+    // Position of the start of the frame from the start of the buffer, as 32.32 fixed point samples
+    uint64 offset;
+
+    // Running sum of the impulses read so far, which is the current amplitude
+    int32 integrator;
+
+    const int16 (*kernel)[KERNEL_WIDTH];
+
+    int32 impulses[MAX_SAMPLES + KERNEL_WIDTH];
+};
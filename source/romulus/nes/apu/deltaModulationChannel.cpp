@@ -145,4 +145,24 @@ void DeltaModulationChannel::loadSample(uint8 sample)
             isInterruptFlagSet = true;
         }
     }
-}
\ No newline at end of file
+}
+
+void DeltaModulationChannel::serialize(SaveState* state)
+{
+    state->value(isInterruptFlagSet);
+    state->value(isEnabled);
+    state->value(irqEnabled);
+    state->value(isLooping);
+    state->value(sampleAddress);
+    state->value(sampleLength);
+    state->value(outputLevel);
+    state->value(currentAddress);
+    state->value(bytesRemaining);
+    state->value(sampleBuffer);
+    state->value(sampleBufferFilled);
+    state->value(outputShiftRegister);
+    state->value(bitsRemaining);
+    state->value(silenceActive);
+    state->value(timerLength);
+    state->value(timerCurrentTick);
+}
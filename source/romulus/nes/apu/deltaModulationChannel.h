@@ -1,5 +1,6 @@
 #pragma once
 #include "romulus.h"
+#include "saveState.h"
 
 // https://www.nesdev.org/wiki/APU_DMC
 class DeltaModulationChannel
@@ -23,6 +24,9 @@ public:
 
     uint16 getBytesRemaining() { return bytesRemaining; }
     uint8 getOutput() { return outputLevel; }
+    bool isIrqEnabled() { return irqEnabled; }
+
+    void serialize(SaveState* state);
 
 private:
     uint8 isEnabled;
@@ -47,4 +47,14 @@ uint8 Envelope::getOutput()
     }
 
     return decay;
-}
\ No newline at end of file
+}
+
+void Envelope::serialize(SaveState* state)
+{
+    state->value(volume);
+    state->value(isStartFlagSet);
+    state->value(isLoopFlagSet);
+    state->value(useConstantVolume);
+    state->value(divider);
+    state->value(decay);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "romulus.h"
+#include "saveState.h"
 
 // The envelope unit outputs either a constant volume or a decreasing sawtooth wave
 // See https://www.nesdev.org/wiki/APU_Envelope
@@ -11,6 +12,8 @@ public:
     void tick();
     uint8 getOutput();
 
+    void serialize(SaveState* state);
+
 private:
     // Constant ouput, and/or sets the period for the "divider"
     // also called the "envelope parameter" in the wiki
@@ -1,5 +1,6 @@
 #pragma once
 #include "romulus.h"
+#include "saveState.h"
 
 struct LengthCounter
 {
@@ -13,4 +14,10 @@ struct LengthCounter
 
     // NOTE: This may be wrong, theres mention of the channel being silenced on becoming 0 rather than if zero
     inline bool active() { return value > 0; }
+
+    void serialize(SaveState* state)
+    {
+        state->value(value);
+        state->value(isHalted);
+    }
 };
\ No newline at end of file
@@ -93,3 +93,14 @@ uint8 NoiseChannel::getOutput()
 
     return 0;
 }
+
+void NoiseChannel::serialize(SaveState* state)
+{
+    state->value(isEnabled);
+    lengthCounter.serialize(state);
+    state->value(timerLength);
+    state->value(timerCurrentTick);
+    state->value(mode);
+    state->value(shiftRegister);
+    envelope.serialize(state);
+}
@@ -17,6 +17,8 @@ struct NoiseChannel
 
     uint8 getOutput();
 
+    void serialize(SaveState* state);
+
     uint8 isEnabled;
 
     LengthCounter lengthCounter;
@@ -157,3 +157,21 @@ uint8 PulseChannel::getOutput()
 
     return envelope.getOutput();
 }
+
+void PulseChannel::serialize(SaveState* state)
+{
+    state->value(isEnabled);
+    state->value(dutyCycle);
+    state->value(dutySequenceIndex);
+    lengthCounter.serialize(state);
+    state->value(timerLength);
+    state->value(timerCurrentTick);
+    envelope.serialize(state);
+
+    state->value(sweep.isEnabled);
+    state->value(sweep.isNegateFlagSet);
+    state->value(sweep.dividerPeriod);
+    state->value(sweep.shiftCount);
+    state->value(sweep.isReloadFlagSet);
+    state->value(sweep.dividerValue);
+}
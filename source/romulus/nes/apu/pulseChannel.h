@@ -37,6 +37,8 @@ public:
 
     bool isSweepMuting();
 
+    void serialize(SaveState* state);
+
     uint8 isEnabled;
 
     uint8 dutyCycle;
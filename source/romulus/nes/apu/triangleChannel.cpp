@@ -91,3 +91,16 @@ uint8 TriangleChannel::getOutput()
 {
     return triangleSequence[sequenceIndex];
 }
+
+void TriangleChannel::serialize(SaveState* state)
+{
+    state->value(isEnabled);
+    lengthCounter.serialize(state);
+    state->value(isControlFlagSet);
+    state->value(isLinearReloadFlagSet);
+    state->value(linearCounter);
+    state->value(linearReloadValue);
+    state->value(timerLength);
+    state->value(timerCurrentTick);
+    state->value(sequenceIndex);
+}
@@ -16,6 +16,8 @@ struct TriangleChannel
     void tickLinearCounter();
 
     uint8 getOutput();
+
+    void serialize(SaveState* state);
     
     uint8 isEnabled;
 
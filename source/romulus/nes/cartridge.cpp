@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "log.h"
+#include "mappers/nrom.h"
 
 // PRG = cartridge side connected to the cpu
 // CHR = cartridge side connected to the ppu
@@ -31,21 +32,41 @@ struct NSFHeader
 };
 #pragma pack(pop)
 
-bool Cartridge::loadNSF(uint8* buffer, uint32 length)
+bool Cartridge::loadNSF(const uint8* buffer, uint32 length)
 {
-    isNSF = true;
-
     // NSF File
-    NSFHeader* header = (NSFHeader*)buffer;
+    const NSFHeader* header = (const NSFHeader*)buffer;
     buffer += sizeof(NSFHeader);
 
+    uint32 dataLength = length - sizeof(NSFHeader);
+    if (header->loadAddress < 0x8000 || (header->loadAddress - 0x8000) + dataLength > sizeof(backingRom))
+    {
+        logError("Load Failed: NSF data doesn't fit at $%04X (%u bytes)\n", header->loadAddress, dataLength);
+        return false;
+    }
+
+    isNSF = true;
     initAddress = header->initAddress;
     playAddress = header->playAddress;
     playSpeed = header->playSpeedNtsc;
 
     // Non zero means theres extra stuff to parse for NSF 2.0 and that doesn't matter yet
     // TODO: assert(header->programDataLength == 0);
-    memcpy(backingRom + (header->loadAddress - 0x8000), buffer, length - sizeof(NSFHeader));
+    memcpy(backingRom + (header->loadAddress - 0x8000), buffer, dataLength);
+
+    // The backing rom is laid out like a 32kb NROM board so it can share the same code
+    MapperConfig config = {};
+    config.prgRomSize = 2;
+    config.prgRom = backingRom;
+    config.chrBase = chrRam;
+    config.defaultMirroring = MIRROR_HORIZONTAL;
+
+    mapper = new NROM();
+    mapper->load(config);
+    tileCache.init(chrRam, sizeof(chrRam));
+
+    // NSF never goes through reset, so the pages have to be pointed at the backing rom here
+    reset();
     return true;
 }
 
@@ -69,9 +90,9 @@ union INESHeader
     uint8 rawBytes[15];
 };
 
-bool Cartridge::loadINES(const char* filepath, uint8* buffer, uint32 length)
+bool Cartridge::loadINES(const char* filepath, const uint8* buffer, uint32 length)
 {
-    INESHeader* header = (INESHeader*)buffer;
+    const INESHeader* header = (const INESHeader*)buffer;
     buffer += sizeof(INESHeader);
 
     prgRomSize = header->prgRomSize;
@@ -135,41 +156,20 @@ bool Cartridge::loadINES(const char* filepath, uint8* buffer, uint32 length)
         buffer += 512;
     }
 
-    if (mapperNumber == 0)
-    {
-        logInfo("Mapper: 000 NROM\n");
-    }
-    else if (mapperNumber == 1)
-    {
-        logInfo("Mapper: 001 MMC1\n");
-    }
-    else if (mapperNumber == 2)
-    {
-        logInfo("Mapper: 002 UxROM\n");
-    }
-    else if (mapperNumber == 3)
-    {
-        logInfo("Mapper: 003 CNROM\n");
-    }
-    else if (mapperNumber == 4)
-    {
-        logInfo("Mapper: 004 MMC3 (Incomplete)\n");
-    }
-    else if (mapperNumber == 7)
-    {
-        logInfo("Mapper: 007 AxROM\n");
-    }
-    else if (mapperNumber == 9)
-    {
-        logInfo("Mapper: 009 MMC2\n");
-    }
-    else
+    mapper = createMapper(mapperNumber);
+    if (!mapper)
     {
         logError("Load Failed: Unhandled Mapper (%d)\n", mapperNumber);
+        return false;
     }
 
+    logInfo("Mapper: %03d %s\n", mapperNumber, mapper->getName());
+
     logInfo("PRG Size: %d x 16kb = %dkb, CHR Size %d x 8kb = %dkb\n", prgRomSize, prgRomSize * 16, chrRomSize, chrRomSize * 8);
 
+    // The image is mapped read only and shared with other consoles. Nothing writes to rom banks (the cpu write
+    // pages never point at them and chr writes are dropped with chr rom), and a stray write would fault rather
+    // than quietly corrupt every console running the game
     prgRom = (uint8*)buffer;
 
     buffer += header->prgRomSize * kilobytes(16);
@@ -179,16 +179,14 @@ bool Cartridge::loadINES(const char* filepath, uint8* buffer, uint32 length)
     {
         chrRom = (uint8*)buffer;
         chrBase = chrRom;
-        mmc3ChrBankMask = (chrRomSize * 8) - 1;
     }
     else
     {
         // means we have no chr space on the cart and should use the system ram
         chrBase = chrRam;
-        mmc3ChrBankMask = 7;
     }
 
-    if (hasPerisitantMemory)
+    if (hasPerisitantMemory && !isSaveFileDisabled)
     {
         // Check for the existance of a sav file
         char* ptr = saveFilePath;
@@ -220,6 +218,21 @@ bool Cartridge::loadINES(const char* filepath, uint8* buffer, uint32 length)
         }
     }
 
+    MapperConfig config = {};
+    config.prgRomSize = prgRomSize;
+    config.prgRom = prgRom;
+    config.chrRomSize = chrRomSize;
+    config.chrRom = chrRom;
+    config.chrBase = chrBase;
+    config.defaultMirroring = useVerticalMirroring ? MIRROR_VERTICAL : MIRROR_HORIZONTAL;
+    mapper->load(config);
+
+    chrRomTiles = chrRomSize > 0 ? romImage->chrTiles : 0;
+    if (!chrRomTiles)
+    {
+        tileCache.init(chrRam, sizeof(chrRam));
+    }
+
     reset();
 
     return true;
@@ -229,35 +242,34 @@ bool Cartridge::load(const char* file)
 {
     // TODO: Change this to separate out the act of reading and determining file type etc
     // from loading into the respective "emulator", so we can handle more than one
-    if (fileMemory)
+    if (romImage)
     {
         unload();
     }
 
-    FILE* testFile = fopen(file, "rb");
-    if (!testFile)
+    RomStore* store = romStore ? romStore : &ownRoms;
+    romImage = store->acquire(file);
+    if (!romImage)
     {
         return false;
     }
 
-    fseek(testFile, 0, SEEK_END);
-    size_t fileSize = ftell(testFile);
-    rewind(testFile);
-
-    // TODO: Change the allocation strategy to use a large fixed buffer with custom suballocators, like what a game engine would do
-    // It just makes adding debugging and leak tracking code easier, you can put in sentinals, overallocate, know what pointers go where, etc.
-    fileMemory = new uint8[fileSize];
-    size_t bytesRead = fread(fileMemory, sizeof(uint8), fileSize, testFile);
-    fclose(testFile);
+    romHash = romImage->hash;
 
     bool isLoaded = false;
-    if (*((uint32*)fileMemory) == 0x4d53454e)
+    if (romImage->format == ROM_NSF)
+    {
+        isLoaded = loadNSF(romImage->data, romImage->size);
+    }
+    else if (romImage->format == ROM_INES)
     {
-        isLoaded = loadNSF(fileMemory, (uint32)fileSize);
+        isLoaded = loadINES(file, romImage->data, romImage->size);
     }
-    else if (*((uint32*)fileMemory) == 0x1a53454e)
+
+    // Let go of the image rather than hold it until the next load
+    if (!isLoaded)
     {
-        isLoaded = loadINES(file, fileMemory, (uint32)fileSize);
+        unload();
     }
 
     return isLoaded;
@@ -265,7 +277,7 @@ bool Cartridge::load(const char* file)
 
 void Cartridge::unload()
 {
-    if (hasPerisitantMemory)
+    if (hasPerisitantMemory && !isSaveFileDisabled)
     {
         // TODO: Cart can have more or less ram that is bank switched in depending on the mapper
         // Curently it's just a full 8k array backing the whole address range
@@ -278,7 +290,16 @@ void Cartridge::unload()
         }
     }
 
-    // TODO: Wipe RAM to a default power cycled state
+    // Back to the zeroed state a new cartridge starts in, so nothing from this rom shows up in the next one
+    memset(cartRam, 0, sizeof(cartRam));
+    memset(chrRam, 0, sizeof(chrRam));
+    memset(backingRom, 0, sizeof(backingRom));
+
+    isNSF = false;
+    initAddress = 0;
+    playAddress = 0;
+    playSpeed = 0;
+    romHash = 0;
 
     prgRomSize = 0;
     chrRomSize = 0;
@@ -287,605 +308,152 @@ void Cartridge::unload()
     prgRom = 0;
     chrRom = 0;
     chrBase = 0;
+    chrRomTiles = 0;
 
     useVerticalMirroring = 0;
     hasPerisitantMemory = 0;
     hasFullVram = 0;
     saveFilePath[0] = '\0';
 
-    if (fileMemory)
-    {
-        delete fileMemory;
-        fileMemory = 0;
-    }
-}
-
-uint8 Cartridge::prgRead(uint16 address)
-{
-    if (!isReadOnly)
-    {
-        ignoreNextWrite = false;
-    }
-
-    if (address < 0x6000)
-    {
-        return 0;
-    }
-
-    if (address < 0x8000)
-    {
-        return cartRam[address - 0x6000];
-    }
-
-    if (isNSF)
-    {
-        return backingRom[address - 0x8000];
-    }
+    clearPrgPages();
+    tileCache.shutdown();
 
-    if (mapperNumber == 4)
-    {
-        uint8* selectedBank = mmc3PrgRomBanks[(address & 0x6000) >> 13];
-        return selectedBank[address & 0x1FFF];
-    }
-    else if (mapperNumber == 9)
+    if (mapper)
     {
-        if (address < 0xA000)
-        {
-            return prgRomBank1[address - 0x8000];
-        }
-
-        return prgRomBank2[address - 0xA000];
+        delete mapper;
+        mapper = 0;
+        cpuTickMapper = 0;
     }
 
-    if (address < 0xC000)
+    if (romImage)
     {
-        return prgRomBank1[address - 0x8000];
+        RomStore* store = romStore ? romStore : &ownRoms;
+        store->release(romImage);
+        romImage = 0;
     }
-
-    return prgRomBank2[address - 0xC000];
 }
 
-bool Cartridge::prgWrite(uint16 address, uint8 value)
+void Cartridge::connectPages(uint8** readPages, uint8** writePages)
 {
-    if (address < 0x6000)
-    {
-        return false;
-    }
-
-    if (address < 0x8000)
-    {
-        cartRam[address - 0x6000] = value;
-        return true;
-    }
-
-    // Mappers take advantage of the fact that the upper section
-    // of memory is (typically) ROM and thus unwritable. The write request
-    // is intercepted and shoved off to another set of chips that
-    // can change the configuration of the mapper.
-
-    // MMC1
-    // TODO: Handle variants based on chip sizes https://www.nesdev.org/wiki/MMC1#iNES_Mapper_001
-    if (mapperNumber == 1)
-    {
-        if (ignoreNextWrite)
-        {
-            return false;
-        }
-
-        ignoreNextWrite = true;
-
-        if (value & BIT_7)
-        {
-            mmc1ShiftRegister = BIT_4;
-            mmc1Control |= 0x0C;
-            mmc1RemapPrg();
-        }
-        else 
-        {
-            bool isFifthWrite = mmc1ShiftRegister & BIT_0;
-
-            // Every write we load bit 0 into the left side of the register
-            mmc1ShiftRegister >>= 1;
-            mmc1ShiftRegister |= (value & BIT_0) << 4;
+    cpuReadPages = readPages;
+    cpuWritePages = writePages;
+}
 
-            // Load into the right internal register based on bits 13 and 14 of the address
-            if (isFifthWrite)
-            {
-                uint16 selectBits = (address >> 13) & 0x0003;
-                if (selectBits == 0)
-                {
-                    mmc1Control = mmc1ShiftRegister;
-
-                    uint8 mirroring = mmc1Control & 0x03;
-                    if (mirroring == 0)
-                    {
-                        mirrorMode = SINGLE_SCREEN_LOWER;
-                    }
-                    else if (mirroring == 1)
-                    {
-                        mirrorMode = SINGLE_SCREEN_UPPER;
-                    }
-                    else if (mirroring == 2)
-                    {
-                        mirrorMode = MIRROR_VERTICAL;
-                    }
-                    else
-                    {
-                        mirrorMode = MIRROR_HORIZONTAL;
-                    }
-
-                    // Need to reset all the pointers in case the mode has changed (Could check if its
-                    // changed but that just more overhead potentially)
-                    mmc1RemapPrg();
-                    mmc1RemapChr();
-                }
-                else if (selectBits == 1)
-                {
-                    mmc1Chr0 = mmc1ShiftRegister;
-                    mmc1RemapChr();
-                }
-                else if (selectBits == 2)
-                {
-                    mmc1Chr1 = mmc1ShiftRegister;
-                    mmc1RemapChr();
-                }
-                else if (selectBits == 3)
-                {
-                    mmc1PrgBank = (mmc1ShiftRegister & 0x0F);
-                    mmc1RemapPrg();
-                }
-
-                mmc1ShiftRegister = BIT_4;
-            }
-        }
-    }
-    // UxROM varieties are a direct mapping
-    else if (mapperNumber == 2)
-    {
-        prgRomBank1 = prgRom + kilobytes(16) * value;
-    }
-    else if (mapperNumber == 3)
-    {
-        // TODO: Theres a note on the wiki mentioning larger size variants, may be another mapper?
-        patternTable0 = chrRom + (kilobytes(8) * (value & 0x03));
-        patternTable1 = patternTable0 + kilobytes(4);
-    }
-    else if (mapperNumber == 4)
+void Cartridge::clearPrgPages()
+{
+    if (!cpuReadPages)
     {
-        mmc3PrgWrite(address, value);
+        return;
     }
-    // AxROM
-    else if (mapperNumber == 7)
-    {
-        uint8 bank = value & 0x07;
-        prgRomBank1 = prgRom + (bank * kilobytes(32));
-        prgRomBank2 = prgRomBank1 + kilobytes(16);
 
-        if (value & BIT_4)
-        {
-            mirrorMode = SINGLE_SCREEN_UPPER;
-        }
-        else
-        {
-            mirrorMode = SINGLE_SCREEN_LOWER;
-        }
-    }
-    // MMC2
-    else if (mapperNumber == 9)
+    for (int page = 0x40; page < 0x100; ++page)
     {
-        uint16 registerSelect = address & 0xF000;
-        if (registerSelect == 0xA000)
-        {
-            prgRomBank1 = prgRom + (kilobytes(8) * (value & 0x0F));
-        }
-        else if (registerSelect == 0xB000)
-        {
-            mmc2ChrRom0FD = chrRom + (kilobytes(4) * (value & 0x1F));
-            patternTable0 = mmc2ChrRom0FD;
-        }
-        else if (registerSelect == 0xC000)
-        {
-            mmc2ChrRom0FE = chrRom + (kilobytes(4) * (value & 0x1F));
-            patternTable0 = mmc2ChrRom0FE;
-        }
-        else if (registerSelect == 0xD000)
-        {
-            mmc2ChrRom1FD = chrRom + (kilobytes(4) * (value & 0x1F));
-            if (mmc2ChrLatch1 == 0xFD)
-            {
-                patternTable1 = mmc2ChrRom1FD;
-            }
-        }
-        else if (registerSelect == 0xE000)
-        {
-            mmc2ChrRom1FE = chrRom + (kilobytes(4) * (value & 0x1F));
-            if (mmc2ChrLatch1 == 0xFE)
-            {
-                patternTable1 = mmc2ChrRom1FE;
-            }
-        }
-        else if (registerSelect == 0xF000)
-        {
-            if (value & BIT_0)
-            {
-                mirrorMode = MIRROR_HORIZONTAL;
-            }
-            else
-            {
-                mirrorMode = MIRROR_VERTICAL;
-            }
-        }
+        cpuReadPages[page] = 0;
+        cpuWritePages[page] = 0;
     }
-
-    return false;
 }
 
-uint8 Cartridge::chrRead(uint16 address)
+void Cartridge::mapPrgPages()
 {
-    if (mapperNumber == 4)
+    clearPrgPages();
+    if (!cpuReadPages || !mapper)
     {
-        bool isPatternTableHi = address & 0x1000;
-        mmc3SetAddress(address);
-
-        // TODO: THIS IS GROSS. WHY DID I DO THIS?
-        // Answer: Cause its the dumb way that you know will work and you
-        // can clean it up later
-        // Don't direct compare! Since these are both masked out values it may not work?
-        if ((mmc3Chr2KBanksAreHigh && isPatternTableHi)
-            || (!mmc3Chr2KBanksAreHigh && !isPatternTableHi))
-        {
-            return mmc3ChrRomBanks[(address & 0x0800) >> 11][address & 0x07FF];
-        }
-        
-        return mmc3ChrRomBanks[((address & 0x0C00) >> 10) + 2][address & 0x03FF];
+        return;
     }
 
-    uint8 result = 0;
-    if (address < 0x1000)
+    // Writes to ram never have side effects
+    for (int page = 0x60; page < 0x80; ++page)
     {
-        result = patternTable0[address];
+        cpuWritePages[page] = cartRam + ((page - 0x60) << 8);
     }
-    else
+
+    // The bus turns off direct reads while debugging, and some mappers need to see the reads, so leave those to prgRead
+    if (isReadOnly || mapper->hasPrgReadSideEffects())
     {
-        result = patternTable1[address - 0x1000];
+        return;
     }
 
-    // Check has to happen after the read
-    if (!isReadOnly && mapperNumber == 9)
+    for (int page = 0x60; page < 0x80; ++page)
     {
-        if (address == 0x0FD8)
-        {
-            mmc2ChrLatch0 = 0xFD;
-            patternTable0 = mmc2ChrRom0FD;
-        }
-        else if (address == 0x0FE8)
-        {
-            mmc2ChrLatch0 = 0xFE;
-            patternTable0 = mmc2ChrRom0FE;
-        }
-        else if (address >= 0x1FD8 && address <= 0x1FDF)
-        {
-            mmc2ChrLatch1 = 0xFD;
-            patternTable1 = mmc2ChrRom1FD;
-        }
-        else if (address >= 0x1FE8 && address <= 0x1FEF)
-        {
-            mmc2ChrLatch1 = 0xFE;
-            patternTable1 = mmc2ChrRom1FE;
-        }
+        cpuReadPages[page] = cartRam + ((page - 0x60) << 8);
     }
 
-    return result;
-}
-
-bool Cartridge::chrWrite(uint16 address, uint8 value)
-{
-    mmc3SetAddress(address);
-
-    if (chrBase == chrRam)
+    for (int page = 0x80; page < 0x100; ++page)
     {
-        if (address < 0x1000)
-        {
-            patternTable0[address] = value;
-        }
-        else
-        {
-            patternTable1[address - 0x1000] = value;
-        }
+        cpuReadPages[page] = mapper->prgMemory((uint16)(page << 8));
     }
-
-    return true;
 }
 
-void Cartridge::reset()
+uint8 Cartridge::prgRead(uint16 address)
 {
-    isReadOnly = false;
-
-    // NOTE: These default pointers seem to work for several mappers
- 
-    // 0x8000 on the first bank and 0xC000 mapped to the last one
-    prgRomBank1 = prgRom;
-    prgRomBank2 = prgRom + kilobytes(16) * (prgRomSize - 1);
-
-    // Mapped as if there's no switching
-    patternTable0 = chrBase;
-    patternTable1 = chrBase + kilobytes(4);
-
-    mirrorMode = MIRROR_HORIZONTAL;
-    if (useVerticalMirroring)
+    if (!isReadOnly && mapper->hasPrgReadSideEffects())
     {
-        mirrorMode = MIRROR_VERTICAL;
+        mapper->onPrgRead();
+        mapPrgPages();
     }
 
-    if (mapperNumber == 1)
-    {
-        mmc1Reset();
-    }
-    else if (mapperNumber == 4)
-    {
-        mmc3Reset();
-    }
-    else if (mapperNumber == 7)
-    {
-        // Mapper 7 switches on 32 kb instead of 16
-        prgRomBank1 = prgRom;
-        prgRomBank2 = prgRomBank1 + kilobytes(16);
-
-        mirrorMode = SINGLE_SCREEN_LOWER;
-    }
-    else if (mapperNumber == 9)
+    if (address < 0x6000)
     {
-        prgRomBank2 = prgRom + (kilobytes(16) * prgRomSize) - (kilobytes(8) * 3);
-
-        mmc2ChrLatch0 = 0xFE;
-        mmc2ChrLatch1 = 0xFE;
-
-        // Default these to use the same banks for now
-        mmc2ChrRom0FD = chrRom;
-        mmc2ChrRom1FD = chrRom + kilobytes(4);
-
-        mmc2ChrRom0FE = chrRom;
-        mmc2ChrRom1FE = chrRom + kilobytes(4);
+        return 0;
     }
-}
 
-void Cartridge::mmc1Reset()
-{
-    ignoreNextWrite = false;
-    mmc1ShiftRegister = BIT_4;
-
-    // Horizontal by default
-    mmc1Control = 3;
-    if (mirrorMode == MIRROR_VERTICAL)
+    if (address < 0x8000)
     {
-        mmc1Control = 2;
+        return cartRam[address - 0x6000];
     }
 
-    // Going to default the ROM bank mode to be similar to UxROM for now
-    // That means first bank movable, second bank fixed on the last ROM chip
-    mmc1Control |= 0x0C;
-    mmc1PrgBank = 0;
-
-    // CHR config can stay on the zero induced default of 8kb for now
-    mmc1Chr0 = 0;
-    mmc1Chr1 = 0;
-
-    // Reset the pointers based on the rules
-    mmc1RemapPrg();
-    mmc1RemapChr();
+    return *mapper->prgMemory(address);
 }
 
-void Cartridge::mmc1RemapPrg()
+bool Cartridge::prgWrite(uint16 address, uint8 value)
 {
-    assert(mmc1PrgBank < prgRomSize)
-
-    uint8 mode = (mmc1Control >> 2) & 0x03;
-    if (mode == 2)
-    {
-        prgRomBank1 = prgRom;
-        prgRomBank2 = prgRom + (mmc1PrgBank * kilobytes(16));
-    }
-    else if (mode == 3)
-    {
-        prgRomBank1 = prgRom + (mmc1PrgBank * kilobytes(16));
-        prgRomBank2 = prgRom + (kilobytes(16) * (prgRomSize - 1));
-    }
-    else
+    if (address < 0x6000)
     {
-        prgRomBank1 = prgRom + ((mmc1PrgBank & 0xFE) * kilobytes(16));
-        prgRomBank2 = prgRomBank1 + kilobytes(16);
+        return false;
     }
-}
 
-void Cartridge::mmc1RemapChr()
-{
-    // CHR ROM mode (0: single 8kb bank, 1: 2 x 4kb banks)
-    if ((mmc1Control & BIT_4) == 0)
-    {
-        // low bit ignored in 8kb mode to avoid overflow
-        patternTable0 = chrBase + ((mmc1Chr0 & 0xFE) * kilobytes(4));
-        patternTable1 = patternTable0 + kilobytes(4);
-    }
-    else
+    if (address < 0x8000)
     {
-        patternTable0 = chrBase + (mmc1Chr0 * kilobytes(4));
-        patternTable1 = chrBase + (mmc1Chr1 * kilobytes(4));
+        cartRam[address - 0x6000] = value;
+        return true;
     }
-}
-
-void Cartridge::mmc3Reset()
-{
-    // The default configuration puts:
-    // - 2 x 2k banks on nameTable 0
-    // - 4 x 1k banks on nameTable 1
-    // - 0x8000-0x9FFF swappable
-    // - 0xA000-0xBFFF swappable (default to bank 2 for now)
-    // - 0xC000-0xDFFF fixed to second to last bank
-    // - 0xE000-0xFFFF fixed to last bank
-
-    // 0xE000 can't be changed
-    // 0xA000 is always directly swappable
-    // Other two can change roles between swappable and fixed based on mode
-    // which name table is the 2k banks and which is the 4 k is set by mode
-
-    mmc3ChrRomBanks[0] = chrBase;
-    mmc3ChrRomBanks[1] = chrBase + kilobytes(2);
-    mmc3ChrRomBanks[2] = chrBase + kilobytes(4);
-    mmc3ChrRomBanks[3] = chrBase + kilobytes(5);
-    mmc3ChrRomBanks[4] = chrBase + kilobytes(6);
-    mmc3ChrRomBanks[5] = chrBase + kilobytes(7);
-
-    mmc3PrgRomBanks[1] = prgRom + kilobytes(8);
-    mmc3PrgRomBanks[3] = prgRom + (kilobytes(8) * (prgRomSize * 2 - 1));
-    mmc3RemapPrg();
-}
 
-void Cartridge::mmc3RemapPrg()
-{
-    if (mmc3SwapPrgRomHigh)
-    {
-        mmc3PrgRomBanks[0] = prgRom + (kilobytes(16) * (prgRomSize - 1));
-        mmc3PrgRomBanks[2] = prgRom + (kilobytes(8) * mmc3PrgRomLowBank);
-    }
-    else
+    if (mapper->prgWrite(address, value))
     {
-        mmc3PrgRomBanks[0] = prgRom + (kilobytes(8) * mmc3PrgRomLowBank);
-        mmc3PrgRomBanks[2] = prgRom + (kilobytes(16) * (prgRomSize - 1));
+        mapPrgPages();
     }
+
+    return false;
 }
 
-void Cartridge::mmc3PrgWrite(uint16 address, uint8 value)
+void Cartridge::setReadOnly(bool enable)
 {
-    // Extract bits 13 and 14
-    uint16 registerSelect = (address & 0x6000) >> 13;
-    bool isEven = (address & BIT_0) == 0;
-
-    // 0x8000-0x9FFF Bank Switching registers
-    if (registerSelect == 0)
+    isReadOnly = enable;
+    if (mapper)
     {
-        // Bank Select
-        if (isEven)
-        {
-            mmc3BankSelect = value & 0x07;
-            mmc3Chr2KBanksAreHigh = value & BIT_7;
-
-            if ((value & BIT_6) != mmc3SwapPrgRomHigh)
-            {
-                mmc3SwapPrgRomHigh = value & BIT_6;
-                mmc3RemapPrg();
-            }
-        }
-        // Bank Data
-        else if (mmc3BankSelect == 7)
-        {
-            uint8* newBank = prgRom + (kilobytes(8) * (value & ((prgRomSize * 2) - 1)));
-            mmc3PrgRomBanks[1] = newBank;
-        }
-        else if (mmc3BankSelect == 6)
-        {
-            mmc3PrgRomLowBank = value & ((prgRomSize * 2) - 1);
-            mmc3RemapPrg();
-        }
-        else
-        {
-            value &= mmc3ChrBankMask;
-            if (mmc3BankSelect < 2)
-            {
-                value &= 0xFE;
-            }
-
-            mmc3ChrRomBanks[mmc3BankSelect] = chrBase + kilobytes(value);
-        }
-    }
-    // 0xA000-0xBFFF
-    else if (registerSelect == 1)
-    {
-        // Mirroring
-        if (isEven)
-        {
-            if (value & BIT_0)
-            {
-                mirrorMode = MIRROR_HORIZONTAL;
-            }
-            else
-            {
-                mirrorMode = MIRROR_VERTICAL;
-            }
-        }
-        // PRG RAM Protect
-        else
-        {
-            mmc3PrgRamEnabled = (value & BIT_7) > 0;
-        }
-    }
-    // 0xC000-0xDFFF
-    else if (registerSelect == 2)
-    {
-        // IRQ Latch
-        if (isEven)
-        {
-            mmc3IrqReloadValue = value;
-        }
-        // IRQ Reload
-        else
-        {
-            mmc3ReloadIrqCounter = true;
-        }
-    }
-    // 0xE000-0xFFFF
-    else
-    {
-        mmc3IrqEnabled = !isEven;
-        if (!mmc3IrqEnabled)
-        {
-            mmc3IrqPending = false;
-        }
+        mapper->isReadOnly = enable;
     }
 }
 
-void Cartridge::mmc3TickIrq()
+void Cartridge::serialize(SaveState* state)
 {
-    if (mmc3ReloadIrqCounter)
-    {
-        mmc3IrqCounter = mmc3IrqReloadValue;
-        mmc3ReloadIrqCounter = false;
-    }
-    else if (mmc3IrqCounter == 0)
-    {
-        mmc3IrqCounter = mmc3IrqReloadValue;
-        mmc3ReloadIrqCounter = false;
-    }
-    else
-    {
-        --mmc3IrqCounter;
-    }
+    state->bytes(cartRam, sizeof(cartRam));
+    state->bytes(chrRam, sizeof(chrRam));
+    mapper->serialize(state);
 
-    if (mmc3IrqCounter == 0 && mmc3IrqEnabled)
+    if (state->isLoading())
     {
-        mmc3IrqPending = true;
+        mapPrgPages();
+        tileCache.invalidateAll();
     }
 }
 
-void Cartridge::mmc3SetAddress(uint16 address)
+void Cartridge::reset()
 {
-    bool isPatternTableHi = address & 0x1000;
-    if (isPatternTableHi && !wasPatternHi && mmc3CpuM2Counter == 0)
-    {
-        mmc3TickIrq();
-        mmc3CpuM2Counter = 3;
-    }
+    isReadOnly = false;
+    mapper->reset();
+    mapPrgPages();
 
-    wasPatternHi = isPatternTableHi;
+    // Only hook up the per cycle updates for boards that actually use them
+    cpuTickMapper = mapper->needsCpuTick() ? mapper : 0;
 }
-
-void Cartridge::tickCPU()
-{
-    if (isPatternTableHi)
-    {
-        mmc3CpuM2Counter = 3;
-    }
-    else if (mmc3CpuM2Counter > 0)
-    {
-        --mmc3CpuM2Counter;
-    }
-}
\ No newline at end of file
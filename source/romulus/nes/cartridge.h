@@ -1,40 +1,84 @@
 #pragma once
 #include "romulus.h"
+#include "mappers/mapper.h"
+#include "tileCache.h"
+#include "romStore.h"
 
-enum MirrorMode
-{
-    MIRROR_HORIZONTAL,
-    MIRROR_VERTICAL,
-    SINGLE_SCREEN_LOWER,
-    SINGLE_SCREEN_UPPER,
-};
-
-// TODO: Refactor everything to separate the mappers and get rid of the buses.
-// These concepts are effectively the same and the true unique stuff is in the mapper logic not the bus
+// Owns the rom file and the memory on the board. Everything that changes between boards lives in the Mapper
 class Cartridge
 {
 public:
     bool load(const char* file);
     void unload();
 
-    bool loadNSF(uint8* buffer, uint32 length);
-    bool loadINES(const char* filepath, uint8* buffer, uint32 length);
+    bool loadNSF(const uint8* buffer, uint32 length);
+    bool loadINES(const char* filepath, const uint8* buffer, uint32 length);
+
+    // Loads share rom images through this store, so consoles running the same game only map it once.
+    // Without one the cartridge maps its own copy
+    void setRomStore(RomStore* store) { romStore = store; }
 
     // Resets variables and banks to their default positions for the loaded rom
     void reset();
 
+    // Hands over the cpu bus page tables so the cartridge can point them at its current banks
+    void connectPages(uint8** readPages, uint8** writePages);
+
+    // Points the cpu pages for cartridge ram and prg rom at whatever is currently banked in.
+    // Needs to be called any time the prg banks change
+    void mapPrgPages();
+
     uint8 prgRead(uint16 address);
     bool prgWrite(uint16 address, uint8 value);
 
-    uint8 chrRead(uint16 address);
-    bool chrWrite(uint16 address, uint8 value);
+    uint8 chrRead(uint16 address) { return mapper->chrRead(address); }
+
+    void chrWrite(uint16 address, uint8 value)
+    {
+        mapper->chrWrite(address, value);
+
+        // Rom writes get dropped, so only chr ram can go stale
+        if (chrRomSize == 0)
+        {
+            tileCache.invalidate((uint32)(mapper->chrMemory(address) - chrBase));
+        }
+    }
+
+    // Decoded pixels for the tile row at a pattern table address in the current banks. No read side effects,
+    // so the ppu can only use this in place of chrRead when the mapper isn't watching its fetches
+    const uint8* getTileRow(uint16 address)
+    {
+        uint32 offset = (uint32)(mapper->chrMemory(address) - chrBase);
+        return chrRomTiles ? TileCache::getDecodedRow(chrRomTiles, offset) : tileCache.getRow(offset);
+    }
+    bool hasChrReadSideEffects() { return mapper->hasChrReadSideEffects(); }
+
+    MirrorMode getMirroring() { return mapper->mirrorMode; }
+
+    bool isIrqPending() { return mapper->irqPending; }
+
+    // Mappers that count ppu fetches to raise irqs need the ppu and cpu to run in lockstep
+    bool hasPPUClockedIrq() { return mapper->hasPPUClockedIrq(); }
+
+    void tickCPU()
+    {
+        if (cpuTickMapper)
+        {
+            cpuTickMapper->tickCPU();
+        }
+    }
 
-    MirrorMode getMirroring() { return mirrorMode; }
+    // Used to turn off side effects on read operations
+    void setReadOnly(bool enable);
 
-    bool isIrqPending() { return mapperNumber == 4 && mmc3IrqPending; }
+    // Stops battery backed ram from being loaded from or written to the .sav next to the rom.
+    // For batch runs where the same rom is running in many places and every run should start from the same state
+    void setSaveFileDisabled(bool disable) { isSaveFileDisabled = disable; }
 
-    // THIS IS A HACK to get mmc3 working
-    void tickCPU();
+    // Identifies the loaded file so save states can't be restored onto a different rom
+    uint32 getRomHash() { return romHash; }
+
+    void serialize(SaveState* state);
 
     int mapperNumber;
 
@@ -45,20 +89,33 @@ public:
     // Time between each call to the playAddress in whole ms (ex 16666 for ~60Hz)
     uint16 playSpeed;
 
-    // Used to turn off side effects on read operations (Mainly mapper 9 at the moment)
-    bool isReadOnly;
-
 private:
-    uint8* fileMemory;
+    const RomImage* romImage;
+    RomStore* romStore;
+    RomStore ownRoms;
+
     char saveFilePath[512];
+    uint32 romHash;
+
+    Mapper* mapper;
+
+    // Same as mapper, but only set when it needs to be ticked every cpu cycle
+    Mapper* cpuTickMapper;
+
+    bool isReadOnly;
+    bool isSaveFileDisabled;
+
+    // Cpu bus page tables, 256 entries each
+    uint8** cpuReadPages;
+    uint8** cpuWritePages;
+
+    void clearPrgPages();
 
     // Settings from the header
     bool useVerticalMirroring;
     bool hasPerisitantMemory;
     bool hasFullVram;
 
-    MirrorMode mirrorMode;
-
     // Used to support NSF only
     uint8 backingRom[kilobytes(32)] = {};
 
@@ -70,110 +127,22 @@ private:
     // Number of PRG ROM chips (16KB each)
     uint8 prgRomSize;
 
-    // Base for all prg ROM loaded from disk
+    // Base for all prg ROM, points into the shared read only rom image
     uint8* prgRom;
 
-    // Points to the PRG bank mapped to 0x8000
-    uint8* prgRomBank1;
-
-    // Points to the PRG bank mapped to 0xC000
-    // NOTE: Used for static section in MMC2
-    uint8* prgRomBank2;
-
     // Number of CHR ROM chips (8KB each)
     uint8 chrRomSize;
 
-    // Base for all chr ROM loaded from disk
+    // Base for all chr ROM, points into the shared read only rom image
     uint8* chrRom;
 
-    // Points to the CHR bank mapped to 0x0000
-    uint8* patternTable0;
-
-    // Points to the CHR bank mapped to 0x1000
-    uint8* patternTable1;
-
     // Used in place of CHR ROM when none is provided
     uint8 chrRam[kilobytes(8)];
 
     // Points to chrROM or chrRAM depending on the mapper
     uint8* chrBase;
 
-    bool ignoreNextWrite;
-
-    // MMC1
-    // TODO: MMC1, Handle CHR RAM variants like SNROM, SOROM, etc.
-
-    uint8 mmc1ShiftRegister;
-    uint8 mmc1Control;
-    uint8 mmc1Chr0;
-    uint8 mmc1Chr1;
-    uint8 mmc1PrgBank;
-
-    // Resets the mmc1 variables to a known state and
-    // resets pointers based on the loaded rom
-    void mmc1Reset();
-    void mmc1RemapPrg();
-    void mmc1RemapChr();
-
-    // MMC2
-
-    uint8 mmc2ChrLatch0;
-    uint8* mmc2ChrRom0FE;
-    uint8* mmc2ChrRom0FD;
-
-    uint8 mmc2ChrLatch1;
-    uint8* mmc2ChrRom1FE;
-    uint8* mmc2ChrRom1FD;
-
-    // MMC3 stuff
-
-    uint8 mmc3BankSelect;
-
-    // PRG ROM Bank mode bit is set
-    // Means 0x8000 range is fixed, vs 0xC000 range when disabled
-    // TODO: This name is hot garbage
-    bool mmc3SwapPrgRomHigh;
-    bool mmc3Chr2KBanksAreHigh;
-
-    uint8 mmc3PrgRomBankMode;
-
-    // Determines whether the ram region returns open bus or the contents of ram
-    // This also maps to two different bits in different registers on mmc3 and mmc6 and both are mapper 4, so...
-    // TODO: Implement
-    bool mmc3PrgRamEnabled;
-
-    uint8 mmc3IrqEnabled;
-    uint8 mmc3IrqReloadValue;
-    bool mmc3ReloadIrqCounter;
-
-    bool mmc3IrqPending;
-    uint8 mmc3IrqCounter;
-
-    // There are 6 pointers that can be bank switched
-    // and the mode determines which ones to use where
-    uint8* mmc3ChrRomBanks[6];
-
-    // There are 4 8k chunks, the last is always fixed but all the rest
-    // can be swapped around in various ways. This is indexed by bits 13 and 14
-    uint8* mmc3PrgRomBanks[4];
-
-    // a temp variable used for the bank that isn't fixed second to last
-    uint8 mmc3PrgRomLowBank;
-
-    // Masks out bits from any bank select so we can't overflow. This is in 1k chunks.
-    // Don't ask why but some roms rely on this even though they know they only have x amount
-    uint16 mmc3ChrBankMask;
-
-    void mmc3Reset();
-    void mmc3RemapPrg();
-
-    void mmc3PrgWrite(uint16 address, uint8 value);
-    void mmc3TickIrq();
-
-    // This approach is a hack, because restructuring this whole thing is not in my plans at the moment
-    bool isPatternTableHi;
-    bool wasPatternHi;
-    void mmc3SetAddress(uint16 address);
-
-    uint8 mmc3CpuM2Counter;
-};
\ No newline at end of file
+    // Chr rom is decoded once by the rom store and shared, the tile cache is only for chr ram
+    const uint8* chrRomTiles;
+    TileCache tileCache;
+};
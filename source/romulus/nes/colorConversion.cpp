@@ -0,0 +1,106 @@
+#include "colorConversion.h"
+#include "constants.h"
+#include "ppu/ppu.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define COLOR_CONVERSION_X86 1
+#else
+#define COLOR_CONVERSION_X86 0
+#endif
+
+#if COLOR_CONVERSION_X86
+#include <immintrin.h>
+
+// MSVC lets any intrinsic through, gcc and clang need to be told which functions can use the wider instructions
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+typedef void ConvertFunction(const uint8* indices, uint32* output, uint32 count);
+
+static void convertPaletteIndicesScalar(const uint8* indices, uint32* output, uint32 count)
+{
+    for (uint32 i = 0; i < count; ++i)
+    {
+        output[i] = palette[indices[i] & 0x3F];
+    }
+}
+
+#if COLOR_CONVERSION_X86
+
+TARGET_AVX2 static void convertPaletteIndicesAVX2(const uint8* indices, uint32* output, uint32 count)
+{
+    const __m256i indexMask = _mm256_set1_epi32(0x3F);
+
+    uint32 i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(indices + i)));
+        index = _mm256_and_si256(index, indexMask);
+
+        __m256i colors = _mm256_i32gather_epi32((const int*)palette, index, 4);
+        _mm256_storeu_si256((__m256i*)(output + i), colors);
+    }
+
+    convertPaletteIndicesScalar(indices + i, output + i, count - i);
+}
+
+static bool isAVX2Supported()
+{
+#if defined(_MSC_VER)
+    // Leaf 7 bit 5 of ebx, plus the os has to be saving the ymm registers (xgetbv bits 1 and 2)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && ((_xgetbv(0) & 0x06) == 0x06);
+
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+static ConvertFunction* selectConverter()
+{
+#if COLOR_CONVERSION_X86
+    if (isAVX2Supported())
+    {
+        return convertPaletteIndicesAVX2;
+    }
+#endif
+
+    return convertPaletteIndicesScalar;
+}
+
+void convertFrame(const uint8* frame, void* output, int pitch)
+{
+    // Picked once, the cpu isn't going to change under us
+    static ConvertFunction* const convert = selectConverter();
+
+    // Rows that are back to back can go in one call
+    if (pitch == NES_SCREEN_WIDTH * sizeof(uint32))
+    {
+        convert(frame, (uint32*)output, NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT);
+        return;
+    }
+
+    uint8* row = (uint8*)output;
+    for (int y = 0; y < NES_SCREEN_HEIGHT; ++y)
+    {
+        convert(frame, (uint32*)row, NES_SCREEN_WIDTH);
+        frame += NES_SCREEN_WIDTH;
+        row += pitch;
+    }
+}
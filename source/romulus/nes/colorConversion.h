@@ -0,0 +1,9 @@
+#pragma once
+#include "romulus.h"
+
+// Turns the ppu's palette indices into 32 bit colors for the platform layer and frame capture.
+// Cpus with AVX2 gather 8 pixels at a time straight out of the palette table, anything else (or a non x86 build)
+// does one pixel at a time. Indices are masked to 6 bits first since the palette only has 64 entries.
+
+// Converts a whole frame straight into the caller's buffer, with pitch bytes between the start of each row
+void convertFrame(const uint8* frame, void* output, int pitch);
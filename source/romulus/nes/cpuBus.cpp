@@ -1,19 +1,71 @@
 #include "cpuBus.h"
 #include "constants.h"
 
+#include <string.h>
+
 // Reference
 // https://www.nesdev.org/wiki/CPU_memory_map
 // https://www.nesdev.org/wiki/2A03
 
-void CPUBus::connect(PPU* ppu, APU* apu, Cartridge* cart, InputBus* input)
+void CPUBus::connect(PPU<PPUBus>* ppu, APU* apu, Cartridge* cart, InputBus* input, Scheduler* scheduler)
 {
     this->ppu = ppu;
     this->apu = apu;
     this->cart = cart;
     inputBus = input;
+    this->scheduler = scheduler;
+
+    for (int page = 0; page < 256; ++page)
+    {
+        readPages[page] = 0;
+        writePages[page] = 0;
+    }
+
+    mapInternalRam();
+    cart->connectPages(readPages, writePages);
+}
+
+void CPUBus::powerOn()
+{
+    memset(ram, 0, sizeof(ram));
+
+    isDmaActive = false;
+    dmaAddress = 0;
+    dmaCycleCount = 0;
+    dmaReadValue = 0;
+
+    ppuOpenBusValue = 0;
+    cpuOpenBusValue = 0;
+}
+
+// The 2kb of ram is mirrored 4 times through 0x0000 - 0x1FFF
+void CPUBus::mapInternalRam()
+{
+    for (int page = 0; page < 0x20; ++page)
+    {
+        readPages[page] = ram + ((page & 0x07) << 8);
+        writePages[page] = ram + ((page & 0x07) << 8);
+    }
 }
 
-uint8 CPUBus::read(uint16 address)
+void CPUBus::setReadOnly(bool enable)
+{
+    readOnly = enable;
+    cart->setReadOnly(enable);
+
+    // Reads through the page table update open bus, so turn it off to force everything through the handlers
+    if (enable)
+    {
+        memcpy(savedReadPages, readPages, sizeof(readPages));
+        memset(readPages, 0, sizeof(readPages));
+    }
+    else
+    {
+        memcpy(readPages, savedReadPages, sizeof(readPages));
+    }
+}
+
+uint8 CPUBus::readHandler(uint16 address)
 {
     if (address < 0x2000)
     {
@@ -37,6 +89,11 @@ uint8 CPUBus::read(uint16 address)
             return 0xFF;
         }
 
+        // Any ppu access needs it caught up first, and the next dots to run before the cpu continues
+        // since these can change the nmi status
+        scheduler->syncPPU();
+        scheduler->requestSync();
+
         uint16 decodedAddress = address & 0x0007;
         uint8 result = ppuOpenBusValue;
         if (decodedAddress == 0x02)
@@ -78,12 +135,15 @@ uint8 CPUBus::read(uint16 address)
             }
             case JOY1:
             {
+                // The zapper reads the ppu output
+                scheduler->syncPPU();
                 cpuOpenBusValue &= 0xE0;
                 cpuOpenBusValue |= inputBus->read(0) & 0x1F;
                 return cpuOpenBusValue;
             }
             case JOY2:
             {
+                scheduler->syncPPU();
                 cpuOpenBusValue &= 0xE0;
                 cpuOpenBusValue |= inputBus->read(1) & 0x1F;
                 return cpuOpenBusValue;
@@ -97,7 +157,7 @@ uint8 CPUBus::read(uint16 address)
     return cpuOpenBusValue;
 }
 
-void CPUBus::write(uint16 address, uint8 value)
+void CPUBus::writeHandler(uint16 address, uint8 value)
 {
     if (address < 0x2000)
     {
@@ -108,6 +168,9 @@ void CPUBus::write(uint16 address, uint8 value)
     {
         // map to the ppu registers (only uses the bottom 3 bits)
         // http://wiki.nesdev.com/w/index.php/2A03
+        scheduler->syncPPU();
+        scheduler->requestSync();
+
         uint16 decodedAddress = address & 0x2007;
         switch (decodedAddress)
         {
@@ -126,6 +189,9 @@ void CPUBus::write(uint16 address, uint8 value)
     {
         // map to the apu/io registers
         // http://wiki.nesdev.com/w/index.php/2A03
+        // Most of these can change what the channels are outputting, so have the apu remix on its next cycle
+        apu->isOutputDirty = true;
+
         switch (address)
         {
             case SQ1_VOL:    apu->pulse1.setDutyEnvelope(value);    break;
@@ -162,6 +228,8 @@ void CPUBus::write(uint16 address, uint8 value)
     else
     {
         // Cartridge space (logic depends on the mapper)
+        // Bank switches change what the ppu sees so it has to be caught up first
+        scheduler->syncPPU();
         cart->prgWrite(address, value);
     }
 }
@@ -183,3 +251,15 @@ void CPUBus::tickDMA()
 
     ++dmaCycleCount;
 }
+
+void CPUBus::serialize(SaveState* state)
+{
+    state->bytes(ram, sizeof(ram));
+    state->value(ppuOpenBusValue);
+    state->value(cpuOpenBusValue);
+
+    state->value(isDmaActive);
+    state->value(dmaAddress);
+    state->value(dmaCycleCount);
+    state->value(dmaReadValue);
+}
@@ -1,25 +1,65 @@
 #pragma once
 #include "bus.h"
-#include "ppu/ppu.h"
+#include "ppuBus.h"
 #include "apu/apu.h"
 #include "cartridge.h"
 #include "input/inputBus.h"
+#include "scheduler.h"
 
 // TODO: Pull DMA into a new CPU that wraps the apu features and the dma controller, like it is on the nes
 // TODO: Pull Input handling out into its own module and let this and the ppubus be subsumed into the cartridge / mapper stuff
 
-class CPUBus : public IBus
+class CPUBus final : public IBus
 {
 public:
-    void connect(PPU* ppu, APU* apu, Cartridge* cart, InputBus* input);
+    void connect(PPU<PPUBus>* ppu, APU* apu, Cartridge* cart, InputBus* input, Scheduler* scheduler);
 
-    uint8 read(uint16 address);
-    void write(uint16 address, uint8 value);
+    // Clears the ram and anything left over from the last dma
+    void powerOn();
 
-    void setReadOnly(bool enable) { readOnly = enable; cart->isReadOnly = enable; };
+    // Most traffic is opcode fetches and ram access, so those go straight through the page table.
+    // Anything without a direct mapping (io registers, mapper ports, etc.) falls back to the handlers
+    uint8 read(uint16 address)
+    {
+        uint8* page = readPages[address >> 8];
+        if (page)
+        {
+            cpuOpenBusValue = page[address & 0x00FF];
+            return cpuOpenBusValue;
+        }
+
+        return readHandler(address);
+    }
+
+    void write(uint16 address, uint8 value)
+    {
+        uint8* page = writePages[address >> 8];
+        if (page)
+        {
+            page[address & 0x00FF] = value;
+            return;
+        }
+
+        writeHandler(address, value);
+    }
+
+    // Memory mapped straight through the page tables, reading it never has side effects
+    bool isDirectRead(uint16 address) { return readPages[address >> 8] != 0; }
+
+    // Where the byte at an address lives in host memory, or null if it isn't mapped straight through
+    const uint8* getDirectPointer(uint16 address)
+    {
+        uint8* page = readPages[address >> 8];
+        return page ? page + (address & 0x00FF) : 0;
+    }
+
+    void setReadOnly(bool enable);
 
     void tickDMA();
 
+    void serialize(SaveState* state);
+    void hashState(StateHash* hash) { hash->bytes(ram, sizeof(ram)); }
+
     // DMA Data
     bool isDmaActive;
     uint16 dmaAddress;
@@ -27,13 +67,28 @@ public:
     uint8 dmaReadValue;
 
 private:
-    PPU* ppu;
+    PPU<PPUBus>* ppu;
     APU* apu;
     Cartridge* cart;
     InputBus* inputBus;
+    Scheduler* scheduler;
 
     uint8 ram[2 * 1024];
 
+    // One entry per 256 byte page of the address space pointing at the memory backing it.
+    // A null entry flags the page as needing a handler. Cartridge fills in its own pages as it bank switches
+    uint8* readPages[256];
+    uint8* writePages[256];
+
+    // The read pages from before read only mode turned them off. Nothing can bank switch while it's on, so they're
+    // put straight back after rather than mapped again
+    uint8* savedReadPages[256];
+
+    void mapInternalRam();
+
+    uint8 readHandler(uint16 address);
+    void writeHandler(uint16 address, uint8 value);
+
     uint8 ppuOpenBusValue;
     uint8 cpuOpenBusValue;
 
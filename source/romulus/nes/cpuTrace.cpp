@@ -2,9 +2,8 @@
 #include "log.h"
 #include <stdio.h>
 #include <string.h>
-
-FILE* logFile = 0;
-bool isNestestLog = true;
+#include <errno.h>
+#include <chrono>
 
 // TODO: This is basically a low rent custom purpose string builder. maybe make a class to use in other places
 static const char hexValues[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
@@ -64,13 +63,12 @@ int formatString(char* dest, const char* s)
     return formatString(dest, s, (uint32)strlen(s));
 }
 
-int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
+int32 formatInstruction(char* dest, const TraceRecord* record)
 {
-    uint8 opcode = bus->read(address);
-    uint8 p1 = bus->read(address + 1);
-    uint8 p2 = bus->read(address + 2);
+    uint8 p1 = record->bytes[1];
+    uint8 p2 = record->bytes[2];
 
-    Operation op = operations[opcode];
+    Operation op = operations[record->bytes[0]];
     const char* opCodeName = opCodeNames[op.opCode];
     int32 opCodeLength = (int32)strlen(opCodeName);
     char* s = dest;
@@ -79,7 +77,7 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
     s += opCodeLength;
     *s++ = ' ';
 
-    address = cpu->calcAddress(op.addressMode, address, p1, p2);
+    uint16 address = record->operandAddress;
 
     switch (op.addressMode)
     {
@@ -88,7 +86,7 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
             s += formatAddress(s, address);
             if (op.opCode != JMP && op.opCode != JSR)
             {
-                uint8 result = bus->read(address);
+                uint8 result = record->operandValue;
                 s += formatString(s, " = ");
                 s += formatImmediate(s, result);
             }
@@ -100,7 +98,7 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
             s += formatString(s, ",X @ ");
             s += formatAddress(s, address);
 
-            uint8 result = bus->read(address);
+            uint8 result = record->operandValue;
             s += formatString(s, " = ");
             s += formatImmediate(s, result);
         }
@@ -111,7 +109,7 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
             s += formatString(s, ",Y @ ");
             s += formatAddress(s, address);
 
-            uint8 result = bus->read(address);
+            uint8 result = record->operandValue;
             s += formatString(s, " = ");
             s += formatImmediate(s, result);
         }
@@ -133,11 +131,11 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
             *s++ = '(';
             s += formatHex(s, p1);
             s += formatString(s, ",X) @ ");
-            s += formatByte(s, (uint8)(p1 + cpu->x));
+            s += formatByte(s, (uint8)(p1 + record->x));
             s += formatString(s, " = ");
             s += formatWord(s, address);
 
-            uint8 result = bus->read(address);
+            uint8 result = record->operandValue;
             s += formatString(s, " = ");
             s += formatByte(s, result);
         }
@@ -149,7 +147,7 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
             s += formatString(s, "),Y @ ");
             s += formatAddress(s, address);
 
-            uint8 result = bus->read(address);
+            uint8 result = record->operandValue;
             s += formatString(s, " = ");
             s += formatImmediate(s, result);
         }
@@ -158,7 +156,7 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
         {
             s += formatAddress(s, p1, 0);
 
-            uint8 result = bus->read(address);
+            uint8 result = record->operandValue;
             s += formatString(s, " = ");
             s += formatImmediate(s, result);
         }
@@ -169,7 +167,7 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
             s += formatString(s, ",X @ ");
             s += formatByte(s, (uint8)address);
 
-            uint8 result = bus->read(address);
+            uint8 result = record->operandValue;
             s += formatString(s, " = ");
             s += formatByte(s, result);
         }
@@ -180,7 +178,7 @@ int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus)
             s += formatString(s, ",Y @ ");
             s += formatByte(s, (uint8)address);
 
-            uint8 result = bus->read(address);
+            uint8 result = record->operandValue;
             s += formatString(s, " = ");
             s += formatByte(s, result);
         }
@@ -228,73 +226,77 @@ int32 formatHexInstruction(char* dest, uint16 address, uint8 opcode, AddressingM
     return (int32)(dest - start);
 }
 
-int formatRegistersFCEU(char* dest, MOS6502* cpu)
+int formatRegistersFCEU(char* dest, const TraceRecord* record)
 {
     memcpy(dest, "A:00 X:00 Y:00 S:00 P:nvubdizc\n", 32);
 
-    formatByte(dest + 2, cpu->accumulator);
-    formatByte(dest + 7, cpu->x);
-    formatByte(dest + 12, cpu->y);
-    formatByte(dest + 17, cpu->stack);
-
-    if (cpu->isFlagSet(STATUS_NEGATIVE)) dest[22] = 'N';
-    if (cpu->isFlagSet(STATUS_OVERFLOW)) dest[23] = 'V';
-    if (cpu->isFlagSet(0b00100000)) dest[24] = 'U';
-    if (cpu->isFlagSet(0b00010000)) dest[25] = 'B';
-    if (cpu->isFlagSet(STATUS_DECIMAL)) dest[26] = 'D';
-    if (cpu->isFlagSet(STATUS_INT_DISABLE)) dest[27] = 'I';
-    if (cpu->isFlagSet(STATUS_ZERO)) dest[28] = 'Z';
-    if (cpu->isFlagSet(STATUS_CARRY)) dest[29] = 'C';
-
-    return 32;
+    formatByte(dest + 2, record->accumulator);
+    formatByte(dest + 7, record->x);
+    formatByte(dest + 12, record->y);
+    formatByte(dest + 17, record->stack);
+
+    if (record->status & STATUS_NEGATIVE) dest[22] = 'N';
+    if (record->status & STATUS_OVERFLOW) dest[23] = 'V';
+    if (record->status & 0b00100000) dest[24] = 'U';
+    if (record->status & 0b00010000) dest[25] = 'B';
+    if (record->status & STATUS_DECIMAL) dest[26] = 'D';
+    if (record->status & STATUS_INT_DISABLE) dest[27] = 'I';
+    if (record->status & STATUS_ZERO) dest[28] = 'Z';
+    if (record->status & STATUS_CARRY) dest[29] = 'C';
+
+    // Not counting the terminator
+    return 31;
 }
 
-void formatRegistersNesTest(char* dest, MOS6502* cpu, PPU* ppu, uint32 cpuCycle)
+int32 formatRegistersNesTest(char* dest, const TraceRecord* record)
 {
     memcpy(dest, "A:00 X:00 Y:00 P:00 SP:00 PPU:   ,    CYC:", 42);
 
-    formatByte(dest + 2, cpu->accumulator);
-    formatByte(dest + 7, cpu->x);
-    formatByte(dest + 12, cpu->y);
+    formatByte(dest + 2, record->accumulator);
+    formatByte(dest + 7, record->x);
+    formatByte(dest + 12, record->y);
     // NOTE: This only displays as 1 in the log but isn't set in the register itself.
     // See https://www.nesdev.org/wiki/Status_flags#The_B_flag
-    formatByte(dest + 17, (cpu->status | 0b00100000));
-    formatByte(dest + 23, cpu->stack);
+    formatByte(dest + 17, (record->status | 0b00100000));
+    formatByte(dest + 23, record->stack);
 
-    // Write dot
+    // Write scanline
     {
         char* numDest = dest + 32;
-        uint32 dot = ppu->cycle;
+        uint32 scanline = record->scanline;
 
         do
         {
-            *numDest-- = (char)((dot % 10) + 48);
-            dot /= 10;
-        } while (dot > 0);
+            *numDest-- = (char)((scanline % 10) + 48);
+            scanline /= 10;
+        }
+        while (scanline > 0);
     }
 
-    // Write scanline
+    // Write dot
     {
         char* numDest = dest + 36;
-        uint32 scanline = ppu->scanline;
+        uint32 dot = record->dot;
 
         do
         {
-            *numDest-- = (char)((scanline % 10) + 48);
-            scanline /= 10;
+            *numDest-- = (char)((dot % 10) + 48);
+            dot /= 10;
         }
-        while (scanline > 0);
+        while (dot > 0);
     }
 
+    char* start = dest;
     dest += 42;
 
     // Write cpu cycles
     {
+        uint64 cpuCycle = record->cpuCycle;
         char* numDest = dest;
 
         // Figures out where to write the first digit/how wide the number is
         // NOTE: There is probably a fancy mathy way to do this, but I'm too dumb
-        uint32 target = cpuCycle;
+        uint64 target = cpuCycle;
         while (target >= 10)
         {
             target /= 10;
@@ -312,6 +314,7 @@ void formatRegistersNesTest(char* dest, MOS6502* cpu, PPU* ppu, uint32 cpuCycle)
 
     *dest++ = '\n';
     *dest = 0;
+    return (int32)(dest - start);
 }
 
 // makes no assumptions buffer must be long enough
@@ -326,11 +329,11 @@ void padRight(char* start, int32 length, int32 desiredLength, char padChar = ' '
     *end = 0;
 }
 
-void logInstructionFCEU(char* line, uint16 address, MOS6502* cpu, CPUBus* cpuBus)
+int32 formatRecordFCEU(char* line, const TraceRecord* record)
 {
-    uint8 opcode = cpuBus->read(address);
-    uint8 p1 = cpuBus->read(address + 1);
-    uint8 p2 = cpuBus->read(address + 2);
+    uint8 opcode = record->bytes[0];
+    uint8 p1 = record->bytes[1];
+    uint8 p2 = record->bytes[2];
 
     Operation op = operations[opcode];
 
@@ -340,34 +343,37 @@ void logInstructionFCEU(char* line, uint16 address, MOS6502* cpu, CPUBus* cpuBus
     const int32 CYCLES_WIDTH = 27;
 
     char* columnStart = line;
-    int32 hexLength = formatHexInstruction(line, address, opcode, op.addressMode, p1, p2);
+    int32 hexLength = formatHexInstruction(line, record->pc, opcode, op.addressMode, p1, p2);
     padRight(columnStart, hexLength, HEX_WIDTH);
     columnStart += HEX_WIDTH;
 
-    int32 instLength = formatInstruction(columnStart, address, cpu, cpuBus);
+    int32 instLength = formatInstruction(columnStart, record);
     padRight(columnStart, instLength, INST_WIDTH);
     columnStart += INST_WIDTH;
 
-    formatRegistersFCEU(columnStart, cpu);
+    int32 registersLength = formatRegistersFCEU(columnStart, record);
     if (op.isUnofficial)
     {
         line[15] = '*';
     }
+
+    return (int32)(columnStart - line) + registersLength;
 }
 
-void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpuBus, PPU* ppu, uint32 cpuCycle)
+int32 formatRecordNesTest(char* dest, const TraceRecord* record)
 {
-    uint8 opcode = cpuBus->read(address);
-    uint8 p1 = cpuBus->read(address + 1);
-    uint8 p2 = cpuBus->read(address + 2);
+    uint8 opcode = record->bytes[0];
+    uint8 p1 = record->bytes[1];
+    uint8 p2 = record->bytes[2];
 
     Operation op = operations[opcode];
 
+    char* lineStart = dest;
     char* columnStart = dest;
 
     // Wite Hex Instruction
     {
-        dest += formatWord(dest, address);
+        dest += formatWord(dest, record->pc);
         *dest++ = ' ';
         *dest++ = ' ';
         dest += formatByte(dest, opcode);
@@ -414,7 +420,7 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
         dest += opCodeLength;
         *dest++ = ' ';
 
-        address = cpu->calcAddress(op.addressMode, address, p1, p2);
+        uint16 address = record->operandAddress;
 
         switch (op.addressMode)
         {
@@ -423,7 +429,7 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
                 dest += formatAddress(dest, address);
                 if (op.opCode != JMP && op.opCode != JSR)
                 {
-                    uint8 result = cpuBus->read(address);
+                    uint8 result = record->operandValue;
                     dest += formatString(dest, " = ");
                     dest += formatByte(dest, result);
                 }
@@ -435,7 +441,7 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
                 dest += formatString(dest, ",X @ ");
                 dest += formatWord(dest, address);
 
-                uint8 result = cpuBus->read(address);
+                uint8 result = record->operandValue;
                 dest += formatString(dest, " = ");
                 dest += formatByte(dest, result);
             }
@@ -446,7 +452,7 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
                 dest += formatString(dest, ",Y @ ");
                 dest += formatWord(dest, address);
 
-                uint8 result = cpuBus->read(address);
+                uint8 result = record->operandValue;
                 dest += formatString(dest, " = ");
                 dest += formatByte(dest, result);
             }
@@ -468,11 +474,11 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
                 *dest++ = '(';
                 dest += formatHex(dest, p1);
                 dest += formatString(dest, ",X) @ ");
-                dest += formatByte(dest, (uint8)(p1 + cpu->x));
+                dest += formatByte(dest, (uint8)(p1 + record->x));
                 dest += formatString(dest, " = ");
                 dest += formatWord(dest,address);
 
-                uint8 result = cpuBus->read(address);
+                uint8 result = record->operandValue;
                 dest += formatString(dest, " = ");
                 dest += formatByte(dest, result);
             }
@@ -483,14 +489,13 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
                 dest += formatHex(dest, p1);
                 dest += formatString(dest, "),Y = ");
 
-                uint16 zpReadLo = cpuBus->read(p1);
-                uint16 zpReadHi = cpuBus->read((uint8)(p1 + 1));
-                dest += formatWord(dest, (zpReadHi << 8) + zpReadLo);
+                // The pointer read from the zero page, before y was added
+                dest += formatWord(dest, (uint16)(address - record->y));
 
                 dest += formatString(dest, " @ ");
                 dest += formatWord(dest, address);
 
-                uint8 result = cpuBus->read(address);
+                uint8 result = record->operandValue;
                 dest += formatString(dest, " = ");
                 dest += formatByte(dest, result);
             }
@@ -499,7 +504,7 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
             {
                 dest += formatHex(dest, p1);
 
-                uint8 result = cpuBus->read(address);
+                uint8 result = record->operandValue;
                 dest += formatString(dest, " = ");
                 dest += formatByte(dest, result);
             }
@@ -510,7 +515,7 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
                 dest += formatString(dest, ",X @ ");
                 dest += formatByte(dest, (uint8)address);
 
-                uint8 result = cpuBus->read(address);
+                uint8 result = record->operandValue;
                 dest += formatString(dest, " = ");
                 dest += formatByte(dest, result);
             }
@@ -521,7 +526,7 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
                 dest += formatString(dest, ",Y @ ");
                 dest += formatByte(dest, (uint8)address);
 
-                uint8 result = cpuBus->read(address);
+                uint8 result = record->operandValue;
                 dest += formatString(dest, " = ");
                 dest += formatByte(dest, result);
             }
@@ -537,42 +542,258 @@ void logInstructionNesTest(char* dest, uint16 address, MOS6502* cpu, CPUBus* cpu
         dest = columnStart;
     }
 
-    formatRegistersNesTest(columnStart, cpu, ppu, cpuCycle);
+    return (int32)(columnStart - lineStart) + formatRegistersNesTest(columnStart, record);
+}
+
+// Reads for the trace can't have side effects. Ram and rom are read straight out of memory, anything else has to go
+// through the bus in read only mode, which is slow to switch in and out of so it's only done when something needs it
+struct TraceReader
+{
+    CPUBus* bus;
+    bool isReadOnly;
+
+    uint8 read(uint16 address)
+    {
+        const uint8* byte = bus->getDirectPointer(address);
+        if (byte)
+        {
+            return *byte;
+        }
+
+        if (!isReadOnly)
+        {
+            bus->setReadOnly(true);
+            isReadOnly = true;
+        }
+
+        return bus->read(address);
+    }
+};
+
+// Same as MOS6502::calcAddress, but through the reader
+static uint16 getOperandAddress(TraceReader* reader, AddressingMode addressMode, uint16 address, uint8 a, uint8 b, MOS6502<CPUBus>* cpu)
+{
+    switch (addressMode)
+    {
+        case ZeroPage:
+            return a;
+        case ZeroPageX:
+            return (uint8)(a + cpu->x);
+        case ZeroPageY:
+            return (uint8)(a + cpu->y);
+        case Absolute:
+            return (uint16)b << 8 | a;
+        case AbsoluteX:
+            return cpu->x + ((uint16)b << 8 | a);
+        case AbsoluteY:
+            return cpu->y + ((uint16)b << 8 | a);
+        case Indirect:
+        {
+            uint16 lo = reader->read((uint16)b << 8 | a);
+            uint16 hi = reader->read((uint16)b << 8 | (uint8)(a + 1));
+            return (hi << 8) + lo;
+        }
+        case IndirectX:
+        {
+            uint16 lo = reader->read((uint8)(a + cpu->x));
+            uint16 hi = reader->read((uint8)(a + cpu->x + 1));
+            return (hi << 8) + lo;
+        }
+        case IndirectY:
+        {
+            uint16 lo = reader->read(a);
+            uint16 hi = reader->read((uint8)(a + 1));
+            return (uint16)((hi << 8) + lo + cpu->y);
+        }
+        case Relative:
+            return (address + 2) + (int8)a;
+    }
+
+    return 0;
+}
+
+int32 formatTraceRecord(char* line, const TraceRecord* record, bool isNestestLog)
+{
+    memset(line, 0, 128);
+    return isNestestLog ? formatRecordNesTest(line, record) : formatRecordFCEU(line, record);
+}
+
+bool CPUTrace::open(const char* path)
+{
+    if (isOpen())
+    {
+        logError("Cpu trace is already open, close it before starting %s\n", path);
+        return false;
+    }
+
+    file = fopen(path, "wb");
+    if (!file)
+    {
+        logError("Failed to open cpu trace %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    // The writer hands over big chunks anyway, and this way everything it's written survives the emulator crashing
+    setvbuf(file, 0, _IONBF, 0);
+
+    CPUTraceHeader header = {};
+    header.magic = CPU_TRACE_MAGIC;
+    header.version = CPU_TRACE_VERSION;
+    fwrite(&header, sizeof(header), 1, file);
+
+    ring = new TraceRecord[RING_RECORDS];
+    writeIndex = 0;
+    readIndex = 0;
+    stalls = 0;
+
+    isClosing = false;
+    writer = std::thread(&CPUTrace::writerLoop, this);
+
+    return true;
 }
 
-void logInstruction(const char* filename, uint16 address, MOS6502* cpu, CPUBus* cpuBus, PPU* ppu, uint32 cpuCycle)
+void CPUTrace::logInstruction(uint16 address, MOS6502<CPUBus>* cpu, CPUBus* cpuBus, uint32 scanline, uint32 dot, uint64 cpuCycle)
 {
-    if (!logFile)
+    if (!isOpen())
     {
-        logFile = fopen(filename, "w");
-        if (!logFile)
+        return;
+    }
+
+    uint32 index = writeIndex.load(std::memory_order_relaxed);
+    if (index - readIndex.load(std::memory_order_acquire) == RING_RECORDS)
+    {
+        ++stalls;
+        while (index - readIndex.load(std::memory_order_acquire) == RING_RECORDS)
         {
-            logError("Failed to open cpu trace log: %s\n", strerror(errno));
+            std::this_thread::yield();
         }
     }
 
-    cpuBus->setReadOnly(true);
+    TraceRecord* record = &ring[index & (RING_RECORDS - 1)];
+    TraceReader reader = { cpuBus, false };
+
+    record->cpuCycle = cpuCycle;
+    record->pc = address;
+    record->bytes[0] = reader.read(address);
+    record->bytes[1] = reader.read(address + 1);
+    record->bytes[2] = reader.read(address + 2);
+
+    record->accumulator = cpu->accumulator;
+    record->x = cpu->x;
+    record->y = cpu->y;
+    record->status = cpu->status;
+    record->stack = cpu->stack;
+
+    record->scanline = (uint16)scanline;
+    record->dot = (uint16)dot;
+
+    Operation op = operations[record->bytes[0]];
+    record->operandAddress = getOperandAddress(&reader, op.addressMode, address, record->bytes[1], record->bytes[2], cpu);
+    record->operandValue = 0;
+
+    // The logs show the byte the operand points at for anything that reads or writes memory
+    switch (op.addressMode)
+    {
+        case Absolute:
+        {
+            if (op.opCode == JMP || op.opCode == JSR)
+            {
+                break;
+            }
+        }
+        // Fall through
+        case AbsoluteX:
+        case AbsoluteY:
+        case IndirectX:
+        case IndirectY:
+        case ZeroPage:
+        case ZeroPageX:
+        case ZeroPageY:
+            record->operandValue = reader.read(record->operandAddress);
+            break;
+    }
+
+    if (reader.isReadOnly)
+    {
+        cpuBus->setReadOnly(false);
+    }
 
-    char line[128] = {};
+    // The writer doesn't look at the record until it sees the index move past it
+    writeIndex.store(index + 1, std::memory_order_release);
+}
 
-    if (isNestestLog)
+void CPUTrace::flush()
+{
+    if (!isOpen())
     {
-        logInstructionNesTest(line, address, cpu, cpuBus, ppu, cpuCycle);
+        return;
     }
-    else
+
+    while (readIndex.load(std::memory_order_acquire) != writeIndex.load(std::memory_order_relaxed))
     {
-        logInstructionFCEU(line, address, cpu, cpuBus);
+        std::this_thread::yield();
     }
 
-    if (logFile)
+    fflush(file);
+}
+
+void CPUTrace::close()
+{
+    if (!isOpen())
     {
-        fputs(line, logFile);
+        return;
     }
 
-    cpuBus->setReadOnly(false);
+    isClosing.store(true, std::memory_order_release);
+    writer.join();
+
+    fclose(file);
+    file = 0;
+
+    delete[] ring;
+    ring = 0;
+
+    if (stalls > 0)
+    {
+        logWarn("Cpu trace writer fell behind, the console had to wait for it %u times\n", stalls);
+    }
 }
 
-void flushLog()
+void CPUTrace::writerLoop()
 {
-    fflush(logFile);
+    bool hasFailed = false;
+    while (true)
+    {
+        // Checked before looking at the ring, so anything logged before closing still gets written
+        bool isFinishing = isClosing.load(std::memory_order_acquire);
+
+        uint32 start = readIndex.load(std::memory_order_relaxed);
+        uint32 end = writeIndex.load(std::memory_order_acquire);
+        if (start == end)
+        {
+            if (isFinishing)
+            {
+                return;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // Up to the end of the ring at most, the rest goes on the next time around
+        uint32 offset = start & (RING_RECORDS - 1);
+        uint32 count = end - start;
+        if (offset + count > RING_RECORDS)
+        {
+            count = RING_RECORDS - offset;
+        }
+
+        if (fwrite(ring + offset, sizeof(TraceRecord), count, file) != count && !hasFailed)
+        {
+            hasFailed = true;
+            logError("Failed to write cpu trace: %s\n", strerror(errno));
+        }
+
+        readIndex.store(start + count, std::memory_order_release);
+    }
 }
@@ -1,8 +1,91 @@
 #pragma once
 #include "6502.h"
-#include "ppu/ppu.h"
 #include "cpuBus.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
 
-int formatInstruction(char* dest, uint16 address, MOS6502* cpu, IBus* bus);
-void logInstruction(const char* filename, uint16 address, MOS6502* cpu, CPUBus* cpuBus, PPU* ppu, uint32 cpuCycle);
-void flushLog();
\ No newline at end of file
+// Trace files are a header followed by a record per instruction, in the order they ran.
+// See romulus-tracedecode for turning them into a nestest.log (or FCEUX) style text log
+const uint32 CPU_TRACE_MAGIC = fourCC('R', 'M', 'C', 'T');
+const uint16 CPU_TRACE_VERSION = 2;
+
+#pragma pack(push, 1)
+struct CPUTraceHeader
+{
+    uint32 magic;
+    uint16 version;
+};
+
+// Everything the text logs show, taken just before the instruction runs
+struct TraceRecord
+{
+    // Cycles since the last power on or reset, 64 bits so long captures don't wrap
+    uint64 cpuCycle;
+    uint16 pc;
+
+    // Opcode and the two bytes after it, whether or not the instruction uses them
+    uint8 bytes[3];
+
+    uint8 accumulator;
+    uint8 x;
+    uint8 y;
+    uint8 status;
+    uint8 stack;
+
+    uint16 scanline;
+    uint16 dot;
+
+    // Where the operand points (the branch or jump destination for those) and the byte there,
+    // so the log can show the values without the console's memory
+    uint16 operandAddress;
+    uint8 operandValue;
+};
+#pragma pack(pop)
+
+// Fills in a line of text for the record, ending in a newline. Matches nestest.log when isNestestLog is set, otherwise
+// the FCEUX trace logger. The line needs at least 128 chars. Returns the length
+int32 formatTraceRecord(char* line, const TraceRecord* record, bool isNestestLog);
+
+// Writes a record per instruction to a file for diffing against other emulators.
+// Each console has its own so traces from different instances don't end up interleaved.
+// The console thread only fills in a record and moves on, a thread of its own does the writing. The two share a ring
+// of records without locking (like AudioRing), each side only moving its own index. Nothing can be dropped from a
+// trace, so if the writer ever falls a whole ring behind the console waits for it.
+class CPUTrace
+{
+public:
+    // ~1.6mb, a couple of frames' worth
+    static const uint32 RING_RECORDS = 65536;
+
+    // Joins the writer thread if the trace is still open
+    ~CPUTrace() { close(); }
+
+    bool open(const char* path);
+    bool isOpen() { return file != 0; }
+
+    // The ppu position is where it is as of this cpu cycle, which it may not have caught up to yet
+    void logInstruction(uint16 address, MOS6502<CPUBus>* cpu, CPUBus* cpuBus, uint32 scanline, uint32 dot, uint64 cpuCycle);
+
+    // Waits for the writer to catch up with everything logged so far
+    void flush();
+
+    // Writes out whatever is left and waits for the writer to finish
+    void close();
+
+private:
+    FILE* file = 0;
+
+    // Counts up and wraps, masked to the ring's size when used
+    TraceRecord* ring = 0;
+    std::atomic<uint32> writeIndex;
+    std::atomic<uint32> readIndex;
+
+    // Times the console had to wait on a full ring
+    uint32 stalls = 0;
+
+    std::thread writer;
+    std::atomic<bool> isClosing;
+
+    void writerLoop();
+};
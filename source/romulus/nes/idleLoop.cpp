@@ -0,0 +1,177 @@
+#include "idleLoop.h"
+
+// Code has to come straight from memory, a read handler could have side effects (or hand back something else next time)
+static bool readCode(CPUBus* bus, uint16 address, uint8* value)
+{
+    const uint8* byte = bus->getDirectPointer(address);
+    if (!byte)
+    {
+        return false;
+    }
+
+    *value = *byte;
+    return true;
+}
+
+// PPUSTATUS and its mirrors
+static bool isPPUStatus(uint16 address)
+{
+    return (address & 0xE007) == 0x2002;
+}
+
+uint32 IdleLoopDetector::checkLoop(MOS6502<CPUBus>* cpu, CPUBus* bus)
+{
+    uint16 start = cpu->pc;
+    uint16 end = cpu->instAddr;
+
+    uint64 instructions = cpu->instructionCount - instructionCount;
+    bool isSameLoop = start == loopStart && end == loopEnd && cpu->interruptCount == interruptCount;
+
+    loopStart = start;
+    loopEnd = end;
+    instructionCount = cpu->instructionCount;
+    interruptCount = cpu->interruptCount;
+
+    // Looked at every time, a bank switch or a write could have changed the code (or what it reads) since the last pass
+    settled = false;
+    if (!analyze(bus, start, end))
+    {
+        return 0;
+    }
+
+    // Only whole passes can have run since it last came around (none if the last one was skipped), otherwise
+    // the one that just finished could have started partway in with something else's registers
+    settled = isSameLoop && instructions % passInstructions == 0;
+    return passCycles;
+}
+
+bool IdleLoopDetector::analyze(CPUBus* bus, uint16 start, uint16 end)
+{
+    passInstructions = 0;
+    passCycles = 0;
+    readsPPUStatus = false;
+
+    bool isALoaded = false;
+
+    uint16 address = start;
+    while (address != end)
+    {
+        // Ran past the jump back, so it isn't an instruction boundary
+        if ((uint16)(address - start) > (uint16)(end - start))
+        {
+            return false;
+        }
+
+        uint8 opcode = 0;
+        uint8 lo = 0;
+        uint8 hi = 0;
+        if (!readCode(bus, address, &opcode))
+        {
+            return false;
+        }
+
+        const Operation& operation = operations[opcode];
+        uint32 length = getInstructionLength(operation.addressMode);
+        if ((length > 1 && !readCode(bus, address + 1, &lo)) || (length > 2 && !readCode(bus, address + 2, &hi)))
+        {
+            return false;
+        }
+
+        switch (operation.addressMode)
+        {
+            case Immediate:
+            {
+                passCycles += 2;
+                break;
+            }
+            // Always ram
+            case ZeroPage:
+            {
+                passCycles += 3;
+                break;
+            }
+            case Absolute:
+            {
+                uint16 operand = ((uint16)hi << 8) | lo;
+                if (isPPUStatus(operand))
+                {
+                    readsPPUStatus = true;
+                }
+                // Ram, prg ram and rom only change when the cpu writes to them
+                else if (!bus->isDirectRead(operand))
+                {
+                    return false;
+                }
+
+                passCycles += 4;
+                break;
+            }
+            default:
+            {
+                return false;
+            }
+        }
+
+        switch (operation.opCode)
+        {
+            case LDA: isALoaded = true; break;
+            case LDX: case LDY: break;
+            case CMP: case CPX: case CPY: case BIT: break;
+
+            // These build on a, so it has to come from this pass rather than the last one
+            case AND: case ORA: case EOR:
+            {
+                if (!isALoaded)
+                {
+                    return false;
+                }
+
+                break;
+            }
+            default:
+            {
+                return false;
+            }
+        }
+
+        ++passInstructions;
+        address += (uint16)length;
+    }
+
+    uint8 opcode = 0;
+    uint8 lo = 0;
+    uint8 hi = 0;
+    if (!readCode(bus, end, &opcode) || !readCode(bus, end + 1, &lo))
+    {
+        return false;
+    }
+
+    const Operation& operation = operations[opcode];
+    if (operation.addressMode == Relative)
+    {
+        uint16 next = end + 2;
+        if ((uint16)(next + (int8)lo) != start)
+        {
+            return false;
+        }
+
+        // Taken, plus one more if it crosses a page
+        passCycles += (next & 0xFF00) == (start & 0xFF00) ? 3 : 4;
+    }
+    else if (operation.opCode == JMP && operation.addressMode == Absolute)
+    {
+        if (!readCode(bus, end + 2, &hi) || (((uint16)hi << 8) | lo) != start)
+        {
+            return false;
+        }
+
+        passCycles += 3;
+    }
+    else
+    {
+        return false;
+    }
+
+    ++passInstructions;
+    return true;
+}
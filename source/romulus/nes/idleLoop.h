@@ -0,0 +1,58 @@
+#pragma once
+#include "romulus.h"
+#include "6502.h"
+#include "cpuBus.h"
+
+// Spots the loops games spin in while they wait for the next frame, ex:
+//   wait: LDA $2002        wait: LDA frameDone        wait: JMP wait
+//         BPL wait               BEQ wait
+// The body can only read ram, rom or PPUSTATUS and load, compare or test registers before a branch or jump back to the
+// start, and each register it changes has to be loaded in the same pass. So once one pass has run through without an
+// interrupt, every pass after it reads the same things and ends up in exactly the same state, until something outside
+// the cpu changes what it reads (an interrupt handler, or the ppu for PPUSTATUS). NES::skipIdleLoop uses that to let
+// passes go by without running them.
+class IdleLoopDetector
+{
+public:
+    // Called at each instruction boundary. Returns the cycles a pass takes when the cpu has just come back around
+    // a loop like that, 0 otherwise
+    uint32 check(MOS6502<CPUBus>* cpu, CPUBus* bus)
+    {
+        // Only worth a look right after a short jump backwards
+        uint16 distance = cpu->instAddr - cpu->pc;
+        if (distance > MAX_LOOP_BYTES)
+        {
+            return 0;
+        }
+
+        return checkLoop(cpu, bus);
+    }
+
+    // Whether the pass that just finished ran all the way through on its own since the last time check found the loop
+    // (or was skipped), so the cpu is already in the state every pass from here ends in
+    bool isSettled() { return settled; }
+
+    // Whether the loop reads PPUSTATUS, which the ppu can change on its own
+    bool isPollingPPUStatus() { return readsPPUStatus; }
+
+private:
+    // The loop body up to (not including) the jump back
+    static const uint16 MAX_LOOP_BYTES = 12;
+
+    uint16 loopStart = 0;
+    uint16 loopEnd = 0;
+
+    // Counts from the last time the cpu came around, to tell that only the loop ran since
+    uint64 instructionCount = 0;
+    uint64 interruptCount = 0;
+
+    uint32 passInstructions = 0;
+    uint32 passCycles = 0;
+    bool readsPPUStatus = false;
+    bool settled = false;
+
+    uint32 checkLoop(MOS6502<CPUBus>* cpu, CPUBus* bus);
+
+    // Fills in the pass's instructions and cycles, returns false if it isn't a loop that can be skipped
+    bool analyze(CPUBus* bus, uint16 start, uint16 end);
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "romulus.h"
+#include "saveState.h"
 
 // Reference https://www.nesdev.org/wiki/Standard_controller
 struct StandardController
@@ -41,4 +42,13 @@ struct StandardController
     void update(GamePad gamepad);
 
     void setButton(uint8 index, bool active);
+
+    // Mappings belong to the host so they aren't included
+    void serialize(SaveState* state)
+    {
+        state->value(currentState);
+        state->value(strobeState);
+        state->value(shiftCount);
+        state->value(strobeActive);
+    }
 };
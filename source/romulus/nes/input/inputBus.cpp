@@ -2,7 +2,7 @@
 
 // TODO: implement the controller and button mapping at this level
 
-void InputBus::init(PPU* ppu)
+void InputBus::init(PPU<PPUBus>* ppu)
 {
     this->ppu = ppu;
 
@@ -37,6 +37,19 @@ void InputBus::init(PPU* ppu)
     controllers[1].buttonMap[StandardController::RIGHT] = 0x27;
 }
 
+void InputBus::clearState()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        controllers[i].currentState = 0;
+        controllers[i].strobeState = 0;
+        controllers[i].shiftCount = 0;
+        controllers[i].strobeActive = false;
+    }
+
+    zapper.setState({});
+}
+
 uint8 InputBus::read(int portNumber)
 {
     switch (ports[portNumber].device)
@@ -97,3 +110,10 @@ void InputBus::update(InputState* rawInput)
         }
     }
 }
+
+void InputBus::serialize(SaveState* state)
+{
+    controllers[0].serialize(state);
+    controllers[1].serialize(state);
+    zapper.serialize(state);
+}
@@ -21,15 +21,20 @@ public:
     StandardController controllers[2];
     Zapper zapper;
 
-    void init(PPU* ppu);
+    void init(PPU<PPUBus>* ppu);
+
+    // Lets go of every button and the zapper, and clears the controllers' shift registers
+    void clearState();
 
     uint8 read(int portNumber);
     void write(uint8 value);
 
     void update(InputState* rawInput);
 
+    void serialize(SaveState* state);
+
     Port ports[2];
 
 private:
-    PPU* ppu;
+    PPU<PPUBus>* ppu;
 };
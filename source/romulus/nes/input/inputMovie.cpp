@@ -0,0 +1,171 @@
+#include "inputMovie.h"
+
+#include <string.h>
+#include <errno.h>
+
+bool InputMovie::startRecording(const char* path, const InputMovieHeader& header, const uint8* state)
+{
+    if (mode != MOVIE_IDLE)
+    {
+        logError("A movie is already running, stop it before recording %s\n", path);
+        return false;
+    }
+
+    file = fopen(path, "wb");
+    if (!file)
+    {
+        logError("Failed to open %s for writing: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    this->header = header;
+    this->header.magic = INPUT_MOVIE_MAGIC;
+    this->header.version = INPUT_MOVIE_VERSION;
+    this->header.frameCount = 0;
+
+    fwrite(&this->header, sizeof(this->header), 1, file);
+    fwrite(state, 1, header.stateSize, file);
+
+    mode = MOVIE_RECORDING;
+    frameCount = 0;
+    pendingFlags = 0;
+    desyncFrame = -1;
+
+    return true;
+}
+
+bool InputMovie::startPlayback(const char* path)
+{
+    if (mode != MOVIE_IDLE)
+    {
+        logError("A movie is already running, stop it before playing %s\n", path);
+        return false;
+    }
+
+    FILE* input = fopen(path, "rb");
+    if (!input)
+    {
+        logError("Failed to open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    fseek(input, 0, SEEK_END);
+    long size = ftell(input);
+    fseek(input, 0, SEEK_SET);
+
+    if (size < (long)sizeof(InputMovieHeader) || fread(&header, sizeof(header), 1, input) != 1
+        || header.magic != INPUT_MOVIE_MAGIC)
+    {
+        logError("%s isn't a movie\n", path);
+        fclose(input);
+        return false;
+    }
+
+    if (header.version != INPUT_MOVIE_VERSION)
+    {
+        logError("%s is movie version %u, expected %u\n", path, header.version, INPUT_MOVIE_VERSION);
+        fclose(input);
+        return false;
+    }
+
+    if ((uint64)size < sizeof(header) + header.stateSize)
+    {
+        logError("%s is cut off before the starting state\n", path);
+        fclose(input);
+        return false;
+    }
+
+    // A recording that was never closed still has a frame count of 0, but everything written is usable
+    uint32 framesInFile = (uint32)(((uint64)size - sizeof(header) - header.stateSize) / sizeof(MovieFrame));
+    if (header.frameCount == 0 || header.frameCount > framesInFile)
+    {
+        header.frameCount = framesInFile;
+    }
+
+    uint32 dataSize = header.stateSize + (header.frameCount * sizeof(MovieFrame));
+    data = new uint8[dataSize];
+    if (fread(data, 1, dataSize, input) != dataSize)
+    {
+        logError("Failed reading %s\n", path);
+        delete[] data;
+        data = 0;
+        fclose(input);
+        return false;
+    }
+
+    fclose(input);
+
+    startState = data;
+    frames = (const MovieFrame*)(data + header.stateSize);
+
+    mode = MOVIE_PLAYING;
+    frameCount = 0;
+    desyncFrame = -1;
+
+    return true;
+}
+
+void InputMovie::record(MovieFrame frame)
+{
+    if (mode != MOVIE_RECORDING)
+    {
+        return;
+    }
+
+    frame.flags |= pendingFlags;
+    pendingFlags = 0;
+
+    fwrite(&frame, sizeof(frame), 1, file);
+    ++frameCount;
+}
+
+const MovieFrame* InputMovie::nextFrame()
+{
+    if (mode != MOVIE_PLAYING)
+    {
+        return 0;
+    }
+
+    if (frameCount >= header.frameCount)
+    {
+        close();
+        return 0;
+    }
+
+    return frames + frameCount++;
+}
+
+void InputMovie::checkFrame(const MovieFrame* frame, uint64 frameHash)
+{
+    if (frame->frameHash == frameHash || desyncFrame >= 0)
+    {
+        return;
+    }
+
+    desyncFrame = (int32)(frame - frames);
+    logError("Movie desynced on frame %d, hash %016llx but the recording has %016llx\n", desyncFrame,
+        (unsigned long long)frameHash, (unsigned long long)frame->frameHash);
+}
+
+uint32 InputMovie::close()
+{
+    if (mode == MOVIE_RECORDING)
+    {
+        // Now that the count is known
+        header.frameCount = frameCount;
+        fseek(file, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, file);
+        fclose(file);
+        file = 0;
+    }
+    else if (mode == MOVIE_PLAYING)
+    {
+        delete[] data;
+        data = 0;
+        startState = 0;
+        frames = 0;
+    }
+
+    mode = MOVIE_IDLE;
+    return frameCount;
+}
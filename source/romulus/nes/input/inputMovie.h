@@ -0,0 +1,101 @@
+#pragma once
+#include "romulus.h"
+
+#include <stdio.h>
+
+// Movies are a header, the save state the recording started from, then a record for every update.
+// Each record has everything that came from outside the console that update (how long it ran, what the
+// controllers and zapper read, whether it was reset) along with the console's state hash at the end of it
+// (see NES::getStateHash), so playback can tell the moment it stops matching the recording.
+const uint32 INPUT_MOVIE_MAGIC = fourCC('R', 'M', 'I', 'M');
+const uint16 INPUT_MOVIE_VERSION = 2;
+
+enum MovieFrameFlags
+{
+    // The console was reset just before this update
+    MOVIE_RESET = BIT_0,
+};
+
+#pragma pack(push, 1)
+struct InputMovieHeader
+{
+    uint32 magic;
+    uint16 version;
+    uint32 romHash;
+
+    // What was plugged into each port, see InputBus::ports
+    uint8 portDevices[2];
+    int8 portIndices[2];
+
+    uint32 stateSize;
+    uint32 frameCount;
+};
+
+struct MovieFrame
+{
+    real32 seconds;
+    uint8 flags;
+    uint8 pads[2];
+    int16 zapperX;
+    int16 zapperY;
+    real32 zapperActiveMs;
+    uint64 frameHash;
+};
+#pragma pack(pop)
+
+enum InputMovieMode
+{
+    MOVIE_IDLE,
+    MOVIE_RECORDING,
+    MOVIE_PLAYING
+};
+
+// Records or plays back one movie at a time, the console does the work of applying the frames
+class InputMovie
+{
+public:
+    // Writes the header and starting state right away, frames are appended as they're recorded
+    bool startRecording(const char* path, const InputMovieHeader& header, const uint8* state);
+
+    // Reads the whole movie in, the header and starting state are checked against the console by the caller
+    bool startPlayback(const char* path);
+
+    bool isRecording() { return mode == MOVIE_RECORDING; }
+    bool isPlaying() { return mode == MOVIE_PLAYING; }
+
+    const InputMovieHeader& getHeader() { return header; }
+    const uint8* getStartState() { return startState; }
+
+    // Noted on the next recorded frame
+    void markReset() { pendingFlags |= MOVIE_RESET; }
+    void record(MovieFrame frame);
+
+    // The next frame to play, or null once the movie is over (which also stops playback)
+    const MovieFrame* nextFrame();
+
+    // Compares the hash the console came up with to the recorded one, only the first mismatch is reported
+    void checkFrame(const MovieFrame* frame, uint64 frameHash);
+
+    // Frames recorded or played so far, still valid after the movie stops
+    uint32 getFrameCount() { return frameCount; }
+
+    // The first frame that didn't match the recording, or -1 if they've all matched
+    int32 getDesyncFrame() { return desyncFrame; }
+
+    // Finishes off a recording (or drops a playback). Returns the number of frames in it
+    uint32 close();
+
+private:
+    InputMovieMode mode = MOVIE_IDLE;
+    InputMovieHeader header = {};
+    FILE* file = 0;
+
+    // Playback keeps the whole file in memory, the state and frames point into it
+    uint8* data = 0;
+    const uint8* startState = 0;
+    const MovieFrame* frames = 0;
+
+    uint32 frameCount = 0;
+    uint8 pendingFlags = 0;
+    int32 desyncFrame = -1;
+};
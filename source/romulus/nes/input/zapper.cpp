@@ -3,7 +3,7 @@
 
 // TODO: Implement playchoice/vs system version that goes through the strobing mechanic like a normal controller
 
-uint8 Zapper::read(PPU* ppu)
+uint8 Zapper::read(PPU<PPUBus>* ppu)
 {
     uint8 output = 0;
     if (!lightDetected(ppu))
@@ -36,7 +36,7 @@ void Zapper::update(Mouse mouse, real32 elapsedMs)
     }
 }
 
-bool Zapper::lightDetected(PPU* ppu)
+bool Zapper::lightDetected(PPU<PPUBus>* ppu)
 {
     // We assume darkness when pointed away from the screen
     if (x < 0 || x >= NES_SCREEN_WIDTH || y < 0 || y >= NES_SCREEN_HEIGHT)
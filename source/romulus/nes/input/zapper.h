@@ -1,13 +1,37 @@
 #pragma once
 
 #include "platform.h"
-#include "nes/ppu/ppu.h"
+#include "nes/ppuBus.h"
+
+// What the zapper is pointed at and how much longer the trigger reads as pulled
+struct ZapperState
+{
+    int32 x;
+    int32 y;
+    real32 activeCounterMs;
+};
 
 class Zapper
 {
 public:
-    uint8 read(PPU* ppu);
+    uint8 read(PPU<PPUBus>* ppu);
     void update(Mouse mouse, real32 elapsedMs);
+
+    // For movies, which record the result of each update rather than the mouse that drove it
+    ZapperState getState() { return { x, y, activeCounterMs }; }
+    void setState(ZapperState state)
+    {
+        x = state.x;
+        y = state.y;
+        activeCounterMs = state.activeCounterMs;
+    }
+
+    void serialize(SaveState* state)
+    {
+        state->value(x);
+        state->value(y);
+        state->value(activeCounterMs);
+    }
     
 private:
     int32 x;
@@ -16,5 +40,5 @@ private:
     // Used to track how long the "half pull" state should be active
     real32 activeCounterMs;
 
-    bool lightDetected(PPU* ppu);
+    bool lightDetected(PPU<PPUBus>* ppu);
 };
@@ -0,0 +1,30 @@
+#include "axrom.h"
+
+void AxROM::reset()
+{
+    Mapper::reset();
+
+    // Mapper 7 switches on 32 kb instead of 16
+    prgRomBank1 = prgRom;
+    prgRomBank2 = prgRomBank1 + kilobytes(16);
+
+    mirrorMode = SINGLE_SCREEN_LOWER;
+}
+
+bool AxROM::prgWrite(uint16 address, uint8 value)
+{
+    uint8 bank = value & 0x07;
+    prgRomBank1 = prgRom + (bank * kilobytes(32));
+    prgRomBank2 = prgRomBank1 + kilobytes(16);
+
+    if (value & BIT_4)
+    {
+        mirrorMode = SINGLE_SCREEN_UPPER;
+    }
+    else
+    {
+        mirrorMode = SINGLE_SCREEN_LOWER;
+    }
+
+    return true;
+}
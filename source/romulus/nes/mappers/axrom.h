@@ -0,0 +1,13 @@
+#pragma once
+#include "mapper.h"
+
+// Switches prg in 32kb chunks and picks the single screen nametable
+// See: https://www.nesdev.org/wiki/AxROM
+class AxROM : public Mapper
+{
+public:
+    const char* getName() override { return "AxROM"; }
+
+    void reset() override;
+    bool prgWrite(uint16 address, uint8 value) override;
+};
@@ -0,0 +1,9 @@
+#include "cnrom.h"
+
+bool CNROM::prgWrite(uint16 address, uint8 value)
+{
+    // TODO: Theres a note on the wiki mentioning larger size variants, may be another mapper?
+    patternTable0 = chrRom + (kilobytes(8) * (value & 0x03));
+    patternTable1 = patternTable0 + kilobytes(4);
+    return false;
+}
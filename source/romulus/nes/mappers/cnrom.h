@@ -0,0 +1,12 @@
+#pragma once
+#include "mapper.h"
+
+// Fixed prg with a switchable 8kb chr bank
+// See: https://www.nesdev.org/wiki/CNROM
+class CNROM : public Mapper
+{
+public:
+    const char* getName() override { return "CNROM"; }
+
+    bool prgWrite(uint16 address, uint8 value) override;
+};
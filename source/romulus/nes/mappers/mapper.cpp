@@ -0,0 +1,120 @@
+#include "mapper.h"
+#include "nrom.h"
+#include "mmc1.h"
+#include "uxrom.h"
+#include "cnrom.h"
+#include "mmc3.h"
+#include "axrom.h"
+#include "mmc2.h"
+
+Mapper* createMapper(int mapperNumber)
+{
+    switch (mapperNumber)
+    {
+        case 0: return new NROM();
+        case 1: return new MMC1();
+        case 2: return new UxROM();
+        case 3: return new CNROM();
+        case 4: return new MMC3();
+        case 7: return new AxROM();
+        case 9: return new MMC2();
+    }
+
+    return 0;
+}
+
+void Mapper::load(const MapperConfig& config)
+{
+    prgRomSize = config.prgRomSize;
+    prgRom = config.prgRom;
+    chrRomSize = config.chrRomSize;
+    chrRom = config.chrRom;
+    chrBase = config.chrBase;
+    defaultMirroring = config.defaultMirroring;
+}
+
+void Mapper::reset()
+{
+    isReadOnly = false;
+
+    // NOTE: These default pointers seem to work for several mappers
+
+    // 0x8000 on the first bank and 0xC000 mapped to the last one
+    prgRomBank1 = prgRom;
+    prgRomBank2 = prgRom + kilobytes(16) * (prgRomSize - 1);
+
+    // Mapped as if there's no switching
+    patternTable0 = chrBase;
+    patternTable1 = chrBase + kilobytes(4);
+
+    mirrorMode = defaultMirroring;
+}
+
+uint8* Mapper::prgMemory(uint16 address)
+{
+    if (address < 0xC000)
+    {
+        return prgRomBank1 + (address - 0x8000);
+    }
+
+    return prgRomBank2 + (address - 0xC000);
+}
+
+uint8 Mapper::chrRead(uint16 address)
+{
+    if (address < 0x1000)
+    {
+        return patternTable0[address];
+    }
+
+    return patternTable1[address - 0x1000];
+}
+
+uint8* Mapper::chrMemory(uint16 address)
+{
+    if (address < 0x1000)
+    {
+        return patternTable0 + address;
+    }
+
+    return patternTable1 + (address - 0x1000);
+}
+
+void Mapper::chrWrite(uint16 address, uint8 value)
+{
+    // Only boards without CHR ROM have anything to write to
+    if (chrRomSize == 0)
+    {
+        if (address < 0x1000)
+        {
+            patternTable0[address] = value;
+        }
+        else
+        {
+            patternTable1[address - 0x1000] = value;
+        }
+    }
+}
+
+void Mapper::serialize(SaveState* state)
+{
+    state->enumValue(mirrorMode, SINGLE_SCREEN_UPPER);
+    state->value(irqPending);
+
+    serializePrgPointer(state, prgRomBank1, prgRomBank1Size);
+    serializePrgPointer(state, prgRomBank2, prgRomBank2Size);
+    serializeChrPointer(state, patternTable0, kilobytes(4));
+    serializeChrPointer(state, patternTable1, kilobytes(4));
+}
+
+void Mapper::serializePrgPointer(SaveState* state, uint8*& bank, uint32 bankSize)
+{
+    state->pointer(bank, prgRom, kilobytes(16) * prgRomSize, bankSize);
+}
+
+void Mapper::serializeChrPointer(SaveState* state, uint8*& bank, uint32 bankSize)
+{
+    // Boards without chr rom point into the 8kb of chr ram
+    uint32 chrSize = chrRomSize ? kilobytes(8) * chrRomSize : kilobytes(8);
+    state->pointer(bank, chrBase, chrSize, bankSize);
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "romulus.h"
+#include "saveState.h"
+
+enum MirrorMode
+{
+    MIRROR_HORIZONTAL,
+    MIRROR_VERTICAL,
+    SINGLE_SCREEN_LOWER,
+    SINGLE_SCREEN_UPPER,
+};
+
+// Rom layout handed over by the cartridge once the file has been parsed
+struct MapperConfig
+{
+    // Number of PRG ROM chips (16KB each)
+    uint8 prgRomSize;
+    uint8* prgRom;
+
+    // Number of CHR ROM chips (8KB each), zero when the board uses CHR RAM
+    uint8 chrRomSize;
+    uint8* chrRom;
+
+    // Points to chrROM or chrRAM depending on the board
+    uint8* chrBase;
+
+    MirrorMode defaultMirroring;
+};
+
+// Base for all the cartridge boards. The default behaviour is a fixed layout with no registers,
+// so each mapper only overrides the pieces where its wiring differs.
+// See: https://www.nesdev.org/wiki/Mapper
+class Mapper
+{
+public:
+    virtual ~Mapper() {}
+
+    void load(const MapperConfig& config);
+
+    virtual const char* getName() = 0;
+
+    // Resets variables and banks to their default positions for the loaded rom
+    virtual void reset();
+
+    // Returns the byte backing the given prg rom address (0x8000 - 0xFFFF) for the current banks
+    virtual uint8* prgMemory(uint16 address);
+
+    // Mappers take advantage of the fact that the upper section
+    // of memory is (typically) ROM and thus unwritable. The write request
+    // is intercepted and shoved off to another set of chips that
+    // can change the configuration of the mapper.
+    // Returns true if the prg layout may have changed and the cpu pages need a remap
+    virtual bool prgWrite(uint16 address, uint8 value) { return false; }
+
+    // Mappers that react to cpu reads can't have their prg mapped straight into the cpu pages.
+    // While this returns true every cartridge read is passed to onPrgRead first
+    virtual bool hasPrgReadSideEffects() { return false; }
+    virtual void onPrgRead() {}
+
+    virtual uint8 chrRead(uint16 address);
+    virtual void chrWrite(uint16 address, uint8 value);
+
+    // Returns the byte backing the given pattern table address for the current banks, without any read side effects
+    virtual uint8* chrMemory(uint16 address);
+
+    // Mappers that watch ppu fetches (latches, irq counters) need every pattern read to go through chrRead
+    virtual bool hasChrReadSideEffects() { return false; }
+
+    // Mappers that count ppu fetches to raise irqs need the ppu and cpu to run in lockstep
+    virtual bool hasPPUClockedIrq() { return false; }
+
+    // Only mappers that return true here get ticked every cpu cycle
+    virtual bool needsCpuTick() { return false; }
+    virtual void tickCPU() {}
+
+    // Bank pointers are stored as offsets into the rom. Overrides need to call down to this
+    virtual void serialize(SaveState* state);
+
+    MirrorMode mirrorMode;
+    bool irqPending;
+
+    // Used to turn off side effects on read operations (Mainly mapper 9 at the moment)
+    bool isReadOnly;
+
+protected:
+    uint8 prgRomSize;
+    uint8* prgRom;
+
+    uint8 chrRomSize;
+    uint8* chrRom;
+    uint8* chrBase;
+
+    MirrorMode defaultMirroring;
+
+    // Points to the PRG bank mapped to 0x8000
+    uint8* prgRomBank1;
+
+    // Points to the PRG bank mapped to 0xC000
+    uint8* prgRomBank2;
+
+    // Points to the CHR bank mapped to 0x0000
+    uint8* patternTable0;
+
+    // Points to the CHR bank mapped to 0x1000
+    uint8* patternTable1;
+
+    // How much of the rom is read through each prg bank, so banks loaded from a save state can be checked to fit
+    uint32 prgRomBank1Size = kilobytes(16);
+    uint32 prgRomBank2Size = kilobytes(16);
+
+    // Save state helpers for pointers into prg and chr, loads fail unless the whole bank is inside the rom
+    void serializePrgPointer(SaveState* state, uint8*& bank, uint32 bankSize);
+    void serializeChrPointer(SaveState* state, uint8*& bank, uint32 bankSize);
+};
+
+// Creates the implementation for an iNES mapper number, returns null if it isn't supported
+Mapper* createMapper(int mapperNumber);
@@ -0,0 +1,159 @@
+#include "mmc1.h"
+
+void MMC1::reset()
+{
+    Mapper::reset();
+
+    ignoreNextWrite = false;
+    shiftRegister = BIT_4;
+
+    // Horizontal by default
+    control = 3;
+    if (mirrorMode == MIRROR_VERTICAL)
+    {
+        control = 2;
+    }
+
+    // Going to default the ROM bank mode to be similar to UxROM for now
+    // That means first bank movable, second bank fixed on the last ROM chip
+    control |= 0x0C;
+    prgBank = 0;
+
+    // CHR config can stay on the zero induced default of 8kb for now
+    chr0 = 0;
+    chr1 = 0;
+    chrBankMask = (chrRomSize ? chrRomSize * 2 : 2) - 1;
+
+    // Reset the pointers based on the rules
+    remapPrg();
+    remapChr();
+}
+
+// TODO: Handle variants based on chip sizes https://www.nesdev.org/wiki/MMC1#iNES_Mapper_001
+bool MMC1::prgWrite(uint16 address, uint8 value)
+{
+    if (ignoreNextWrite)
+    {
+        return false;
+    }
+
+    ignoreNextWrite = true;
+
+    if (value & BIT_7)
+    {
+        shiftRegister = BIT_4;
+        control |= 0x0C;
+        remapPrg();
+    }
+    else
+    {
+        bool isFifthWrite = shiftRegister & BIT_0;
+
+        // Every write we load bit 0 into the left side of the register
+        shiftRegister >>= 1;
+        shiftRegister |= (value & BIT_0) << 4;
+
+        // Load into the right internal register based on bits 13 and 14 of the address
+        if (isFifthWrite)
+        {
+            uint16 selectBits = (address >> 13) & 0x0003;
+            if (selectBits == 0)
+            {
+                control = shiftRegister;
+
+                uint8 mirroring = control & 0x03;
+                if (mirroring == 0)
+                {
+                    mirrorMode = SINGLE_SCREEN_LOWER;
+                }
+                else if (mirroring == 1)
+                {
+                    mirrorMode = SINGLE_SCREEN_UPPER;
+                }
+                else if (mirroring == 2)
+                {
+                    mirrorMode = MIRROR_VERTICAL;
+                }
+                else
+                {
+                    mirrorMode = MIRROR_HORIZONTAL;
+                }
+
+                // Need to reset all the pointers in case the mode has changed (Could check if its
+                // changed but that just more overhead potentially)
+                remapPrg();
+                remapChr();
+            }
+            else if (selectBits == 1)
+            {
+                chr0 = shiftRegister;
+                remapChr();
+            }
+            else if (selectBits == 2)
+            {
+                chr1 = shiftRegister;
+                remapChr();
+            }
+            else if (selectBits == 3)
+            {
+                prgBank = (shiftRegister & 0x0F);
+                remapPrg();
+            }
+
+            shiftRegister = BIT_4;
+        }
+    }
+
+    // The write filter is armed either way, so the cpu pages need to drop their direct reads
+    return true;
+}
+
+void MMC1::remapPrg()
+{
+    assert(prgBank < prgRomSize)
+
+    uint8 mode = (control >> 2) & 0x03;
+    if (mode == 2)
+    {
+        prgRomBank1 = prgRom;
+        prgRomBank2 = prgRom + (prgBank * kilobytes(16));
+    }
+    else if (mode == 3)
+    {
+        prgRomBank1 = prgRom + (prgBank * kilobytes(16));
+        prgRomBank2 = prgRom + (kilobytes(16) * (prgRomSize - 1));
+    }
+    else
+    {
+        prgRomBank1 = prgRom + ((prgBank & 0xFE) * kilobytes(16));
+        prgRomBank2 = prgRomBank1 + kilobytes(16);
+    }
+}
+
+void MMC1::remapChr()
+{
+    // CHR ROM mode (0: single 8kb bank, 1: 2 x 4kb banks)
+    if ((control & BIT_4) == 0)
+    {
+        // low bit ignored in 8kb mode to avoid overflow
+        patternTable0 = chrBase + ((chr0 & 0xFE & chrBankMask) * kilobytes(4));
+        patternTable1 = patternTable0 + kilobytes(4);
+    }
+    else
+    {
+        patternTable0 = chrBase + ((chr0 & chrBankMask) * kilobytes(4));
+        patternTable1 = chrBase + ((chr1 & chrBankMask) * kilobytes(4));
+    }
+}
+
+void MMC1::serialize(SaveState* state)
+{
+    Mapper::serialize(state);
+
+    state->value(ignoreNextWrite);
+    state->value(shiftRegister);
+    state->value(control);
+    state->value(chr0);
+    state->value(chr1);
+    state->value(prgBank);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "mapper.h"
+
+// Serial shift register driven mapper with switchable prg and chr in a few layouts
+// See: https://www.nesdev.org/wiki/MMC1
+// TODO: MMC1, Handle CHR RAM variants like SNROM, SOROM, etc.
+class MMC1 : public Mapper
+{
+public:
+    const char* getName() override { return "MMC1"; }
+
+    void reset() override;
+    bool prgWrite(uint16 address, uint8 value) override;
+
+    // Consecutive writes are filtered until the cpu reads from the cart again
+    bool hasPrgReadSideEffects() override { return ignoreNextWrite; }
+    void onPrgRead() override { ignoreNextWrite = false; }
+
+    void serialize(SaveState* state) override;
+
+private:
+    bool ignoreNextWrite;
+
+    uint8 shiftRegister;
+    uint8 control;
+    uint8 chr0;
+    uint8 chr1;
+    uint8 prgBank;
+
+    // Bank selects are masked to the chr size in 4kb units so we can't read past the end of the rom
+    uint8 chrBankMask;
+
+    void remapPrg();
+    void remapChr();
+};
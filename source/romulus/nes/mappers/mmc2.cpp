@@ -0,0 +1,126 @@
+#include "mmc2.h"
+
+void MMC2::reset()
+{
+    Mapper::reset();
+
+    // NOTE: Used for the static section
+    prgRomBank2 = prgRom + (kilobytes(16) * prgRomSize) - (kilobytes(8) * 3);
+    prgRomBank1Size = kilobytes(8);
+    prgRomBank2Size = kilobytes(8) * 3;
+
+    chrLatch0 = 0xFE;
+    chrLatch1 = 0xFE;
+
+    // Default these to use the same banks for now
+    chrRom0FD = chrRom;
+    chrRom1FD = chrRom + kilobytes(4);
+
+    chrRom0FE = chrRom;
+    chrRom1FE = chrRom + kilobytes(4);
+}
+
+uint8* MMC2::prgMemory(uint16 address)
+{
+    if (address < 0xA000)
+    {
+        return prgRomBank1 + (address - 0x8000);
+    }
+
+    return prgRomBank2 + (address - 0xA000);
+}
+
+bool MMC2::prgWrite(uint16 address, uint8 value)
+{
+    uint16 registerSelect = address & 0xF000;
+    if (registerSelect == 0xA000)
+    {
+        prgRomBank1 = prgRom + (kilobytes(8) * (value & 0x0F));
+        return true;
+    }
+
+    if (registerSelect == 0xB000)
+    {
+        chrRom0FD = chrRom + (kilobytes(4) * (value & 0x1F));
+        patternTable0 = chrRom0FD;
+    }
+    else if (registerSelect == 0xC000)
+    {
+        chrRom0FE = chrRom + (kilobytes(4) * (value & 0x1F));
+        patternTable0 = chrRom0FE;
+    }
+    else if (registerSelect == 0xD000)
+    {
+        chrRom1FD = chrRom + (kilobytes(4) * (value & 0x1F));
+        if (chrLatch1 == 0xFD)
+        {
+            patternTable1 = chrRom1FD;
+        }
+    }
+    else if (registerSelect == 0xE000)
+    {
+        chrRom1FE = chrRom + (kilobytes(4) * (value & 0x1F));
+        if (chrLatch1 == 0xFE)
+        {
+            patternTable1 = chrRom1FE;
+        }
+    }
+    else if (registerSelect == 0xF000)
+    {
+        if (value & BIT_0)
+        {
+            mirrorMode = MIRROR_HORIZONTAL;
+        }
+        else
+        {
+            mirrorMode = MIRROR_VERTICAL;
+        }
+    }
+
+    return false;
+}
+
+uint8 MMC2::chrRead(uint16 address)
+{
+    uint8 result = Mapper::chrRead(address);
+
+    // Check has to happen after the read
+    if (!isReadOnly)
+    {
+        if (address == 0x0FD8)
+        {
+            chrLatch0 = 0xFD;
+            patternTable0 = chrRom0FD;
+        }
+        else if (address == 0x0FE8)
+        {
+            chrLatch0 = 0xFE;
+            patternTable0 = chrRom0FE;
+        }
+        else if (address >= 0x1FD8 && address <= 0x1FDF)
+        {
+            chrLatch1 = 0xFD;
+            patternTable1 = chrRom1FD;
+        }
+        else if (address >= 0x1FE8 && address <= 0x1FEF)
+        {
+            chrLatch1 = 0xFE;
+            patternTable1 = chrRom1FE;
+        }
+    }
+
+    return result;
+}
+
+void MMC2::serialize(SaveState* state)
+{
+    Mapper::serialize(state);
+
+    state->value(chrLatch0);
+    serializeChrPointer(state, chrRom0FE, kilobytes(4));
+    serializeChrPointer(state, chrRom0FD, kilobytes(4));
+
+    state->value(chrLatch1);
+    serializeChrPointer(state, chrRom1FE, kilobytes(4));
+    serializeChrPointer(state, chrRom1FD, kilobytes(4));
+}
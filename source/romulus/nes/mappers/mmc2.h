@@ -0,0 +1,30 @@
+#pragma once
+#include "mapper.h"
+
+// Punch-Out!! board. Chr banks are swapped automatically when the ppu fetches specific tiles
+// See: https://www.nesdev.org/wiki/MMC2
+class MMC2 : public Mapper
+{
+public:
+    const char* getName() override { return "MMC2"; }
+
+    void reset() override;
+
+    // 0x8000 is a switchable 8kb bank, the rest is fixed
+    uint8* prgMemory(uint16 address) override;
+    bool prgWrite(uint16 address, uint8 value) override;
+
+    uint8 chrRead(uint16 address) override;
+    bool hasChrReadSideEffects() override { return true; }
+
+    void serialize(SaveState* state) override;
+
+private:
+    uint8 chrLatch0;
+    uint8* chrRom0FE;
+    uint8* chrRom0FD;
+
+    uint8 chrLatch1;
+    uint8* chrRom1FE;
+    uint8* chrRom1FD;
+};
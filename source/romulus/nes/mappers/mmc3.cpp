@@ -0,0 +1,253 @@
+#include "mmc3.h"
+
+void MMC3::reset()
+{
+    Mapper::reset();
+
+    // The default configuration puts:
+    // - 2 x 2k banks on nameTable 0
+    // - 4 x 1k banks on nameTable 1
+    // - 0x8000-0x9FFF swappable
+    // - 0xA000-0xBFFF swappable (default to bank 2 for now)
+    // - 0xC000-0xDFFF fixed to second to last bank
+    // - 0xE000-0xFFFF fixed to last bank
+
+    // 0xE000 can't be changed
+    // 0xA000 is always directly swappable
+    // Other two can change roles between swappable and fixed based on mode
+    // which name table is the 2k banks and which is the 4 k is set by mode
+
+    chrBankMask = chrRomSize ? (chrRomSize * 8) - 1 : 7;
+
+    chrRomBanks[0] = chrBase;
+    chrRomBanks[1] = chrBase + kilobytes(2);
+    chrRomBanks[2] = chrBase + kilobytes(4);
+    chrRomBanks[3] = chrBase + kilobytes(5);
+    chrRomBanks[4] = chrBase + kilobytes(6);
+    chrRomBanks[5] = chrBase + kilobytes(7);
+
+    prgRomBanks[1] = prgRom + kilobytes(8);
+    prgRomBanks[3] = prgRom + (kilobytes(8) * (prgRomSize * 2 - 1));
+    remapPrg();
+}
+
+void MMC3::remapPrg()
+{
+    if (swapPrgRomHigh)
+    {
+        prgRomBanks[0] = prgRom + (kilobytes(16) * (prgRomSize - 1));
+        prgRomBanks[2] = prgRom + (kilobytes(8) * prgRomLowBank);
+    }
+    else
+    {
+        prgRomBanks[0] = prgRom + (kilobytes(8) * prgRomLowBank);
+        prgRomBanks[2] = prgRom + (kilobytes(16) * (prgRomSize - 1));
+    }
+}
+
+uint8* MMC3::prgMemory(uint16 address)
+{
+    uint8* selectedBank = prgRomBanks[(address & 0x6000) >> 13];
+    return selectedBank + (address & 0x1FFF);
+}
+
+bool MMC3::prgWrite(uint16 address, uint8 value)
+{
+    // Extract bits 13 and 14
+    uint16 registerSelect = (address & 0x6000) >> 13;
+    bool isEven = (address & BIT_0) == 0;
+
+    // 0x8000-0x9FFF Bank Switching registers
+    if (registerSelect == 0)
+    {
+        // Bank Select
+        if (isEven)
+        {
+            bankSelect = value & 0x07;
+            chr2KBanksAreHigh = value & BIT_7;
+
+            if ((value & BIT_6) != swapPrgRomHigh)
+            {
+                swapPrgRomHigh = value & BIT_6;
+                remapPrg();
+                return true;
+            }
+        }
+        // Bank Data
+        else if (bankSelect == 7)
+        {
+            uint8* newBank = prgRom + (kilobytes(8) * (value & ((prgRomSize * 2) - 1)));
+            prgRomBanks[1] = newBank;
+            return true;
+        }
+        else if (bankSelect == 6)
+        {
+            prgRomLowBank = value & ((prgRomSize * 2) - 1);
+            remapPrg();
+            return true;
+        }
+        else
+        {
+            value &= chrBankMask;
+            if (bankSelect < 2)
+            {
+                value &= 0xFE;
+            }
+
+            chrRomBanks[bankSelect] = chrBase + kilobytes(value);
+        }
+    }
+    // 0xA000-0xBFFF
+    else if (registerSelect == 1)
+    {
+        // Mirroring
+        if (isEven)
+        {
+            if (value & BIT_0)
+            {
+                mirrorMode = MIRROR_HORIZONTAL;
+            }
+            else
+            {
+                mirrorMode = MIRROR_VERTICAL;
+            }
+        }
+        // PRG RAM Protect
+        else
+        {
+            prgRamEnabled = (value & BIT_7) > 0;
+        }
+    }
+    // 0xC000-0xDFFF
+    else if (registerSelect == 2)
+    {
+        // IRQ Latch
+        if (isEven)
+        {
+            irqReloadValue = value;
+        }
+        // IRQ Reload
+        else
+        {
+            reloadIrqCounter = true;
+        }
+    }
+    // 0xE000-0xFFFF
+    else
+    {
+        irqEnabled = !isEven;
+        if (!irqEnabled)
+        {
+            irqPending = false;
+        }
+    }
+
+    return false;
+}
+
+uint8 MMC3::chrRead(uint16 address)
+{
+    setAddress(address);
+    return *chrMemory(address);
+}
+
+uint8* MMC3::chrMemory(uint16 address)
+{
+    bool isPatternTableHi = address & 0x1000;
+
+    // TODO: THIS IS GROSS. WHY DID I DO THIS?
+    // Answer: Cause its the dumb way that you know will work and you
+    // can clean it up later
+    // Don't direct compare! Since these are both masked out values it may not work?
+    if ((chr2KBanksAreHigh && isPatternTableHi)
+        || (!chr2KBanksAreHigh && !isPatternTableHi))
+    {
+        return chrRomBanks[(address & 0x0800) >> 11] + (address & 0x07FF);
+    }
+
+    return chrRomBanks[((address & 0x0C00) >> 10) + 2] + (address & 0x03FF);
+}
+
+void MMC3::chrWrite(uint16 address, uint8 value)
+{
+    setAddress(address);
+    Mapper::chrWrite(address, value);
+}
+
+void MMC3::tickIrq()
+{
+    if (reloadIrqCounter)
+    {
+        irqCounter = irqReloadValue;
+        reloadIrqCounter = false;
+    }
+    else if (irqCounter == 0)
+    {
+        irqCounter = irqReloadValue;
+        reloadIrqCounter = false;
+    }
+    else
+    {
+        --irqCounter;
+    }
+
+    if (irqCounter == 0 && irqEnabled)
+    {
+        irqPending = true;
+    }
+}
+
+void MMC3::setAddress(uint16 address)
+{
+    bool isPatternTableHi = address & 0x1000;
+    if (isPatternTableHi && !wasPatternHi && cpuM2Counter == 0)
+    {
+        tickIrq();
+        cpuM2Counter = 3;
+    }
+
+    wasPatternHi = isPatternTableHi;
+}
+
+void MMC3::tickCPU()
+{
+    if (isPatternTableHi)
+    {
+        cpuM2Counter = 3;
+    }
+    else if (cpuM2Counter > 0)
+    {
+        --cpuM2Counter;
+    }
+}
+
+void MMC3::serialize(SaveState* state)
+{
+    Mapper::serialize(state);
+
+    state->value(bankSelect);
+    state->value(swapPrgRomHigh);
+    state->value(chr2KBanksAreHigh);
+    state->value(prgRamEnabled);
+
+    state->value(irqEnabled);
+    state->value(irqReloadValue);
+    state->value(reloadIrqCounter);
+    state->value(irqCounter);
+
+    // The first two chr banks are 2kb, the rest 1kb
+    for (int i = 0; i < 6; ++i)
+    {
+        serializeChrPointer(state, chrRomBanks[i], i < 2 ? kilobytes(2) : kilobytes(1));
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        serializePrgPointer(state, prgRomBanks[i], kilobytes(8));
+    }
+
+    state->value(prgRomLowBank);
+    state->value(isPatternTableHi);
+    state->value(wasPatternHi);
+    state->value(cpuM2Counter);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "mapper.h"
+
+// 8kb prg and 1/2kb chr banks, plus a scanline counter clocked off of ppu address line 12
+// See: https://www.nesdev.org/wiki/MMC3
+class MMC3 : public Mapper
+{
+public:
+    const char* getName() override { return "MMC3 (Incomplete)"; }
+
+    void reset() override;
+
+    uint8* prgMemory(uint16 address) override;
+    bool prgWrite(uint16 address, uint8 value) override;
+
+    uint8 chrRead(uint16 address) override;
+    void chrWrite(uint16 address, uint8 value) override;
+    uint8* chrMemory(uint16 address) override;
+
+    bool hasChrReadSideEffects() override { return true; }
+    bool hasPPUClockedIrq() override { return true; }
+
+    // THIS IS A HACK to get mmc3 working
+    bool needsCpuTick() override { return true; }
+    void tickCPU() override;
+
+    void serialize(SaveState* state) override;
+
+private:
+    uint8 bankSelect;
+
+    // PRG ROM Bank mode bit is set
+    // Means 0x8000 range is fixed, vs 0xC000 range when disabled
+    // TODO: This name is hot garbage
+    bool swapPrgRomHigh;
+    bool chr2KBanksAreHigh;
+
+    // Determines whether the ram region returns open bus or the contents of ram
+    // This also maps to two different bits in different registers on mmc3 and mmc6 and both are mapper 4, so...
+    // TODO: Implement
+    bool prgRamEnabled;
+
+    uint8 irqEnabled;
+    uint8 irqReloadValue;
+    bool reloadIrqCounter;
+
+    uint8 irqCounter;
+
+    // There are 6 pointers that can be bank switched
+    // and the mode determines which ones to use where
+    uint8* chrRomBanks[6];
+
+    // There are 4 8k chunks, the last is always fixed but all the rest
+    // can be swapped around in various ways. This is indexed by bits 13 and 14
+    uint8* prgRomBanks[4];
+
+    // a temp variable used for the bank that isn't fixed second to last
+    uint8 prgRomLowBank;
+
+    // Masks out bits from any bank select so we can't overflow. This is in 1k chunks.
+    // Don't ask why but some roms rely on this even though they know they only have x amount
+    uint16 chrBankMask;
+
+    void remapPrg();
+    void tickIrq();
+
+    // This approach is a hack, because restructuring this whole thing is not in my plans at the moment
+    bool isPatternTableHi;
+    bool wasPatternHi;
+    void setAddress(uint16 address);
+
+    uint8 cpuM2Counter;
+};
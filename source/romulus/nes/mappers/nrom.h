@@ -0,0 +1,10 @@
+#pragma once
+#include "mapper.h"
+
+// Fixed 16 or 32kb of prg and 8kb of chr, nothing to switch
+// See: https://www.nesdev.org/wiki/NROM
+class NROM : public Mapper
+{
+public:
+    const char* getName() override { return "NROM"; }
+};
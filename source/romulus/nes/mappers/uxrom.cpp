@@ -0,0 +1,8 @@
+#include "uxrom.h"
+
+bool UxROM::prgWrite(uint16 address, uint8 value)
+{
+    // UxROM varieties are a direct mapping
+    prgRomBank1 = prgRom + kilobytes(16) * value;
+    return true;
+}
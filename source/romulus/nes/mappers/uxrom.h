@@ -0,0 +1,12 @@
+#pragma once
+#include "mapper.h"
+
+// Switchable 16kb bank at 0x8000, last bank fixed at 0xC000
+// See: https://www.nesdev.org/wiki/UxROM
+class UxROM : public Mapper
+{
+public:
+    const char* getName() override { return "UxROM"; }
+
+    bool prgWrite(uint16 address, uint8 value) override;
+};
@@ -1,19 +1,57 @@
 ﻿#include "nes.h"
-#include "cpuTrace.h"
 #include <string.h>
+#include <errno.h>
 #include "constants.h"
+#include "colorConversion.h"
 
 const uint32 masterClockHz = 21477272;
+const uint32 audioSampleRate = 48000;
+
+// ~85ms, so the ring sits at ~43ms of latency
+const uint32 defaultAudioBufferSize = 4096;
+
+// How far the sample rate can be pushed to keep the audio ring from running dry or filling up (dynamic rate control)
+// Small enough that the change in pitch can't be heard
+const real64 maxAudioRateAdjustment = 0.005;
 
 NES::NES()
 {
     cpu.connect(&cpuBus);
     ppu.connect(&ppuBus);
-    cpuBus.connect(&ppu, &apu, &cartridge, &inputBus);
+    cpuBus.connect(&ppu, &apu, &cartridge, &inputBus, &scheduler);
     ppuBus.connect(&cartridge);
+    scheduler.connect(&cpu, &ppu, &apu, &cartridge);
+    scheduler.setScanlineRendering(true);
     inputBus.init(&ppu);
+    apu.init(masterClockHz, audioSampleRate);
+
+    // Consoles can be allocated anywhere now, so nothing can count on starting out zeroed
+    isRunning = false;
+    singleStepMode = false;
+    wasVBlankActive = false;
+
+    currentCpuCycle = 0;
+    clockDivider = 0;
+
+    cpuMode = CPU_MODE_AUTO;
+    isSteppingInstructions = false;
+    cpuCyclesOwed = 0;
+
+    isSkippingIdleLoops = true;
+    updateEndCpuCycle = 0;
+    idleLoopDeadline = 0;
+    cpuCyclesRun = 0;
+    idleCyclesSkipped = 0;
 
-    traceEnabled = false;
+    audioRing.setSize(defaultAudioBufferSize);
+    lastSample = 0;
+
+    stateHash = 0;
+    stateHashLog = 0;
+
+    nsfSentinal = 0;
+    totalPlayCycles = 0;
+    cyclesToNextPlay = 0;
 }
 
 bool NES::loadRom(const char * path)
@@ -42,6 +80,14 @@ bool NES::loadRom(const char * path)
         cpu.jumpSubroutine(cartridge.initAddress);
     }
 
+    setCPUMode(cpuMode);
+
+    // History from the last rom can't be restored onto this one
+    if (rewind.isEnabled())
+    {
+        rewind.clear(getSaveStateSize());
+    }
+
     return true;
 }
 
@@ -53,14 +99,25 @@ void NES::unloadRom()
 
 void NES::powerOn()
 {
+    // Memory comes up cleared every time, so a console that ran something else starts out the same as a new one
+    cpuBus.powerOn();
+    ppuBus.powerOn();
+
     cpu.start();
-    apu.reset();
-    ppu.reset();
+    apu.powerOn();
+    ppu.powerOn();
     apu.noise.shiftRegister = 1;
+    scheduler.reset();
 
     clockDivider = 0;
     currentCpuCycle = 0;
     isRunning = true;
+    cpuCyclesOwed = 0;
+
+    idleLoops = IdleLoopDetector();
+    idleLoopDeadline = 0;
+    cyclesToNextPlay = 0;
+    stateHash = 0;
 
     // This runs the reset process without the ppu active, doing this to line up with nintendulator
     // TODO: I know it was more "correct" before, but I'm trying to track down a timing issue and diffing logs is all I got...
@@ -81,12 +138,17 @@ void NES::reset()
         return;
     }
 
+    // Resets come from outside the console, so they're part of the input
+    movie.markReset();
+
     cpu.reset();
     apu.reset();
     ppu.reset();
+    scheduler.reset();
     isRunning = true;
     clockDivider = 0;
     currentCpuCycle = 0;
+    cpuCyclesOwed = 0;
 
     // This runs the reset process without the ppu active, doing this to line up with nintendulator
     // TODO: I know it was more "correct" before, but I'm trying to track down a timing issue and diffing logs is all I got...
@@ -100,13 +162,39 @@ void NES::reset()
     }
 }
 
+void NES::runFrom(uint16 address)
+{
+    cpu.pc = address;
+    scheduler.addPPUDots((uint32)currentCpuCycle * 3);
+}
+
 void NES::powerOff()
 {
     cartridge.unload();
     cpu.stop();
     isRunning = false;
 
-    flushLog();
+    trace.flush();
+}
+
+void NES::shutdown()
+{
+    if (isRunning)
+    {
+        powerOff();
+    }
+
+    rewind.shutdown();
+    trace.close();
+
+    for (uint32 i = 0; i < MAX_AUDIO_CAPTURES; ++i)
+    {
+        audioCaptures[i].close();
+    }
+
+    videoCapture.close();
+    movie.close();
+    stopStateHashLog();
 }
 
 void NES::update(real32 secondsPerFrame)
@@ -121,119 +209,341 @@ void NES::update(real32 secondsPerFrame)
         return;
     }
 
-    // Our framerate is 30fps so we just need to call this every other frame
-    if (cartridge.isNSF && cpu.stack == nsfSentinal)
+    // A movie being played decides how long the update runs and what the controllers read, over whatever the host said
+    const MovieFrame* movieFrame = movie.nextFrame();
+    if (movieFrame)
     {
-        cpuStep();
+        if (movieFrame->flags & MOVIE_RESET)
+        {
+            reset();
+        }
+
+        secondsPerFrame = movieFrame->seconds;
+        inputBus.controllers[0].currentState = movieFrame->pads[0];
+        inputBus.controllers[1].currentState = movieFrame->pads[1];
+        inputBus.zapper.setState({ movieFrame->zapperX, movieFrame->zapperY, movieFrame->zapperActiveMs });
+    }
+
+    MovieFrame recordedFrame = {};
+    if (movie.isRecording())
+    {
+        ZapperState zapper = inputBus.zapper.getState();
+        recordedFrame.seconds = secondsPerFrame;
+        recordedFrame.pads[0] = inputBus.controllers[0].currentState;
+        recordedFrame.pads[1] = inputBus.controllers[1].currentState;
+        recordedFrame.zapperX = (int16)zapper.x;
+        recordedFrame.zapperY = (int16)zapper.y;
+        recordedFrame.zapperActiveMs = zapper.activeCounterMs;
     }
 
     uint32 masterCycles = (uint32)(secondsPerFrame * masterClockHz);
-    uint32 cyclesPerSample = (uint32)(masterCycles / (secondsPerFrame * 48000));
-    for (uint32 i = 0; i < masterCycles; ++i)
+
+    // Cpu cycles land on every 12th master clock, starting from wherever the last update left off
+    uint32 firstCpuCycle = clockDivider == 0 ? 0 : 12 - clockDivider;
+    updateEndCpuCycle = currentCpuCycle + (firstCpuCycle < masterCycles ? (masterCycles - firstCpuCycle + 11) / 12 : 0);
+
+    // Rather than walk every master clock, this jumps from one cpu cycle to the next (every 12 master clocks)
+    // The ppu dots in between (every 4) get queued on the scheduler and the nsf timer is advanced in bulk.
+    // Frames don't line up with cpu cycles, so the first and last step may be partial.
+    uint32 elapsed = 0;
+    while (elapsed < masterCycles && isRunning)
     {
         if (clockDivider == 0)
         {
-            // TODO: There may be some conditions to emulate with this and the dmc cross talking? Need to look that up
-            if (cpuBus.isDmaActive)
-            {
-                // First cycle is odd to wait for cpu writes to complete
-                if (cpuBus.dmaCycleCount == 0)
-                {
-                    ++cpuBus.dmaCycleCount;
-                }
-                // Wait an extra frame if on an odd cycle
-                // dma cycle 1 == cpu cycle 0 (even)
-                else if (cpuBus.dmaCycleCount % 2 != currentCpuCycle % 2)
-                {
-                    // TODO: Ticking something in a memory access/mapping layer feels wrong
-                    // The MOSS and apu together are the nes cpu, so maybe better to combine those
-                    // to better map to the device
-                    cpuBus.tickDMA();
-                }
-            }
-            else if (!cartridge.isNSF || cpu.stack != nsfSentinal)
-            {
-                cpuStep();
-            }
-            
-            apu.tick(currentCpuCycle);
-
-            // TODO: Should hijack the cpu for some amount of time. Skipping for now to get initial playback
-            if (apu.dmc.readRequired())
-            {
-                apu.dmc.loadSample(cpuBus.read(apu.dmc.getCurrentAddress()));
-            }
-
-            cartridge.tickCPU();
+            cpuCycle();
+            apu.updateOutput(elapsed);
+        }
 
-            ++currentCpuCycle;
+        uint32 steps = 12 - clockDivider;
+        if (steps > masterCycles - elapsed)
+        {
+            steps = masterCycles - elapsed;
         }
 
         if (cartridge.isNSF)
         {
-            if (cpu.stack == nsfSentinal && cyclesToNextPlay <= 0)
-            {
-                cyclesToNextPlay = totalPlayCycles;
-                cpu.jumpSubroutine(cartridge.playAddress);
-            }
-            else
-            {
-                --cyclesToNextPlay;
-            }
+            tickNSFTimer(steps);
         }
         // NSF is supposed to be designed to not use interrupts
-        else if (clockDivider % 4 == 0)
+        else
         {
-            ppu.tick();
+            // Dots land on every 4th master clock
+            scheduler.addPPUDots(((clockDivider + steps + 3) / 4) - ((clockDivider + 3) / 4));
+        }
 
-            // Gather up all the potenial interrupt sources to assert the right status in the cpu
-            cpu.setIRQ(apu.isFrameInteruptFlagSet
-                || apu.dmc.isInterruptFlagSet
-                || cartridge.isIrqPending());
+        clockDivider += steps;
+        if (clockDivider >= 12)
+        {
+            clockDivider = 0;
+        }
 
-            if (ppu.isNMISuppressed())
-            {
-                cpu.forceClearNMI();
-            }
-            else
-            {
-                cpu.setNMI(ppu.isNMIFlagSet());
-            }
+        elapsed += steps;
+    }
+
+    // The cpu halted and took the cartridge with it
+    if (!isRunning)
+    {
+        return;
+    }
+
+    // Leave the ppu current so the frame can be presented
+    scheduler.syncPPU();
+
+    updateStateHash();
+
+    if (movie.isRecording())
+    {
+        recordedFrame.frameHash = stateHash;
+        movie.record(recordedFrame);
+    }
+    else if (movieFrame)
+    {
+        movie.checkFrame(movieFrame, stateHash);
+    }
+
+    // Only the newest frame is still around by now, on the rare update where two finish the first is missed
+    videoCapture.update(ppu.frontBuffer, ppu.frameCount);
+
+    // Turn the steps the apu recorded this frame into samples and pass them on to the audio device
+    // If nothing is playing them (or it's fallen way behind) the ring fills up and the rest are dropped
+    apu.endFrame(masterCycles);
+    int16 samples[1024];
+    while (apu.samplesAvailable() > 0)
+    {
+        uint32 count = apu.readSamples(samples, 1024);
+        audioRing.write(samples, count);
+
+        for (uint32 i = 0; i < MAX_AUDIO_CAPTURES; ++i)
+        {
+            audioCaptures[i].write(samples, count);
+        }
+    }
+
+    // The device's clock never quite matches ours, so make a few more or less samples next frame
+    // to steer the ring back towards half full, instead of it slowly drifting into an underrun or overflow
+    // A full ring means nothing is playing the audio (ex: headless runs), so there's no device to follow
+    // and captures should get exactly the nominal rate
+    uint32 fillLevel = audioRing.getFillLevel();
+    if (fillLevel < audioRing.getSize())
+    {
+        real64 fill = (real64)fillLevel / audioRing.getSize();
+        apu.output.adjustSampleRate(1.0 + (maxAudioRateAdjustment * (1.0 - (2.0 * fill))));
+    }
+    else
+    {
+        apu.output.adjustSampleRate(1.0);
+    }
+
+    if (rewind.isEnabled() && saveState(rewind.getCaptureBuffer(), rewind.getStateSize()))
+    {
+        rewind.push();
+    }
+}
+
+void NES::cpuCycle()
+{
+    // Make sure any interrupts raised by the ppu are visible before the cpu polls for them
+    scheduler.beforeCpuCycle();
+
+    // TODO: There may be some conditions to emulate with this and the dmc cross talking? Need to look that up
+    if (cpuBus.isDmaActive)
+    {
+        // First cycle is odd to wait for cpu writes to complete
+        if (cpuBus.dmaCycleCount == 0)
+        {
+            ++cpuBus.dmaCycleCount;
+        }
+        // Wait an extra frame if on an odd cycle
+        // dma cycle 1 == cpu cycle 0 (even)
+        else if (cpuBus.dmaCycleCount % 2 != currentCpuCycle % 2)
+        {
+            // TODO: Ticking something in a memory access/mapping layer feels wrong
+            // The MOSS and apu together are the nes cpu, so maybe better to combine those
+            // to better map to the device
+            cpuBus.tickDMA();
+        }
+    }
+    else if (cpuCyclesOwed > 0)
+    {
+        // The instruction already ran, this is the rest of the console catching up to it
+        --cpuCyclesOwed;
+    }
+    // Once play returns to the sentinel nothing new starts until the next call, but the RTS still has to finish
+    else if (!cartridge.isNSF || cpu.stack != nsfSentinal || cpu.isExecuting())
+    {
+        uint32 idleCycles = 0;
+        if (isSkippingIdleLoops && !cartridge.isNSF && !trace.isOpen() && !cpu.isExecuting())
+        {
+            idleCycles = skipIdleLoop();
         }
 
-        // TODO: Over sample the audio and manually downsample to reduce aliasing artifacts
-        // TODO: Find a way to center the audio around 0 so it's not as quiet (High Pass Filter?)
-        // TODO: Add a master volume and per channel volume controls
-        ++audioOutputCounter;
-        if (audioOutputCounter >= cyclesPerSample)
+        if (idleCycles > 0)
         {
-            real32 output = apu.getOutput();
-            apuBuffer[writeHead++] = (int16)(output * 32768);
-            if (writeHead >= 48000)
-            {
-                writeHead = 0;
-            }
+            // This is the first cycle of the pass
+            cpuCyclesOwed = idleCycles - 1;
+            idleCyclesSkipped += idleCycles;
+        }
+        else if (isSteppingInstructions)
+        {
+            cpuInstruction();
+        }
+        else
+        {
+            cpuStep();
+        }
 
-            audioOutputCounter -= cyclesPerSample;
+        // Halting powers off the console, so there's no cartridge left to tick
+        if (!isRunning)
+        {
+            return;
         }
+    }
 
-        ++clockDivider;
-        if (clockDivider >= 12)
+    apu.tick(currentCpuCycle);
+
+    // TODO: Should hijack the cpu for some amount of time. Skipping for now to get initial playback
+    if (apu.dmc.readRequired())
+    {
+        apu.dmc.loadSample(cpuBus.read(apu.dmc.getCurrentAddress()));
+    }
+
+    cartridge.tickCPU();
+
+    // The apu irqs only change on cpu cycles, so these can be updated here instead of waiting on the ppu
+    if (!cartridge.isNSF)
+    {
+        cpu.setIRQ(apu.isFrameInteruptFlagSet
+            || apu.dmc.isInterruptFlagSet
+            || cartridge.isIrqPending());
+    }
+
+    ++currentCpuCycle;
+    ++cpuCyclesRun;
+}
+
+// Counts down to the next call to the nsf play routine, one tick per master clock
+void NES::tickNSFTimer(uint32 masterCycles)
+{
+    while (masterCycles > 0)
+    {
+        if (cpu.stack == nsfSentinal && cyclesToNextPlay <= 0 && !cpu.isExecuting())
         {
-            clockDivider = 0;
+            cyclesToNextPlay = totalPlayCycles;
+            cpu.jumpSubroutine(cartridge.playAddress);
+            --masterCycles;
+        }
+        else if (cpu.stack != nsfSentinal)
+        {
+            // Stack can only change when the cpu runs, so the rest of this step is just counting
+            cyclesToNextPlay -= masterCycles;
+            masterCycles = 0;
         }
+        else
+        {
+            uint32 count = masterCycles;
+            if ((uint32)cyclesToNextPlay < count)
+            {
+                count = cyclesToNextPlay;
+            }
+
+            cyclesToNextPlay -= count;
+            masterCycles -= count;
+        }
+    }
+}
+
+void NES::setCPUMode(CPUMode mode)
+{
+    cpuMode = mode;
+    isSteppingInstructions = mode == CPU_MODE_INSTRUCTIONS || (mode == CPU_MODE_AUTO && cartridge.isNSF);
+}
+
+uint32 NES::skipIdleLoop()
+{
+    uint32 passCycles = idleLoops.check(&cpu, &cpuBus);
+    if (passCycles == 0)
+    {
+        return 0;
+    }
+
+    // The nmi (and the vblank flag), plus anything else in PPUSTATUS if that's what it's reading, can't change from
+    // when the last pass read them until the end of this one. The ppu is running behind by the dots it's owed
+    uint32 dotsFree = idleLoops.isPollingPPUStatus() ? ppu.dotsUntilStatusChange() : ppu.dotsUntilVBlank();
+    uint32 dotsOwed = scheduler.getPPUDotsOwed();
+    uint64 lastDeadline = idleLoopDeadline;
+    idleLoopDeadline = currentCpuCycle + (dotsFree > dotsOwed ? (dotsFree - dotsOwed) / 3 : 0);
+
+    if (!idleLoops.isSettled())
+    {
+        return 0;
+    }
+
+    // Leaves another pass to spare
+    if ((int32)(lastDeadline - currentCpuCycle) <= (int32)(passCycles * 2))
+    {
+        return 0;
+    }
+
+    // An interrupt would end the loop, whether it's already waiting or could be raised partway through the pass.
+    // Nothing keeps track of when the next irq is due, so if they're enabled any source that could raise one rules it out
+    bool canRaiseIrq = cartridge.hasPPUClockedIrq() || apu.dmc.isIrqEnabled() || (!apu.isInterruptInhibited && !apu.isFiveStepMode);
+    if (cpu.isInterruptPending() || cpu.isInterruptRequested() || (canRaiseIrq && !cpu.isFlagSet(STATUS_INT_DISABLE)))
+    {
+        return 0;
+    }
+
+    // The state at the end of the update gets hashed, so the pass has to finish before then like it would have
+    if ((uint32)(updateEndCpuCycle - currentCpuCycle) < passCycles)
+    {
+        return 0;
+    }
+
+    return passCycles;
+}
+
+void NES::traceInstruction()
+{
+    // Trace includes the ppu position. Catching the ppu up for every instruction would break up its scanline batches,
+    // so this works out where the owed dots will leave it instead
+    uint32 scanline = 0;
+    uint32 dot = 0;
+    ppu.getPositionAfter(scheduler.getPPUDotsOwed(), &scanline, &dot);
+
+    trace.logInstruction(cpu.pc, &cpu, &cpuBus, scanline, dot, currentCpuCycle);
+}
+
+void NES::cpuInstruction()
+{
+    if (isRunning && trace.isOpen() && !cpu.hasHalted() && !cpu.isExecuting())
+    {
+        traceInstruction();
+    }
+
+    // This is the instruction's first cycle
+    uint32 cycles = cpu.step();
+    if (cycles > 1)
+    {
+        cpuCyclesOwed = cycles - 1;
+    }
+
+    if (cpu.hasHalted())
+    {
+        scheduler.syncPPU();
+        powerOff();
     }
 }
 
 void NES::cpuStep()
 {
-    if (isRunning && traceEnabled && !cpu.hasHalted() && !cpu.isExecuting())
+    if (isRunning && trace.isOpen() && !cpu.hasHalted() && !cpu.isExecuting())
     {
-        logInstruction("data/6502.log", cpu.pc, &cpu, &cpuBus, &ppu, currentCpuCycle);
+        traceInstruction();
     }
 
     if (cpu.tick() && cpu.hasHalted())
     {
+        // Let the ppu finish its time slice before the cartridge goes away
+        scheduler.syncPPU();
         powerOff();
     }
 }
@@ -250,49 +560,336 @@ void NES::singleStep()
 
 void NES::outputAudio(int16* outputBuffer, int length)
 {
-    // TODO: Consider a fade in/out so the system startup doesn't cause a click
-    // (May not be needed once we center the audio with filters)
+    // TODO: Consider a fade out so powering off doesn't cause a click
+    // (The high pass filters already ease the startup in from 0)
 
-    if (isRunning) 
+    if (!isRunning)
     {
-        uint32 bytesAvailable = writeHead - playHead;
-        if (playHead > writeHead)
-        {
-            bytesAvailable = writeHead + (48000 - playHead);
-        }
+        memset(outputBuffer, 0, length * sizeof(int16));
+        return;
+    }
 
-        if (bytesAvailable > length * sizeof(int16))
-        {
-            int32 i = 0;
-            while (i < length)
-            {
-                lastSample = apuBuffer[playHead++];
-                playHead %= 48000;
-                outputBuffer[i] = lastSample;
-                outputBuffer[i + 1] = lastSample;
-                i += 2;
-            }
-        }
-        else
+    // The samples are mono, so read them into the front half then spread them out to both channels
+    // starting from the back, so none get overwritten before they're copied
+    // Anything the ring couldn't fill holds the last sample rather than dropping to 0 and popping
+    int32 frames = length / 2;
+    int32 count = (int32)audioRing.read(outputBuffer, frames);
+    if (count > 0)
+    {
+        lastSample = outputBuffer[count - 1];
+    }
+
+    for (int32 i = frames - 1; i >= 0; --i)
+    {
+        int16 sample = i < count ? outputBuffer[i] : lastSample;
+        outputBuffer[i * 2] = sample;
+        outputBuffer[(i * 2) + 1] = sample;
+    }
+}
+
+void NES::setAudioBufferSize(uint32 samples)
+{
+    audioRing.setSize(samples);
+}
+
+int32 NES::startAudioCapture(const char* path, AudioCaptureFormat format)
+{
+    for (uint32 i = 0; i < MAX_AUDIO_CAPTURES; ++i)
+    {
+        if (!audioCaptures[i].isOpen())
         {
-            int32 i = 0;
-            while (i < length)
-            {
-                outputBuffer[i] = lastSample;
-                outputBuffer[i + 1] = lastSample;
-                i += 2;
-            }
+            return audioCaptures[i].open(path, format, audioSampleRate) ? i : -1;
         }
     }
-    else
+
+    logError("Can't start capturing %s, all %u audio captures are in use\n", path, MAX_AUDIO_CAPTURES);
+    return -1;
+}
+
+void NES::stopAudioCapture(int32 id)
+{
+    if (id >= 0 && id < (int32)MAX_AUDIO_CAPTURES)
     {
-        memset(outputBuffer, 0, length * sizeof(int16));
+        audioCaptures[id].close();
     }
 }
 
-void NES::processInput(InputState* input)
+bool NES::startVideoCapture(const char* path)
+{
+    return videoCapture.open(path);
+}
+
+void NES::stopVideoCapture()
+{
+    videoCapture.close();
+}
+
+bool NES::startTrace(const char* path)
+{
+    return trace.open(path);
+}
+
+void NES::stopTrace()
+{
+    trace.close();
+}
+
+bool NES::startMovieRecording(const char* path)
+{
+    if (!isRunning)
+    {
+        logError("Load a rom before recording a movie\n");
+        return false;
+    }
+
+    InputMovieHeader header = {};
+    header.romHash = cartridge.getRomHash();
+    header.stateSize = getSaveStateSize();
+    for (int i = 0; i < 2; ++i)
+    {
+        header.portDevices[i] = (uint8)inputBus.ports[i].device;
+        header.portIndices[i] = inputBus.ports[i].index;
+    }
+
+    uint8* state = new uint8[header.stateSize];
+    bool isStarted = saveState(state, header.stateSize) && movie.startRecording(path, header, state);
+    delete[] state;
+
+    return isStarted;
+}
+
+bool NES::startMoviePlayback(const char* path)
+{
+    if (!isRunning)
+    {
+        logError("Load the movie's rom before playing it\n");
+        return false;
+    }
+
+    if (!movie.startPlayback(path))
+    {
+        return false;
+    }
+
+    const InputMovieHeader& header = movie.getHeader();
+    if (header.romHash != cartridge.getRomHash())
+    {
+        logError("%s was recorded with a different rom\n", path);
+        movie.close();
+        return false;
+    }
+
+    if (!loadState(movie.getStartState(), header.stateSize))
+    {
+        movie.close();
+        return false;
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+        inputBus.ports[i].device = (NESDeviceType)header.portDevices[i];
+        inputBus.ports[i].index = header.portIndices[i];
+    }
+
+    return true;
+}
+
+uint32 NES::stopMovie()
+{
+    return movie.close();
+}
+
+const uint32 STATE_HASH_LOG_MAGIC = fourCC('R', 'M', 'S', 'H');
+const uint32 STATE_HASH_LOG_VERSION = 1;
+
+bool NES::startStateHashLog(const char* path)
+{
+    stopStateHashLog();
+
+    stateHashLog = fopen(path, "wb");
+    if (!stateHashLog)
+    {
+        logError("Failed to open %s for writing: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    uint32 header[] = { STATE_HASH_LOG_MAGIC, STATE_HASH_LOG_VERSION };
+    fwrite(header, sizeof(header), 1, stateHashLog);
+    return true;
+}
+
+void NES::stopStateHashLog()
+{
+    if (stateHashLog)
+    {
+        fclose(stateHashLog);
+        stateHashLog = 0;
+    }
+}
+
+void NES::updateStateHash()
+{
+    StateHash hash;
+    hash.begin();
+
+    hash.value(cpu.pc);
+    hash.value(cpu.stack);
+    hash.value(cpu.status);
+    hash.value(cpu.accumulator);
+    hash.value(cpu.x);
+    hash.value(cpu.y);
+
+    cpuBus.hashState(&hash);
+    ppuBus.hashState(&hash);
+    ppu.hashState(&hash);
+
+    stateHash = hash.get();
+
+    if (stateHashLog)
+    {
+        fwrite(&stateHash, sizeof(stateHash), 1, stateHashLog);
+    }
+}
+
+// Bump the version any time something is added, removed or reordered in serialize
+const uint32 SAVE_STATE_MAGIC = fourCC('R', 'M', 'S', 'S');
+const uint32 SAVE_STATE_VERSION = 4;
+
+uint32 NES::getSaveStateSize()
+{
+    SaveState state;
+    state.beginWrite(0, 0);
+    serialize(&state);
+    return state.getSize();
+}
+
+uint32 NES::saveState(uint8* buffer, uint32 size)
 {
     if (!isRunning)
+    {
+        return 0;
+    }
+
+    // Owed dots would be fine to save, but catching up first makes the snapshot line up with what's on screen
+    scheduler.syncPPU();
+
+    SaveState state;
+    state.beginWrite(buffer, size);
+    serialize(&state);
+
+    if (state.hasFailed())
+    {
+        logError("Save state needs %u bytes, buffer only has %u\n", getSaveStateSize(), size);
+        return 0;
+    }
+
+    return state.getSize();
+}
+
+bool NES::loadState(const uint8* buffer, uint32 size)
+{
+    if (!isRunning)
+    {
+        return false;
+    }
+
+    // The layout is fixed, so anything that isn't exactly the right size is from a different build or rom
+    if (size != getSaveStateSize())
+    {
+        logError("Save state is %u bytes, expected %u\n", size, getSaveStateSize());
+        return false;
+    }
+
+    // Checked all the way through before anything is restored, so a bad state leaves the console as it was
+    SaveState state;
+    state.beginValidate(buffer, size);
+    if (!serialize(&state))
+    {
+        logError("Save state was made with a different rom or version\n");
+        return false;
+    }
+
+    if (state.hasFailed())
+    {
+        logError("Save state is corrupt\n");
+        return false;
+    }
+
+    state.beginRead(buffer, size);
+    serialize(&state);
+    return true;
+}
+
+bool NES::enableRewind(uint32 seconds, uint32 memoryBudget)
+{
+    // Keyframe once a second, anything in between is a delta against it
+    const uint32 framesPerSecond = 60;
+    if (!rewind.init(memoryBudget, (seconds * framesPerSecond) + 1, framesPerSecond))
+    {
+        return false;
+    }
+
+    rewind.clear(isRunning ? getSaveStateSize() : 0);
+    return true;
+}
+
+void NES::disableRewind()
+{
+    rewind.shutdown();
+}
+
+bool NES::rewindFrame()
+{
+    if (!isRunning || !rewind.isEnabled())
+    {
+        return false;
+    }
+
+    const uint8* state = rewind.stepBack();
+    if (!state)
+    {
+        return false;
+    }
+
+    return loadState(state, rewind.getStateSize());
+}
+
+bool NES::serialize(SaveState* state)
+{
+    state->match(SAVE_STATE_MAGIC);
+    state->match(SAVE_STATE_VERSION);
+    state->match(cartridge.getRomHash());
+
+    // The size was already checked, so a failure this early is the header
+    if (state->hasFailed())
+    {
+        return false;
+    }
+
+    cpu.serialize(state);
+    ppu.serialize(state);
+    apu.serialize(state);
+    cpuBus.serialize(state);
+    ppuBus.serialize(state);
+    cartridge.serialize(state);
+    inputBus.serialize(state);
+    scheduler.serialize(state);
+
+    state->value(currentCpuCycle);
+    state->value(clockDivider);
+    state->value(cpuCyclesOwed);
+
+    state->value(nsfSentinal);
+    state->value(totalPlayCycles);
+    state->value(cyclesToNextPlay);
+
+    return true;
+}
+
+void NES::processInput(InputState* input)
+{
+    // Movies bring their own input
+    if (!isRunning || movie.isPlaying())
     {
         return;
     }
@@ -360,16 +957,11 @@ void NES::renderPatternTable(ScreenBuffer buffer, uint32 top, uint32 left, uint8
             {
                 for (int tileY = 0; tileY < 8; ++tileY)
                 {
-                    uint8 patfield01 = ppuBus.read(patternAddress);
-                    uint8 patfield02 = ppuBus.read(patternAddress + 8);
+                    const uint8* tileRow = cartridge.getTileRow(patternAddress);
 
                     for (int bit = 0; bit < 8; ++bit)
                     {
-                        uint8 paletteOffset = (patfield01 & 0b10000000) >> 7;
-                        paletteOffset |= (patfield02 & 0b10000000) >> 6;
-                        patfield01 <<= 1;
-                        patfield02 <<= 1;
-                        uint8 color = ppuBus.read(paletteRamBase + paletteOffset);
+                        uint8 color = ppuBus.read(paletteRamBase + tileRow[bit]);
                         drawPalettePixel(buffer, x++, y, color);
                     }
 
@@ -453,17 +1045,13 @@ void NES::renderNametable(ScreenBuffer buffer, uint32 top, uint32 left)
 
                 for (int tileY = 0; tileY < 8; ++tileY)
                 {
-                    uint8 patfield01 = ppuBus.read(patternAddress);
-                    uint8 patfield02 = ppuBus.read(patternAddress + 8);
+                    const uint8* tileRow = cartridge.getTileRow(patternAddress);
                     uint8* row = (uint8*)buffer.memory + (buffer.pitch * y);
                     uint32* pixel = (uint32*)row + x;
 
                     for (int bit = 0; bit < 8; ++bit)
                     {
-                        uint8 paletteOffset = (patfield01 & 0b10000000) >> 7;
-                        paletteOffset |= (patfield02 & 0b10000000) >> 6;
-                        patfield01 <<= 1;
-                        patfield02 <<= 1;
+                        uint8 paletteOffset = tileRow[bit];
 
                         if (paletteOffset == 0)
                         {
@@ -529,24 +1117,13 @@ void NES::renderNametable(ScreenBuffer buffer, uint32 top, uint32 left)
 
 void NES::render(ScreenBuffer buffer)
 {
-    uint8* nesBuffer = ppu.frontBuffer;
-    uint8* row = (uint8*)buffer.memory;
-
     if (!cpu.hasHalted())
     {
-        for (int y = 0; y < NES_SCREEN_HEIGHT; ++y)
-        {
-            uint32* pixel = (uint32*)row;
-            for (int x = 0; x < NES_SCREEN_WIDTH; ++x)
-            {
-                *pixel++ = palette[*nesBuffer++];
-            }
-
-            row += buffer.pitch;
-        }
+        convertFrame(ppu.frontBuffer, buffer.memory, buffer.pitch);
     }
     else
     {
+        uint8* row = (uint8*)buffer.memory;
         for (int y = 0; y < NES_SCREEN_HEIGHT; ++y)
         {
             uint32* pixel = (uint32*)row;
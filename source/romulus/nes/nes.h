@@ -2,19 +2,38 @@
 #include "6502.h"
 #include "ppu/ppu.h"
 #include "apu/apu.h"
+#include "apu/audioRing.h"
+#include "audioCapture.h"
+#include "videoCapture.h"
+#include "input/inputMovie.h"
 #include "cpuBus.h"
 #include "ppuBus.h"
+#include "scheduler.h"
+#include "rewind.h"
+#include "cpuTrace.h"
+#include "idleLoop.h"
+
+// How the console runs the cpu, see NES::setCPUMode
+enum CPUMode
+{
+    // Instructions for nsfs (no ppu and nothing watching the timing), cycles for everything else
+    CPU_MODE_AUTO,
+    CPU_MODE_CYCLES,
+    CPU_MODE_INSTRUCTIONS
+};
 
 class NES
 {
 public: // making public for now, will wrap this as needed later
-    MOS6502 cpu = {};
-    PPU ppu = {};
+    MOS6502<CPUBus> cpu = {};
+    PPU<PPUBus> ppu = {};
     PPUBus ppuBus = {};
     APU apu = {};
     CPUBus cpuBus = {};
     Cartridge cartridge = {};
     InputBus inputBus = {};
+    Scheduler scheduler = {};
+    RewindBuffer rewind = {};
     bool isRunning;
 
     NES();
@@ -23,35 +42,155 @@ public: // making public for now, will wrap this as needed later
     void reset();
     void powerOff();
 
+    // Releases everything the console allocated (rom, rewind history, trace file, captures). Needed before throwing it away
+    void shutdown();
+
     bool loadRom(const char* path);
     void unloadRom();
 
+    // Right after power on or reset, starts running from address instead of the reset vector (ex: $C000 for nestest's
+    // automated mode). The reset sequence runs with the ppu stopped, this catches it up over those cycles too,
+    // the way nestest.log was made
+    void runFrom(uint16 address);
+
     void update(real32 secondsPerFrame);
     void singleStep();
 
     void toggleSingleStep() { singleStepMode = !singleStepMode; }
+
+    // Cycles runs the cpu a cycle at a time alongside everything else. Instructions runs each one whole on its first
+    // cycle (see MOS6502::step) and has the rest of the console catch up over the cycles it took, which is quicker
+    // but moves its reads and writes up to a few cycles early. Takes effect from the next instruction
+    void setCPUMode(CPUMode mode);
+
+    // Lets passes of the loops games wait for the next frame in go by without running the cpu (see IdleLoopDetector),
+    // only when nothing could happen during them that the loop would notice, so the results are the same. On by default
+    void setIdleLoopSkipping(bool enable) { isSkippingIdleLoops = enable; }
+
+    // Cpu cycles run since the console was created, and how many of those went by in skipped idle loops
+    uint64 getCpuCyclesRun() { return cpuCyclesRun; }
+    uint64 getIdleCyclesSkipped() { return idleCyclesSkipped; }
+
     void processInput(InputState* input);
     void render(ScreenBuffer buffer);
+    // Fills an interleaved stereo buffer, length is the number of int16s
     void outputAudio(int16* outputBuffer, int length);
 
+    // How many samples can be waiting on the audio device. The console aims to keep it half full, so this sets the latency
+    // Only call while nothing is outputting audio
+    void setAudioBufferSize(uint32 samples);
+
+    // Writes everything the apu outputs to a file until stopped, on a background thread so it doesn't slow down emulation
+    // Returns an id for stopping it, or -1 if every capture is in use or the file couldn't be opened
+    int32 startAudioCapture(const char* path, AudioCaptureFormat format);
+    void stopAudioCapture(int32 id);
+
+    // Writes every finished frame's palette indices to a file (compressed, on a background thread) until stopped
+    bool startVideoCapture(const char* path);
+    void stopVideoCapture();
+
+    // Writes a record of every instruction the cpu runs to a file (see CPUTrace) until stopped.
+    // Idle loops run in full while it's on, so nothing goes by without a record
+    bool startTrace(const char* path);
+    void stopTrace();
+
+    // Records everything fed to the console from here on (update lengths, controller and zapper state, resets)
+    // along with a hash of every frame, starting from a save state of where it is now
+    bool startMovieRecording(const char* path);
+
+    // Puts the console back where the recording started and replays it over the next updates, ignoring live input.
+    // Any frame that doesn't hash the same as it did when recorded is reported as a desync
+    bool startMoviePlayback(const char* path);
+
+    // Returns the number of frames recorded or played
+    uint32 stopMovie();
+
+    bool isMoviePlaying() { return movie.isPlaying(); }
+    uint32 getMovieLength() { return movie.getHeader().frameCount; }
+
+    // The first frame of the last playback that didn't match the recording, or -1
+    int32 getMovieDesyncFrame() { return movie.getDesyncFrame(); }
+
+    // Hash of the cpu registers, ram, vram, palettes, oam and finished frame as of the end of the last update.
+    // Two runs that agree on every frame's hash haven't diverged (as far as anything a game could see)
+    uint64 getStateHash() { return stateHash; }
+
+    // Writes every update's state hash to a file, 8 bytes each after a small header, so two runs
+    // can be compared with cmp (the first differing byte gives away the frame)
+    bool startStateHashLog(const char* path);
+    void stopStateHashLog();
+
+    // Save states are a fixed size for a given rom, so the buffer can be allocated once up front
+    uint32 getSaveStateSize();
+
+    // Writes a snapshot of the running console into the buffer. Returns the bytes written, or 0 on failure
+    uint32 saveState(uint8* buffer, uint32 size);
+
+    // Restores a snapshot taken from the same rom with the same version of the emulator
+    bool loadState(const uint8* buffer, uint32 size);
+
+    // Starts recording a snapshot every frame, keeping up to the given number of seconds within the memory budget
+    bool enableRewind(uint32 seconds, uint32 memoryBudget);
+    void disableRewind();
+
+    // Restores the frame before the current one, returns false once the history runs out
+    bool rewindFrame();
+
     // Debug views
     void renderNametable(ScreenBuffer buffer, uint32 top, uint32 left);
     void renderPatternTable(ScreenBuffer buffer, uint32 top, uint32 left, uint8 selectedPalette);
 
 private:
     bool wasVBlankActive;
-    bool traceEnabled;
+    CPUTrace trace = {};
     bool singleStepMode;
 
     void cpuStep();
+    void cpuInstruction();
+    void traceInstruction();
+    void cpuCycle();
+
+    CPUMode cpuMode;
+    bool isSteppingInstructions;
+
+    // Cycles left on the instruction that was just stepped (or idle loop pass skipped), the cpu sits out until they've passed
+    uint32 cpuCyclesOwed;
+
+    IdleLoopDetector idleLoops;
+    bool isSkippingIdleLoops;
 
-    uint32 currentCpuCycle;
+    // The cpu cycle the current update stops at, skipped passes can't run past it
+    uint64 updateEndCpuCycle;
+
+    // The first cpu cycle the ppu could change something the idle loop reads, as of the last time the cpu came around it
+    uint64 idleLoopDeadline;
+
+    uint64 cpuCyclesRun;
+    uint64 idleCyclesSkipped;
+
+    uint32 skipIdleLoop();
+    void tickNSFTimer(uint32 masterCycles);
+
+    // Lists everything that goes into a save state, in order. Returns false if the header doesn't match
+    bool serialize(SaveState* state);
+
+    uint64 currentCpuCycle;
     uint8 clockDivider;
 
-    int16 apuBuffer[48000];
-    uint32 writeHead;
-    uint32 playHead;
-    uint32 audioOutputCounter;
+    // Samples waiting on the audio device, outputAudio can be called from another thread
+    AudioRing audioRing;
+
+    // Any number of these can be running at once (ex: a wav to listen to and raw samples to diff)
+    static const uint32 MAX_AUDIO_CAPTURES = 4;
+    AudioCapture audioCaptures[MAX_AUDIO_CAPTURES];
+
+    VideoCapture videoCapture;
+
+    InputMovie movie;
+
+    uint64 stateHash;
+    FILE* stateHashLog;
+    void updateStateHash();
 
     int16 lastSample;
 
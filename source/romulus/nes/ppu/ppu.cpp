@@ -1,4 +1,7 @@
 #include "ppu.h"
+#include "../ppuBus.h"
+#include <string.h>
+#include <type_traits>
 
 const uint32 PRERENDER_LINE = 261;
 const uint32 CYCLES_PER_SCANLINE = 340;
@@ -10,12 +13,22 @@ const uint16 COARSE_Y_MASK =  0x03E0; // ......YY YYY.....
 const uint16 NAMETABLE_MASK = 0x0C00; // ....NN.. ........
 const uint16 FINE_Y_MASK =    0x7000; // .yyy.... ........
 
-PPU::PPU()
+template <class Bus>
+void PPU<Bus>::powerOn()
 {
+    // Everything goes back to zero like a value initialized ppu, so one that's been running comes up the same as a new one.
+    // Only the bus it's connected to is kept
+    static_assert(std::is_trivially_copyable<PPU<Bus>>::value, "PPU has to stay plain data to be cleared like this");
+
+    Bus* connected = bus;
+    memset(this, 0, sizeof(*this));
+    bus = connected;
+
     reset();
 }
 
-void PPU::reset()
+template <class Bus>
+void PPU<Bus>::reset()
 {
     for (int i = 0; i < NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT; ++i)
     {
@@ -52,7 +65,8 @@ void PPU::reset()
 // https://www.nesdev.org/wiki/PPU_scrolling#At_dot_256_of_each_scanline
 // https://www.nesdev.org/wiki/PPU_rendering#Line-by-line_timing
 // https://www.nesdev.org/wiki/File:Ppu.svg
-void PPU::tick()
+template <class Bus>
+void PPU<Bus>::tick()
 {
     // Cycle 0 is an idle cycle always
     if (cycle == 0)
@@ -73,6 +87,7 @@ void PPU::tick()
             uint8* temp = frontBuffer;
             frontBuffer = backbuffer;
             backbuffer = temp;
+            ++frameCount;
         }
         else if (scanline == PRERENDER_LINE)
         {
@@ -119,37 +134,7 @@ void PPU::tick()
         {
             uint8 backgroundPixel = calculateBackgroundPixel();
             uint8 spritePixel = calculateSpritePixel();
-
-            bool backgroundVisible = backgroundPixel & 0x03;
-            bool spriteVisible = spritePixel & 0x03;
-
-            uint8 pixel = 0;
-            if (backgroundVisible && spriteVisible)
-            {
-                if (spriteRenderers[renderedSpriteIndex].oamIndex == 0
-                    && spriteRenderers[renderedSpriteIndex].getX() != 0xFF
-                    && cycle != NES_SCREEN_WIDTH)
-                {
-                    isSpriteZeroHit = true;
-                }
-
-                if (spriteRenderers[renderedSpriteIndex].getPriority())
-                {
-                    pixel = backgroundPixel;
-                }
-                else
-                {
-                    pixel = spritePixel;
-                }
-            }
-            else if (spriteVisible)
-            {
-                pixel = spritePixel;
-            }
-            else if (backgroundVisible)
-            {
-                pixel = backgroundPixel;
-            }
+            uint8 pixel = mixPixels(backgroundPixel, spritePixel);
 
             backbuffer[outputOffset++] = bus->read(0x3F00 + pixel);
         }
@@ -167,101 +152,13 @@ void PPU::tick()
     // would have been priming the pipeline in some way, who knows.
     if (cycle <= 336)
     {
-        patternLoShift <<= 1;
-        patternHiShift <<= 1;
-        attributeLoShift <<= 1;
-        attributeHiShift <<= 1;
-        attributeLoShift |= attributeBit0;
-        attributeHiShift |= attributeBit1;
+        shiftBackground();
     }
 
     // Sprite Evaluation https://www.nesdev.org/wiki/PPU_sprite_evaluation
     if (cycle <= NES_SCREEN_WIDTH && cycle % 2 == 0)
     {
-        // Clearing Phase;
-        if (cycle == 64)
-        {
-            for (int i = 0; i < 32; ++i)
-            {
-                oamSecondary[i] = 0xFF;
-            }
-
-            secondaryOamAddress = 0;
-            isSecondaryOAMWriteDisabled = false;
-            numSpritesChecked = 0;
-            numSpritesFound = 0;
-        }
-        else if (isRenderingEnabled && cycle > 64)
-        {
-            uint8 oamValue = oam[oamAddress];
-            if (isCopyingSprite)
-            {
-                oamSecondary[secondaryOamAddress++] = oamValue;
-                ++oamAddress;
-                isCopyingSprite = secondaryOamAddress % 4 > 0;
-
-                if (secondaryOamAddress >= 32)
-                {
-                    isSecondaryOAMWriteDisabled = true;
-                    secondaryOamAddress = 0;
-                }
-            }
-            else if (numSpritesChecked < 64)
-            {
-                // We haven't hit 8 sprites yet so check if there's one on this scanline
-                if (!isSecondaryOAMWriteDisabled)
-                {
-                    // We always write this for some reason, seems to be somewhat of a sentinal value
-                    oamSecondary[secondaryOamAddress] = oamValue;
-
-                    uint32 spriteTop = oamValue;
-                    uint32 spriteBottom = spriteTop + spriteHeight;
-
-                    if (spriteTop < NES_SCREEN_HEIGHT && scanline >= spriteTop && scanline < spriteBottom)
-                    {
-                        selectedSpriteIndices[numSpritesFound] = numSpritesChecked;
-
-                        ++secondaryOamAddress;
-                        ++oamAddress;
-                        isCopyingSprite = true;
-                        ++numSpritesFound;
-                    }
-                    else
-                    {
-                        oamAddress += 4;
-                    }
-                }
-                // Continue checking for sprite overflow
-                // There's a known bug where the address increments incorrectly once the write inhibit flag has been set
-                // https://www.nesdev.org/wiki/PPU_sprite_evaluation#Sprite_overflow_bug
-                // This was poorly worded and hard to follow, so I'll try to clarify
-                // The stuff about n and m imply there are separate values that index directly into oam but
-                // they're actually just portions of the oam address. m is not incremented with n if the y isn't in range
-                // thats only true once you've hit the write inhibit flag after 8 sprites copied over
-                // Treating it as separate values would mean that writing to OAMADDR after its been cleared wouldn't have negative consequences
-                // I could be wrong about this, it's hard to tell when it should come up..
-                else
-                {
-                    // "n" in this case gets incremented every time due to the bug
-                    oamAddress += 4;
-
-                    uint32 spriteTop = oamValue;
-                    uint32 spriteBottom = spriteTop + spriteHeight;
-                    if (spriteTop < NES_SCREEN_HEIGHT && scanline >= spriteTop && scanline < spriteBottom)
-                    {
-                        isSpriteOverflowFlagSet = true;
-                    }
-                    else
-                    {
-                        // m gets incremented without the carry bit resulting in the "diagonal" fetch pattern for the y
-                        uint8 m = (oamAddress & 0x03) + 1;
-                        oamAddress = (oamAddress & 0xFC) | (m & 0x03);
-                    }
-                }
-
-                ++numSpritesChecked;
-            }
-        }
+        evaluateSprites();
     }
     else if (cycle == 257)
     {
@@ -327,25 +224,14 @@ void PPU::tick()
             case 2: // Name Table https://www.nesdev.org/wiki/PPU_nametables
             {
                 // TODO: Potentially repeat on the sprite Attribute stage for mapper timing stuff
-                uint16 nameTableAddress = 0x2000 | (vramAddress & 0x0FFF);
-                nameTableLatch = bus->read(nameTableAddress);
+                fetchNameTable();
                 break;
             }
             case 4: // Attribute table https://www.nesdev.org/wiki/PPU_attribute_tables
             {
                 if (!isSpritePhase)
                 {
-                    // From the Wiki this is the address we want
-                    // NN 1111 YYY XXX
-                    // || |||| ||| +++--- high 3 bits of coarse X(x / 4)
-                    // || |||| +++------- high 3 bits of coarse Y(y / 4)
-                    // || ++++----------- attribute offset(960 bytes)
-                    // ++---------------- nametable select
-                    uint16 coarseX = (vramAddress & COARSE_X_MASK) >> 2;
-                    uint16 coarseY = (vramAddress & 0x0380) >> 4;
-                    uint16 nameTableSelect = vramAddress & 0x0C00;
-                    uint16 attributeAddress = 0x23C0 | nameTableSelect | coarseY | coarseX;
-                    attributeLatch = bus->read(attributeAddress);
+                    fetchAttribute();
                 }
             }
             break;
@@ -358,19 +244,7 @@ void PPU::tick()
                 }
                 else
                 {
-                    // Pattern table address Scheme
-                    // 0H RRRR CCCC PTTT
-                    // || |||| |||| |+++--- T : Fine Y offset, the row number within a tile
-                    // || |||| |||| +------ P : Bit plane (0: "lower"; 1: "upper")
-                    // || |||| ++++-------- C : Tile column
-                    // || ++++------------- R : Tile row
-                    // |+------------------ H : Half of pattern table (0: "left"; 1: "right")
-                    // +------------------- 0 : Pattern table is at $0000 - $1FFF
-                    uint16 fineY = (vramAddress & FINE_Y_MASK) >> 12;
-                    uint16 tileOffset = ((uint16)nameTableLatch) << 4;
-                    uint16 bitPlane = 0;
-                    uint16 patternTableAddress = fineY | bitPlane | tileOffset | backgroundPatternBaseAddress;
-                    patternLoLatch = bus->read(patternTableAddress);
+                    fetchPatternLo();
                 }
             }
             break;
@@ -384,60 +258,9 @@ void PPU::tick()
                 }
                 else
                 {
-                    uint16 fineY = (vramAddress & FINE_Y_MASK) >> 12;
-                    uint16 tileOffset = ((uint16)nameTableLatch) << 4;
-                    uint16 bitPlane = BIT_3;
-                    uint16 patternTableAddress = fineY | bitPlane | tileOffset | backgroundPatternBaseAddress;
-                    patternHiLatch = bus->read(patternTableAddress);
-
-                    // Fill the shift registers
-                    // TODO: This may need to occur separately/in the pixel render so it can be started at
-                    // a certain cycle offset, for sprite overwrite or something (Shift registers require a
-                    // clock, where the reads would be available immediately, so assuming after the render for now)
-
-                    // TODO: Yeah the more I fill out the attribute stuff the more realize this is wasting a lot of cycles
-                    // and making it more complicated will definitely refactor
-
-                    // In theory the bottom 8 bits are already clear from the shift operations, so OR is fine
-                    patternLoShift |= patternLoLatch;
-                    patternHiShift |= patternHiLatch;
-
-                    // attribute table covers a 4 x 4 tile area so bit 0 doesn't matter
-                    // and the next 3 bits after this got us this attribute in the first place
-                    bool isRightAttribute = vramAddress & BIT_1;
-                    bool isBottomAttribute = vramAddress & BIT_6;
-                    if (isRightAttribute)
-                    {
-                        if (isBottomAttribute)
-                        {
-                            // Bottom Right
-                            attributeBit0 = (attributeLatch >> 6) & BIT_0;
-                            attributeBit1 = attributeLatch >> 7;
-                        }
-                        else
-                        {
-                            // Top Right
-                            attributeBit0 = (attributeLatch >> 2) & BIT_0;
-                            attributeBit1 = (attributeLatch >> 3) & BIT_0;
-                        }
-                    }
-                    else
-                    {
-                        if (isBottomAttribute)
-                        {
-                            // Bottom Left
-                            attributeBit0 = (attributeLatch >> 4) & BIT_0;
-                            attributeBit1 = (attributeLatch >> 5) & BIT_0;
-                        }
-                        else
-                        {
-                            // Top Left
-                            attributeBit0 = attributeLatch & BIT_0;
-                            attributeBit1 = (attributeLatch >> 1) & BIT_0;
-                        }
-                    }
+                    fetchPatternHi();
+                    loadShiftRegisters();
                 }
-
             }
             break;
         }
@@ -449,48 +272,12 @@ void PPU::tick()
         // Increment X Scroll
         if ((cycle < NES_SCREEN_WIDTH || cycle > 320) && cycle % 8 == 0)
         {
-            // Handle overflow into the next horizontal nametable
-            if ((vramAddress & COARSE_X_MASK) == 31)
-            {
-                vramAddress &= ~COARSE_X_MASK;
-                vramAddress ^= 0x0400; // XOR will cause a toggle
-            }
-            else
-            {
-                ++vramAddress;
-            }
+            incrementScrollX();
         }
         // Increment Y Scroll
         if (cycle == NES_SCREEN_WIDTH)
         {
-            // Check if we can safely increment fine y
-            if ((vramAddress & FINE_Y_MASK) != FINE_Y_MASK)
-            {
-                vramAddress += 0x1000;
-            }
-            else
-            {
-                // Clear fine y and increment coarse y to go to the next tile
-                // Since coarse y can be set out of bounds through v it has some special handling
-                vramAddress &= ~FINE_Y_MASK;
-
-                uint16 coarseY = (vramAddress & COARSE_Y_MASK) >> 5;
-                if (coarseY == 29)
-                {
-                    coarseY = 0;
-                    vramAddress ^= 0x0800;
-                }
-                else if (coarseY == 31)
-                {
-                    coarseY = 0;
-                }
-                else
-                {
-                    ++coarseY;
-                }
-
-                vramAddress = (vramAddress & ~COARSE_Y_MASK) | (coarseY << 5);
-            }
+            incrementScrollY();
         }
         // Copy horizontal components of t to v: horiz (v) = horiz (t)
         // v: ....A.. ...BCDEF <- t: ....A.. ...BCDEF
@@ -528,17 +315,318 @@ void PPU::tick()
     }
 }
 
-bool PPU::isNMIFlagSet()
+template <class Bus>
+uint32 PPU<Bus>::getScanlineBatchSize()
+{
+    // Line 0 can start on dot 1 when the odd frame skip happens, the idle dot is all we'd miss
+    if (scanline < NES_SCREEN_HEIGHT && cycle <= 1)
+    {
+        return (CYCLES_PER_SCANLINE + 1) - cycle;
+    }
+
+    return 0;
+}
+
+// Same work as calling tick for every dot in the line, just rearranged so the visible part doesn't have to
+// redo all of the per dot checks. This relies on nothing outside the ppu changing until the line is done:
+//  - Sprite units only depend on their own state until they get reloaded on 257, so they can be drawn up front
+//  - Sprite evaluation only touches oam, so it doesn't matter that it runs alongside the pixels
+//  - The background fetches for a tile aren't used until the shift registers get filled on its last dot,
+//    so the whole line of tiles can be fetched and decoded up front, still in the same order as the dot path.
+//    Pattern reads come out of the cartridge's tile cache unless the mapper is watching them
+//  - Palette reads have no side effects, so they only get read once
+// Everything from 257 on is still ticked, it's the cheap part of the line and has all the odd sprite fetch timing.
+// Only the nes ppu bus has a tile cache behind it, anything else goes through plain reads
+static const uint8* getCachedTileRow(PPUBus* bus, uint16 address) { return bus->getTileRow(address); }
+static const uint8* getCachedTileRow(IBus* bus, uint16 address) { return 0; }
+
+// Lays out every background pixel the shift registers would produce over dots 1-256, ignoring fine x.
+// Dot n shows pixel n - 1 + fineX. The first two tiles were fetched at the end of the last line and are
+// already in the shift registers, the rest are the tiles fetched every 8 dots on this one.
+// Leaves the fetch latches, shift registers and v as they would be after dot 256.
+template <class Bus>
+void PPU<Bus>::drawBackgroundLine(uint8* line)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        uint8 bit0 = (patternLoShift >> (15 - i)) & BIT_0;
+        uint8 bit1 = (patternHiShift >> (15 - i)) & BIT_0;
+
+        // The attribute registers only hold the first tile, the second is still waiting in the latch
+        uint8 bit2 = attributeBit0;
+        uint8 bit3 = attributeBit1;
+        if (i < 8)
+        {
+            bit2 = (attributeLoShift >> (7 - i)) & BIT_0;
+            bit3 = (attributeHiShift >> (7 - i)) & BIT_0;
+        }
+
+        line[i] = (bit3 << 3) | (bit2 << 2) | (bit1 << 1) | bit0;
+    }
+
+    // What's left in the shift registers after dot 256, see the end of the loop
+    uint8 patternLo248 = 0;
+    uint8 patternHi248 = 0;
+    uint8 attributeBit0At240 = 0;
+    uint8 attributeBit1At240 = 0;
+    uint8 attributeBit0At248 = 0;
+    uint8 attributeBit1At248 = 0;
+
+    for (uint32 dot = 8; dot <= NES_SCREEN_WIDTH; dot += 8)
+    {
+        fetchNameTable();
+        fetchAttribute();
+
+        // The last two tiles still get read for real so the latches end up right for the end of the line
+        const uint8* row = 0;
+        if (dot < NES_SCREEN_WIDTH - 8)
+        {
+            row = getCachedTileRow(bus, getBackgroundPatternAddress());
+        }
+
+        uint8 decoded[8];
+        if (!row)
+        {
+            fetchPatternLo();
+            fetchPatternHi();
+            TileCache::decodeRow(patternLoLatch, patternHiLatch, decoded);
+            row = decoded;
+        }
+
+        latchAttributeBits();
+
+        // Attribute bits get shifted in one at a time after each fill, so the registers end up with the tiles
+        // from 240 and 248. The pattern bits are shifted a whole tile along, so 248 and the one fetched on 256.
+        if (dot == NES_SCREEN_WIDTH - 16)
+        {
+            attributeBit0At240 = attributeBit0;
+            attributeBit1At240 = attributeBit1;
+        }
+        else if (dot == NES_SCREEN_WIDTH - 8)
+        {
+            patternLo248 = patternLoLatch;
+            patternHi248 = patternHiLatch;
+            attributeBit0At248 = attributeBit0;
+            attributeBit1At248 = attributeBit1;
+        }
+
+        uint8 attribute = (attributeBit1 << 3) | (attributeBit0 << 2);
+        uint8* output = line + dot + 8;
+        for (int i = 0; i < 8; ++i)
+        {
+            output[i] = row[i] | attribute;
+        }
+
+        if (isBackgroundEnabled)
+        {
+            if (dot < NES_SCREEN_WIDTH)
+            {
+                incrementScrollX();
+            }
+            else
+            {
+                incrementScrollY();
+            }
+        }
+    }
+
+    patternLoShift = (patternLo248 << 8) | patternLoLatch;
+    patternHiShift = (patternHi248 << 8) | patternHiLatch;
+    attributeLoShift = (attributeBit0At240 ? 0xFF00 : 0) | (attributeBit0At248 ? 0x00FF : 0);
+    attributeHiShift = (attributeBit1At240 ? 0xFF00 : 0) | (attributeBit1At248 ? 0x00FF : 0);
+}
+
+template <class Bus>
+uint32 PPU<Bus>::renderScanline()
+{
+    uint32 dotsRun = getScanlineBatchSize();
+    uint8* output = backbuffer + outputOffset;
+
+    if (isRenderingEnabled)
+    {
+        uint8 palette[32];
+        for (int i = 0; i < 32; ++i)
+        {
+            palette[i] = bus->read(0x3F00 + i);
+        }
+
+        // Lower units draw over higher ones, same as the priority loop in calculateSpritePixel
+        uint8 spritePixels[NES_SCREEN_WIDTH];
+        uint8 spriteOwners[NES_SCREEN_WIDTH];
+        memset(spritePixels, 0, sizeof(spritePixels));
+        memset(spriteOwners, 8, sizeof(spriteOwners));
+
+        if (areSpritesEnabled)
+        {
+            for (int i = 0; i < numSpritesToRender; ++i)
+            {
+                spriteRenderers[i].drawLine(spritePixels, spriteOwners, i, NES_SCREEN_WIDTH);
+            }
+        }
+
+        uint8 backgroundLine[NES_SCREEN_WIDTH + 16];
+        drawBackgroundLine(backgroundLine);
+
+        for (cycle = 1; cycle <= NES_SCREEN_WIDTH; ++cycle)
+        {
+            uint8 backgroundPixel = 0;
+            if (isBackgroundEnabled && (showBackgroundInLeftEdge || cycle > 8))
+            {
+                backgroundPixel = backgroundLine[cycle - 1 + fineX];
+            }
+
+            uint8 spritePixel = 0;
+            renderedSpriteIndex = 8;
+
+            if (areSpritesEnabled && (showSpritesInLeftEdge || cycle > 8))
+            {
+                spritePixel = spritePixels[cycle - 1];
+                renderedSpriteIndex = spriteOwners[cycle - 1];
+            }
+
+            *output++ = palette[mixPixels(backgroundPixel, spritePixel)];
+
+            if (cycle % 2 == 0)
+            {
+                evaluateSprites();
+            }
+        }
+    }
+    else
+    {
+        // With rendering off v can't move, so the whole line is one color
+        uint16 paletteAddress = 0x3F00;
+        if (vramAddress >= 0x3F00)
+        {
+            paletteAddress = vramAddress;
+        }
+
+        // Addresses past $3FFF wrap back into the pattern tables, let those go through the bus each time in case the mapper is watching
+        if ((paletteAddress & 0x3FFF) >= 0x3F00)
+        {
+            memset(output, bus->read(paletteAddress), NES_SCREEN_WIDTH);
+        }
+        else
+        {
+            for (int i = 0; i < NES_SCREEN_WIDTH; ++i)
+            {
+                output[i] = bus->read(paletteAddress);
+            }
+        }
+
+        for (cycle = 1; cycle <= NES_SCREEN_WIDTH; ++cycle)
+        {
+            shiftBackground();
+
+            if (cycle % 2 == 0)
+            {
+                evaluateSprites();
+            }
+        }
+    }
+
+    outputOffset += NES_SCREEN_WIDTH;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        spriteRenderers[i].skip(NES_SCREEN_WIDTH);
+    }
+
+    // Runs 257 through the end of the line, tick moves us on to the next one
+    while (cycle > 0)
+    {
+        tick();
+    }
+
+    return dotsRun;
+}
+
+template <class Bus>
+bool PPU<Bus>::isNMIFlagSet()
 {
     return nmiEnabled && nmiRequested;
 }
 
-bool PPU::isVBlankCycle()
+template <class Bus>
+bool PPU<Bus>::isVBlankCycle()
 {
     return cycle == 1 && scanline == 241;
 }
 
-void PPU::setControl(uint8 value)
+template <class Bus>
+uint32 PPU<Bus>::dotsUntilVBlank()
+{
+    const uint32 dotsPerScanline = CYCLES_PER_SCANLINE + 1;
+    const uint32 vblankStart = 241 * dotsPerScanline;
+
+    uint32 position = (scanline * dotsPerScanline) + cycle;
+    if (position <= vblankStart)
+    {
+        return vblankStart - position + 1;
+    }
+
+    // Have to wrap around into the next frame, which may skip a dot if it's odd so we assume it does
+    const uint32 dotsPerFrame = (PRERENDER_LINE + 1) * dotsPerScanline;
+    return (dotsPerFrame - position) + vblankStart;
+}
+
+template <class Bus>
+uint32 PPU<Bus>::dotsUntilStatusChange()
+{
+    // Sprite zero and overflow can't be predicted, but once they're both set they stay that way until the prerender line
+    bool canSetSpriteFlags = isRenderingEnabled && !(isSpriteZeroHit && isSpriteOverflowFlagSet);
+    if (canSetSpriteFlags && (scanline < 240 || scanline == PRERENDER_LINE))
+    {
+        return 0;
+    }
+
+    const uint32 dotsPerScanline = CYCLES_PER_SCANLINE + 1;
+    const uint32 prerenderStart = PRERENDER_LINE * dotsPerScanline;
+
+    uint32 position = (scanline * dotsPerScanline) + cycle;
+    uint32 dotsUntilPrerender = 0;
+    if (position <= prerenderStart)
+    {
+        dotsUntilPrerender = prerenderStart - position + 1;
+    }
+    else
+    {
+        // Same as dotsUntilVBlank, the next frame may skip a dot
+        const uint32 dotsPerFrame = (PRERENDER_LINE + 1) * dotsPerScanline;
+        dotsUntilPrerender = (dotsPerFrame - position) + prerenderStart;
+    }
+
+    uint32 dotsUntilVBlankStarts = dotsUntilVBlank();
+    return dotsUntilPrerender < dotsUntilVBlankStarts ? dotsUntilPrerender : dotsUntilVBlankStarts;
+}
+
+template <class Bus>
+void PPU<Bus>::getPositionAfter(uint32 dots, uint32* scanlineAfter, uint32* cycleAfter)
+{
+    const uint32 dotsPerScanline = CYCLES_PER_SCANLINE + 1;
+    const uint32 dotsPerFrame = (PRERENDER_LINE + 1) * dotsPerScanline;
+
+    uint32 position = (scanline * dotsPerScanline) + cycle + dots;
+    bool isOdd = isOddFrame;
+
+    // Same as the end of tick, odd frames skip the first dot when the background is on.
+    // Nothing that decides that can change until the ppu has caught up
+    while (position >= dotsPerFrame)
+    {
+        position -= dotsPerFrame;
+        isOdd = !isOdd;
+        if (isOdd && isBackgroundEnabled)
+        {
+            ++position;
+        }
+    }
+
+    *scanlineAfter = position / dotsPerScanline;
+    *cycleAfter = position % dotsPerScanline;
+}
+
+template <class Bus>
+void PPU<Bus>::setControl(uint8 value)
 {
     nmiEnabled = value & BIT_7;
 
@@ -572,7 +660,8 @@ void PPU::setControl(uint8 value)
     tempVramAddress |= (uint16)(value & 0x03) << 10;
 }
 
-void PPU::setMask(uint8 mask)
+template <class Bus>
+void PPU<Bus>::setMask(uint8 mask)
 {
     shouldRenderGreyscale =     (mask & BIT_0) > 0;
     showBackgroundInLeftEdge =  (mask & BIT_1) > 0;
@@ -586,7 +675,8 @@ void PPU::setMask(uint8 mask)
     isRenderingEnabled = isBackgroundEnabled || areSpritesEnabled;
 }
 
-uint8 PPU::getStatus(bool readOnly)
+template <class Bus>
+uint8 PPU<Bus>::getStatus(bool readOnly)
 {
     uint8 status = 0;
     if (isSpriteOverflowFlagSet)
@@ -625,17 +715,20 @@ uint8 PPU::getStatus(bool readOnly)
     return status;
 }
 
-void PPU::setOamAddress(uint8 value)
+template <class Bus>
+void PPU<Bus>::setOamAddress(uint8 value)
 {
     oamAddress = value;
 }
 
-void PPU::setOamData(uint8 value)
+template <class Bus>
+void PPU<Bus>::setOamData(uint8 value)
 {
     oam[oamAddress++] = value;
 }
 
-uint8 PPU::getOamData()
+template <class Bus>
+uint8 PPU<Bus>::getOamData()
 {
     // Part of the Secondary OAM initialization
     bool inSpriteEvaluation = scanline > 0 && scanline < NES_SCREEN_HEIGHT&& cycle > 0 && cycle <= 64;
@@ -649,7 +742,8 @@ uint8 PPU::getOamData()
     return oam[oamAddress];
 }
 
-void PPU::setScroll(uint8 value)
+template <class Bus>
+void PPU<Bus>::setScroll(uint8 value)
 {
     // First write
     if (!isWriteLatchActive)
@@ -673,7 +767,8 @@ void PPU::setScroll(uint8 value)
     isWriteLatchActive = !isWriteLatchActive;
 }
 
-void PPU::setAddress(uint8 value)
+template <class Bus>
+void PPU<Bus>::setAddress(uint8 value)
 {
     // First write
     if (!isWriteLatchActive)
@@ -697,7 +792,8 @@ void PPU::setAddress(uint8 value)
     isWriteLatchActive = !isWriteLatchActive;
 }
 
-void PPU::setData(uint8 value)
+template <class Bus>
+void PPU<Bus>::setData(uint8 value)
 {
     bus->write(vramAddress, value);
     vramAddress += vramAddressIncrement;
@@ -706,7 +802,8 @@ void PPU::setData(uint8 value)
     bus->read(vramAddress);
 }
 
-uint8 PPU::getData(bool readOnly)
+template <class Bus>
+uint8 PPU<Bus>::getData(bool readOnly)
 {
     if (readOnly)
     {
@@ -739,7 +836,265 @@ uint8 PPU::getData(bool readOnly)
 
 // Util functions
 
-uint8 PPU::calculateBackgroundPixel()
+template <class Bus>
+void PPU<Bus>::shiftBackground()
+{
+    patternLoShift <<= 1;
+    patternHiShift <<= 1;
+    attributeLoShift <<= 1;
+    attributeHiShift <<= 1;
+    attributeLoShift |= attributeBit0;
+    attributeHiShift |= attributeBit1;
+}
+
+template <class Bus>
+void PPU<Bus>::fetchNameTable()
+{
+    uint16 nameTableAddress = 0x2000 | (vramAddress & 0x0FFF);
+    nameTableLatch = bus->read(nameTableAddress);
+}
+
+template <class Bus>
+void PPU<Bus>::fetchAttribute()
+{
+    // From the Wiki this is the address we want
+    // NN 1111 YYY XXX
+    // || |||| ||| +++--- high 3 bits of coarse X(x / 4)
+    // || |||| +++------- high 3 bits of coarse Y(y / 4)
+    // || ++++----------- attribute offset(960 bytes)
+    // ++---------------- nametable select
+    uint16 coarseX = (vramAddress & COARSE_X_MASK) >> 2;
+    uint16 coarseY = (vramAddress & 0x0380) >> 4;
+    uint16 nameTableSelect = vramAddress & 0x0C00;
+    uint16 attributeAddress = 0x23C0 | nameTableSelect | coarseY | coarseX;
+    attributeLatch = bus->read(attributeAddress);
+}
+
+template <class Bus>
+uint16 PPU<Bus>::getBackgroundPatternAddress()
+{
+    // Pattern table address Scheme
+    // 0H RRRR CCCC PTTT
+    // || |||| |||| |+++--- T : Fine Y offset, the row number within a tile
+    // || |||| |||| +------ P : Bit plane (0: "lower"; 1: "upper")
+    // || |||| ++++-------- C : Tile column
+    // || ++++------------- R : Tile row
+    // |+------------------ H : Half of pattern table (0: "left"; 1: "right")
+    // +------------------- 0 : Pattern table is at $0000 - $1FFF
+    uint16 fineY = (vramAddress & FINE_Y_MASK) >> 12;
+    uint16 tileOffset = ((uint16)nameTableLatch) << 4;
+    uint16 bitPlane = 0;
+    return fineY | bitPlane | tileOffset | backgroundPatternBaseAddress;
+}
+
+template <class Bus>
+void PPU<Bus>::fetchPatternLo()
+{
+    patternLoLatch = bus->read(getBackgroundPatternAddress());
+}
+
+template <class Bus>
+void PPU<Bus>::fetchPatternHi()
+{
+    patternHiLatch = bus->read(getBackgroundPatternAddress() | BIT_3);
+}
+
+template <class Bus>
+void PPU<Bus>::loadShiftRegisters()
+{
+    // Fill the shift registers
+    // TODO: This may need to occur separately/in the pixel render so it can be started at
+    // a certain cycle offset, for sprite overwrite or something (Shift registers require a
+    // clock, where the reads would be available immediately, so assuming after the render for now)
+
+    // TODO: Yeah the more I fill out the attribute stuff the more realize this is wasting a lot of cycles
+    // and making it more complicated will definitely refactor
+
+    // In theory the bottom 8 bits are already clear from the shift operations, so OR is fine
+    patternLoShift |= patternLoLatch;
+    patternHiShift |= patternHiLatch;
+
+    latchAttributeBits();
+}
+
+template <class Bus>
+void PPU<Bus>::latchAttributeBits()
+{
+    // attribute table covers a 4 x 4 tile area so bit 0 doesn't matter
+    // and the next 3 bits after this got us this attribute in the first place
+    bool isRightAttribute = vramAddress & BIT_1;
+    bool isBottomAttribute = vramAddress & BIT_6;
+    if (isRightAttribute)
+    {
+        if (isBottomAttribute)
+        {
+            // Bottom Right
+            attributeBit0 = (attributeLatch >> 6) & BIT_0;
+            attributeBit1 = attributeLatch >> 7;
+        }
+        else
+        {
+            // Top Right
+            attributeBit0 = (attributeLatch >> 2) & BIT_0;
+            attributeBit1 = (attributeLatch >> 3) & BIT_0;
+        }
+    }
+    else
+    {
+        if (isBottomAttribute)
+        {
+            // Bottom Left
+            attributeBit0 = (attributeLatch >> 4) & BIT_0;
+            attributeBit1 = (attributeLatch >> 5) & BIT_0;
+        }
+        else
+        {
+            // Top Left
+            attributeBit0 = attributeLatch & BIT_0;
+            attributeBit1 = (attributeLatch >> 1) & BIT_0;
+        }
+    }
+}
+
+template <class Bus>
+void PPU<Bus>::incrementScrollX()
+{
+    // Handle overflow into the next horizontal nametable
+    if ((vramAddress & COARSE_X_MASK) == 31)
+    {
+        vramAddress &= ~COARSE_X_MASK;
+        vramAddress ^= 0x0400; // XOR will cause a toggle
+    }
+    else
+    {
+        ++vramAddress;
+    }
+}
+
+template <class Bus>
+void PPU<Bus>::incrementScrollY()
+{
+    // Check if we can safely increment fine y
+    if ((vramAddress & FINE_Y_MASK) != FINE_Y_MASK)
+    {
+        vramAddress += 0x1000;
+    }
+    else
+    {
+        // Clear fine y and increment coarse y to go to the next tile
+        // Since coarse y can be set out of bounds through v it has some special handling
+        vramAddress &= ~FINE_Y_MASK;
+
+        uint16 coarseY = (vramAddress & COARSE_Y_MASK) >> 5;
+        if (coarseY == 29)
+        {
+            coarseY = 0;
+            vramAddress ^= 0x0800;
+        }
+        else if (coarseY == 31)
+        {
+            coarseY = 0;
+        }
+        else
+        {
+            ++coarseY;
+        }
+
+        vramAddress = (vramAddress & ~COARSE_Y_MASK) | (coarseY << 5);
+    }
+}
+
+template <class Bus>
+void PPU<Bus>::evaluateSprites()
+{
+    // Clearing Phase;
+    if (cycle == 64)
+    {
+        for (int i = 0; i < 32; ++i)
+        {
+            oamSecondary[i] = 0xFF;
+        }
+
+        secondaryOamAddress = 0;
+        isSecondaryOAMWriteDisabled = false;
+        numSpritesChecked = 0;
+        numSpritesFound = 0;
+    }
+    else if (isRenderingEnabled && cycle > 64)
+    {
+        uint8 oamValue = oam[oamAddress];
+        if (isCopyingSprite)
+        {
+            oamSecondary[secondaryOamAddress++] = oamValue;
+            ++oamAddress;
+            isCopyingSprite = secondaryOamAddress % 4 > 0;
+
+            if (secondaryOamAddress >= 32)
+            {
+                isSecondaryOAMWriteDisabled = true;
+                secondaryOamAddress = 0;
+            }
+        }
+        else if (numSpritesChecked < 64)
+        {
+            // We haven't hit 8 sprites yet so check if there's one on this scanline
+            if (!isSecondaryOAMWriteDisabled)
+            {
+                // We always write this for some reason, seems to be somewhat of a sentinal value
+                oamSecondary[secondaryOamAddress] = oamValue;
+
+                uint32 spriteTop = oamValue;
+                uint32 spriteBottom = spriteTop + spriteHeight;
+
+                if (spriteTop < NES_SCREEN_HEIGHT && scanline >= spriteTop && scanline < spriteBottom)
+                {
+                    selectedSpriteIndices[numSpritesFound] = numSpritesChecked;
+
+                    ++secondaryOamAddress;
+                    ++oamAddress;
+                    isCopyingSprite = true;
+                    ++numSpritesFound;
+                }
+                else
+                {
+                    oamAddress += 4;
+                }
+            }
+            // Continue checking for sprite overflow
+            // There's a known bug where the address increments incorrectly once the write inhibit flag has been set
+            // https://www.nesdev.org/wiki/PPU_sprite_evaluation#Sprite_overflow_bug
+            // This was poorly worded and hard to follow, so I'll try to clarify
+            // The stuff about n and m imply there are separate values that index directly into oam but
+            // they're actually just portions of the oam address. m is not incremented with n if the y isn't in range
+            // thats only true once you've hit the write inhibit flag after 8 sprites copied over
+            // Treating it as separate values would mean that writing to OAMADDR after its been cleared wouldn't have negative consequences
+            // I could be wrong about this, it's hard to tell when it should come up..
+            else
+            {
+                // "n" in this case gets incremented every time due to the bug
+                oamAddress += 4;
+
+                uint32 spriteTop = oamValue;
+                uint32 spriteBottom = spriteTop + spriteHeight;
+                if (spriteTop < NES_SCREEN_HEIGHT && scanline >= spriteTop && scanline < spriteBottom)
+                {
+                    isSpriteOverflowFlagSet = true;
+                }
+                else
+                {
+                    // m gets incremented without the carry bit resulting in the "diagonal" fetch pattern for the y
+                    uint8 m = (oamAddress & 0x03) + 1;
+                    oamAddress = (oamAddress & 0xFC) | (m & 0x03);
+                }
+            }
+
+            ++numSpritesChecked;
+        }
+    }
+}
+
+template <class Bus>
+uint8 PPU<Bus>::calculateBackgroundPixel()
 {
     if (!isBackgroundEnabled)
     {
@@ -763,7 +1118,8 @@ uint8 PPU::calculateBackgroundPixel()
     return (bit3 << 3) | (bit2 << 2) | (bit1 << 1) | bit0;
 }
 
-uint8 PPU::calculateSpritePixel()
+template <class Bus>
+uint8 PPU<Bus>::calculateSpritePixel()
 {
     if (!areSpritesEnabled)
     {
@@ -791,4 +1147,122 @@ uint8 PPU::calculateSpritePixel()
     // May not need this but its an extra way to know we rendered nothing
     renderedSpriteIndex = 8;
     return 0;
-}
\ No newline at end of file
+}
+
+template <class Bus>
+uint8 PPU<Bus>::mixPixels(uint8 backgroundPixel, uint8 spritePixel)
+{
+    bool backgroundVisible = backgroundPixel & 0x03;
+    bool spriteVisible = spritePixel & 0x03;
+
+    uint8 pixel = 0;
+    if (backgroundVisible && spriteVisible)
+    {
+        if (spriteRenderers[renderedSpriteIndex].oamIndex == 0
+            && spriteRenderers[renderedSpriteIndex].getX() != 0xFF
+            && cycle != NES_SCREEN_WIDTH)
+        {
+            isSpriteZeroHit = true;
+        }
+
+        if (spriteRenderers[renderedSpriteIndex].getPriority())
+        {
+            pixel = backgroundPixel;
+        }
+        else
+        {
+            pixel = spritePixel;
+        }
+    }
+    else if (spriteVisible)
+    {
+        pixel = spritePixel;
+    }
+    else if (backgroundVisible)
+    {
+        pixel = backgroundPixel;
+    }
+
+    return pixel;
+}
+
+template <class Bus>
+void PPU<Bus>::serialize(SaveState* state)
+{
+    state->value(cycle);
+    state->value(scanline);
+    state->value(pixel);
+
+    // Both buffers are needed, one is on screen and the other is partly drawn
+    bool isFrontBufferOne = frontBuffer == screenBufferOne;
+    state->value(isFrontBufferOne);
+    frontBuffer = isFrontBufferOne ? screenBufferOne : screenBufferTwo;
+    backbuffer = isFrontBufferOne ? screenBufferTwo : screenBufferOne;
+
+    state->bytes(screenBufferOne, sizeof(screenBufferOne));
+    state->bytes(screenBufferTwo, sizeof(screenBufferTwo));
+    state->value(outputOffset);
+
+    state->value(backgroundPatternBaseAddress);
+    state->value(vramAddress);
+    state->value(tempVramAddress);
+    state->value(fineX);
+    state->value(isWriteLatchActive);
+
+    state->value(nmiRequested);
+    state->value(nmiEnabled);
+    state->value(isOddFrame);
+    state->value(suppressNmi);
+    state->value(ppuDataReadBuffer);
+
+    state->value(useTallSprites);
+    state->value(spriteHeight);
+    state->value(vramAddressIncrement);
+    state->value(spritePatternBaseAddress);
+    state->value(isSpriteOverflowFlagSet);
+    state->value(isSpriteZeroHit);
+
+    state->value(shouldRenderGreyscale);
+    state->value(showBackgroundInLeftEdge);
+    state->value(showSpritesInLeftEdge);
+    state->value(isBackgroundEnabled);
+    state->value(areSpritesEnabled);
+    state->value(shouldEmphasizeRed);
+    state->value(shouldEmphasizeGreen);
+    state->value(shouldEmphasizeBlue);
+    state->value(isRenderingEnabled);
+
+    state->value(nameTableLatch);
+    state->value(attributeLatch);
+    state->value(patternLoLatch);
+    state->value(patternHiLatch);
+    state->value(patternLoShift);
+    state->value(patternHiShift);
+    state->value(attributeLoShift);
+    state->value(attributeHiShift);
+    state->value(attributeBit0);
+    state->value(attributeBit1);
+
+    state->value(oamAddress);
+    state->bytes(oam, sizeof(oam));
+    state->bytes(oamSecondary, sizeof(oamSecondary));
+    state->bytes(selectedSpriteIndices, sizeof(selectedSpriteIndices));
+
+    for (int i = 0; i < 8; ++i)
+    {
+        spriteRenderers[i].serialize(state);
+    }
+
+    state->value(renderedSpriteIndex);
+    state->value(isSecondaryOAMWriteDisabled);
+    state->value(isCopyingSprite);
+    state->value(secondaryOamAddress);
+    state->value(numSpritesChecked);
+    state->value(numSpritesFound);
+    state->value(numSpritesToRender);
+    state->value(numSpritesFetched);
+}
+
+// See MOS6502, same deal here with the ppu bus
+template class PPU<PPUBus>;
+template class PPU<IBus>;
@@ -2,26 +2,59 @@
 #include "romulus.h"
 #include "../bus.h"
 #include "spriteRenderUnit.h"
+#include "saveState.h"
+#include "stateHash.h"
 
 // TODO: Replace raw masks values with constants to better document the code
 
 #define NES_SCREEN_HEIGHT 240
 #define NES_SCREEN_WIDTH  256
 
+// Templated on the bus for the same reason as the cpu, avoids a virtual call on every fetch
+template <class Bus>
 class PPU
 {
 public:
-    PPU();
-    void connect(IBus* bus) { this->bus = bus; }
+    // No constructor so the owner can value initialize it, which zeroes every register reset doesn't touch
+    void connect(Bus* bus) { this->bus = bus; }
 
+    // Clears all the memory and registers, reset only touches what the reset line does
+    void powerOn();
     void reset();
     void tick();
 
+    // Fast path for drawing whole visible scanlines, only safe when nothing outside the ppu can change before the line ends.
+    // Returns the dots left in the line if we're at the start of one, or 0 if it has to go dot by dot
+    uint32 getScanlineBatchSize();
+
+    // Runs the rest of the scanline, returns the number of dots run. Output matches calling tick for each of them
+    uint32 renderScanline();
+
     bool isNMIFlagSet();
     bool isNMISuppressed() { return suppressNmi; }
     bool isNMIEnabled() { return nmiEnabled; }
     bool isVBlankCycle();
 
+    // Lower bound on the number of ticks until vblank starts (including that tick)
+    // Used by the scheduler to know how long the ppu can be left behind the cpu
+    uint32 dotsUntilVBlank();
+
+    // Lower bound on the ticks until PPUSTATUS could read differently with nothing touching the ppu: vblank starting,
+    // the prerender line clearing the flags, or the sprite flags getting set while a frame renders (0 then)
+    uint32 dotsUntilStatusChange();
+
+    // Where the ppu will be after running the given number of ticks, without running them (ex: for the scheduler's owed dots)
+    void getPositionAfter(uint32 dots, uint32* scanlineAfter, uint32* cycleAfter);
+
+    void serialize(SaveState* state);
+
+    // Just what's visible from outside (sprites and the finished frame), for spotting runs that have diverged
+    void hashState(StateHash* hash)
+    {
+        hash->bytes(oam, sizeof(oam));
+        hash->bytes(frontBuffer, NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT);
+    }
+
     // CPU <=> PPU Bus functions
 
     void setControl(uint8 value);
@@ -52,6 +85,10 @@ public:
     uint8* frontBuffer;
     uint8* backbuffer;
 
+    // Counts up every time a finished frame is swapped to the front, so anything watching can tell a new one is ready
+    // Not part of save states, it keeps counting through loads
+    uint32 frameCount;
+
     uint16 outputOffset;
 
     // TODO: don't expose anything below here, only doing for debug view that should probably be using functions or be in the ppu itself
@@ -76,7 +113,7 @@ public:
     bool isWriteLatchActive;
 
 private:
-    IBus* bus;
+    Bus* bus;
 
     // Set at the start of vblank: dot 1 of scanline 241
     // Cleared at the end of vblank: dot 1 of pre-render
@@ -183,4 +220,22 @@ private:
 
     uint8 calculateBackgroundPixel();
     uint8 calculateSpritePixel();
+
+    // Picks the visible pixel and checks for sprite zero hits, renderedSpriteIndex has to be set for the sprite pixel
+    uint8 mixPixels(uint8 backgroundPixel, uint8 spritePixel);
+
+    void shiftBackground();
+    void fetchNameTable();
+    void fetchAttribute();
+    uint16 getBackgroundPatternAddress();
+    void fetchPatternLo();
+    void fetchPatternHi();
+    void loadShiftRegisters();
+    void latchAttributeBits();
+    void incrementScrollX();
+    void incrementScrollY();
+    void evaluateSprites();
+
+    // Decodes the background for the visible part of a scanline in one go, see renderScanline
+    void drawBackgroundLine(uint8* line);
 };
\ No newline at end of file
@@ -32,6 +32,75 @@ void SpriteRenderUnit::tick()
     }
 }
 
+void SpriteRenderUnit::skip(uint32 count)
+{
+    if (!isEnabled)
+    {
+        return;
+    }
+
+    if (xCounter >= count)
+    {
+        xCounter -= count;
+        return;
+    }
+
+    count -= xCounter;
+    xCounter = 0;
+
+    if (currentPixel + count >= 8)
+    {
+        reset();
+        return;
+    }
+
+    currentPixel += count;
+    if (flipHorizontal)
+    {
+        patternLoShift >>= count;
+        patternHiShift >>= count;
+    }
+    else
+    {
+        patternLoShift <<= count;
+        patternHiShift <<= count;
+    }
+}
+
+void SpriteRenderUnit::drawLine(uint8* pixels, uint8* owners, uint8 index, uint32 count)
+{
+    if (!isEnabled)
+    {
+        return;
+    }
+
+    uint8 lo = patternLoShift;
+    uint8 hi = patternHiShift;
+
+    for (uint32 x = xCounter, p = currentPixel; x < count && p < 8; ++x, ++p)
+    {
+        uint8 bits = 0;
+        if (flipHorizontal)
+        {
+            bits = (lo & BIT_0) | ((hi & BIT_0) << 1);
+            lo >>= 1;
+            hi >>= 1;
+        }
+        else
+        {
+            bits = ((lo & BIT_7) >> 7) | ((hi & BIT_7) >> 6);
+            lo <<= 1;
+            hi <<= 1;
+        }
+
+        if (bits && !(pixels[x] & 0x03))
+        {
+            pixels[x] = BIT_4 | pallete | bits;
+            owners[x] = index;
+        }
+    }
+}
+
 void SpriteRenderUnit::reset()
 {
     isEnabled = false;
@@ -85,3 +154,20 @@ uint8 SpriteRenderUnit::calculatePixel()
 
     return BIT_4 | pallete | bit1 | bit0;
 }
+
+void SpriteRenderUnit::serialize(SaveState* state)
+{
+    state->value(patternLoShift);
+    state->value(patternHiShift);
+    state->value(patternTableAddress);
+    state->value(oamIndex);
+    state->value(isEnabled);
+
+    state->value(pallete);
+    state->value(priority);
+    state->value(xCounter);
+    state->value(xPosition);
+    state->value(flipHorizontal);
+    state->value(flipVertical);
+    state->value(currentPixel);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "romulus.h"
+#include "saveState.h"
 
 struct SpriteRenderUnit
 {
@@ -14,6 +15,13 @@ struct SpriteRenderUnit
     void tick();
     void reset();
 
+    // Same result as ticking count times, for when the ppu draws a whole line at once
+    void skip(uint32 count);
+
+    // Writes the opaque pixels this unit would output over the next count ticks into a line, tagged with the unit index.
+    // Pixels already drawn by an earlier unit are left alone. Doesn't change the unit, call skip after
+    void drawLine(uint8* pixels, uint8* owners, uint8 index, uint32 count);
+
     void setAttribute(uint8 value);
     void setX(uint8 value);
     uint8 getX();
@@ -23,6 +31,8 @@ struct SpriteRenderUnit
 
     uint8 calculatePixel();
 
+    void serialize(SaveState* state);
+
 private:
     uint8 pallete;
     uint8 priority;
@@ -1,10 +1,17 @@
 #include "ppuBus.h"
+#include <string.h>
 
 void PPUBus::connect(Cartridge* cart)
 {
     this->cart = cart;
 }
 
+void PPUBus::powerOn()
+{
+    memset(vram, 0, sizeof(vram));
+    memset(paletteRam, 0, sizeof(paletteRam));
+}
+
 // This read and write is based on mapper000, will expand later
 uint8 PPUBus::read(uint16 address)
 {
@@ -3,16 +3,42 @@
 #include "ppu/ppu.h"
 #include "cartridge.h"
 
-class PPUBus : public IBus
+class PPUBus final : public IBus
 {
 public:
     void connect(Cartridge* cart);
 
+    // Clears the nametables and palettes
+    void powerOn();
+
     uint8 read(uint16 address);
     void write(uint16 address, uint8 value);
 
+    // Decoded row of the tile at a pattern table address, or null if the read has to go through read() for the mapper to see it
+    const uint8* getTileRow(uint16 address)
+    {
+        if (cart->hasChrReadSideEffects())
+        {
+            return 0;
+        }
+
+        return cart->getTileRow(address & 0x1FFF);
+    }
+
     // Ensures reads have no side effects (Used for logging and debug views)
-    void setReadOnly(bool enable) { cart->isReadOnly = enable; };
+    void setReadOnly(bool enable) { cart->setReadOnly(enable); };
+
+    void serialize(SaveState* state)
+    {
+        state->bytes(vram, sizeof(vram));
+        state->bytes(paletteRam, sizeof(paletteRam));
+    }
+
+    void hashState(StateHash* hash)
+    {
+        hash->bytes(vram, sizeof(vram));
+        hash->bytes(paletteRam, sizeof(paletteRam));
+    }
 
 private:
     Cartridge* cart;
@@ -0,0 +1,314 @@
+#include "rewind.h"
+#include <string.h>
+
+const uint32 NO_FRAME = 0xFFFFFFFF;
+
+// Deltas are a list of runs: skip count, copy count, then the copied bytes
+const uint32 RUN_HEADER_SIZE = 4;
+const uint32 MAX_RUN = 0xFFFF;
+
+// Changes this close together get merged into one run, since a new header costs more than copying the gap
+const uint32 MIN_RUN_GAP = 8;
+
+bool RewindBuffer::init(uint32 memoryBudget, uint32 maxFrames, uint32 keyframeInterval)
+{
+    shutdown();
+
+    if (maxFrames < 2 || keyframeInterval == 0)
+    {
+        return false;
+    }
+
+    data = new uint8[memoryBudget];
+    dataSize = memoryBudget;
+    frames = new Frame[maxFrames];
+    this->maxFrames = maxFrames;
+    this->keyframeInterval = keyframeInterval;
+
+    clear(stateSize);
+    return true;
+}
+
+void RewindBuffer::shutdown()
+{
+    delete[] data;
+    delete[] frames;
+    delete[] captureBuffer;
+    delete[] deltaBuffer;
+    delete[] decodeBuffer;
+
+    data = 0;
+    frames = 0;
+    captureBuffer = 0;
+    deltaBuffer = 0;
+    decodeBuffer = 0;
+
+    dataSize = 0;
+    maxFrames = 0;
+    scratchSize = 0;
+    frameCount = 0;
+}
+
+void RewindBuffer::clear(uint32 stateSize)
+{
+    this->stateSize = stateSize;
+    oldestFrame = 0;
+    frameCount = 0;
+    dataHead = 0;
+    bytesStored = 0;
+    framesSinceKeyframe = 0;
+
+    // Scratch space only gets reallocated when a bigger state comes along
+    if (isEnabled() && stateSize > scratchSize)
+    {
+        delete[] captureBuffer;
+        delete[] deltaBuffer;
+        delete[] decodeBuffer;
+
+        captureBuffer = new uint8[stateSize];
+        deltaBuffer = new uint8[stateSize];
+        decodeBuffer = new uint8[stateSize];
+        scratchSize = stateSize;
+    }
+}
+
+void RewindBuffer::push()
+{
+    uint32 offset = 0;
+
+    if (frameCount > 0 && framesSinceKeyframe < keyframeInterval)
+    {
+        uint32 keyframe = frames[newestFrame()].keyframe;
+        uint32 size = encodeDelta(data + frames[keyframe].offset, captureBuffer);
+
+        // If the delta is too big or there isn't room without losing its keyframe, fall back to a keyframe
+        if (size > 0 && allocate(size, keyframe, &offset))
+        {
+            memcpy(data + offset, deltaBuffer, size);
+
+            uint32 index = (oldestFrame + frameCount) % maxFrames;
+            frames[index] = { offset, size, keyframe };
+            ++frameCount;
+            ++framesSinceKeyframe;
+            bytesStored += size;
+            return;
+        }
+    }
+
+    if (!allocate(stateSize, NO_FRAME, &offset))
+    {
+        // Budget can't fit even a single state
+        return;
+    }
+
+    memcpy(data + offset, captureBuffer, stateSize);
+
+    uint32 index = (oldestFrame + frameCount) % maxFrames;
+    frames[index] = { offset, stateSize, index };
+    ++frameCount;
+    framesSinceKeyframe = 1;
+    bytesStored += stateSize;
+}
+
+const uint8* RewindBuffer::stepBack()
+{
+    // The newest frame is the current state, so we need one more to go back to
+    if (frameCount < 2)
+    {
+        return 0;
+    }
+
+    // Frames are allocated in order, so dropping the newest gives its space straight back
+    Frame& dropped = frames[newestFrame()];
+    dataHead = dropped.offset;
+    bytesStored -= dropped.size;
+    --frameCount;
+
+    uint32 index = newestFrame();
+    framesSinceKeyframe = ((index + maxFrames - frames[index].keyframe) % maxFrames) + 1;
+
+    decodeFrame(index);
+    return decodeBuffer;
+}
+
+uint32 RewindBuffer::encodeDelta(const uint8* keyframe, const uint8* state)
+{
+    uint32 outputSize = 0;
+    uint32 runEnd = 0;
+    uint32 i = 0;
+
+    while (i < stateSize)
+    {
+        // Skip over matching bytes a word at a time
+        uint64 a, b;
+        while (i + 8 <= stateSize)
+        {
+            memcpy(&a, keyframe + i, 8);
+            memcpy(&b, state + i, 8);
+            if (a != b)
+            {
+                break;
+            }
+
+            i += 8;
+        }
+
+        while (i < stateSize && keyframe[i] == state[i])
+        {
+            ++i;
+        }
+
+        if (i >= stateSize)
+        {
+            break;
+        }
+
+        // Extend the run until there's a long enough stretch of matching bytes
+        uint32 runStart = i;
+        uint32 matching = 0;
+        while (i < stateSize && matching < MIN_RUN_GAP)
+        {
+            matching = keyframe[i] == state[i] ? matching + 1 : 0;
+            ++i;
+        }
+
+        uint32 skip = runStart - runEnd;
+        runEnd = i - matching;
+
+        // Counts are 16 bit, so long gaps and runs get split up
+        uint32 cursor = runStart;
+        while (skip > 0 || cursor < runEnd)
+        {
+            uint16 skipCount = (uint16)(skip > MAX_RUN ? MAX_RUN : skip);
+            skip -= skipCount;
+
+            uint16 copyCount = 0;
+            if (skip == 0)
+            {
+                uint32 remaining = runEnd - cursor;
+                copyCount = (uint16)(remaining > MAX_RUN ? MAX_RUN : remaining);
+            }
+
+            // Not worth it if the delta ends up bigger than just storing a keyframe
+            if (outputSize + RUN_HEADER_SIZE + copyCount > stateSize)
+            {
+                return 0;
+            }
+
+            uint8* output = deltaBuffer + outputSize;
+            memcpy(output, &skipCount, 2);
+            memcpy(output + 2, &copyCount, 2);
+            memcpy(output + RUN_HEADER_SIZE, state + cursor, copyCount);
+
+            outputSize += RUN_HEADER_SIZE + copyCount;
+            cursor += copyCount;
+        }
+    }
+
+    // An empty delta still needs a frame, so give it an empty run
+    if (outputSize == 0)
+    {
+        memset(deltaBuffer, 0, RUN_HEADER_SIZE);
+        outputSize = RUN_HEADER_SIZE;
+    }
+
+    return outputSize;
+}
+
+void RewindBuffer::decodeFrame(uint32 index)
+{
+    Frame& frame = frames[index];
+    Frame& keyframe = frames[frame.keyframe];
+    memcpy(decodeBuffer, data + keyframe.offset, stateSize);
+
+    if (frame.keyframe == index)
+    {
+        return;
+    }
+
+    uint8* input = data + frame.offset;
+    uint8* end = input + frame.size;
+    uint32 cursor = 0;
+    while (input < end)
+    {
+        uint16 skipCount, copyCount;
+        memcpy(&skipCount, input, 2);
+        memcpy(&copyCount, input + 2, 2);
+        input += RUN_HEADER_SIZE;
+
+        cursor += skipCount;
+        memcpy(decodeBuffer + cursor, input, copyCount);
+        cursor += copyCount;
+        input += copyCount;
+    }
+}
+
+void RewindBuffer::evictOldest()
+{
+    // The oldest frame is always a keyframe, take all of the deltas against it along with it
+    uint32 keyframe = oldestFrame;
+    do
+    {
+        bytesStored -= frames[oldestFrame].size;
+        oldestFrame = (oldestFrame + 1) % maxFrames;
+        --frameCount;
+    } while (frameCount > 0 && frames[oldestFrame].keyframe == keyframe);
+}
+
+bool RewindBuffer::allocate(uint32 size, uint32 keepKeyframe, uint32* offset)
+{
+    if (size > dataSize)
+    {
+        return false;
+    }
+
+    while (frameCount >= maxFrames)
+    {
+        if (oldestFrame == keepKeyframe)
+        {
+            return false;
+        }
+
+        evictOldest();
+    }
+
+    while (frameCount > 0)
+    {
+        uint32 tail = frames[oldestFrame].offset;
+        if (dataHead > tail)
+        {
+            // Live data is [tail, head), room at the end or back at the start
+            if (dataHead + size <= dataSize)
+            {
+                *offset = dataHead;
+                dataHead += size;
+                return true;
+            }
+
+            if (size <= tail)
+            {
+                *offset = 0;
+                dataHead = size;
+                return true;
+            }
+        }
+        // Live data has wrapped around, so only the gap between head and tail is free
+        else if (dataHead + size <= tail)
+        {
+            *offset = dataHead;
+            dataHead += size;
+            return true;
+        }
+
+        if (oldestFrame == keepKeyframe)
+        {
+            return false;
+        }
+
+        evictOldest();
+    }
+
+    *offset = 0;
+    dataHead = size;
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "romulus.h"
+
+// Keeps a history of save states so the console can be stepped backwards a frame at a time.
+// Every keyframeInterval frames a full snapshot is stored, and every frame in between is stored as
+// the runs of bytes that differ from that keyframe. Most of the state (ram, oam, cart ram, the screen)
+// barely changes from frame to frame, so the deltas stay small.
+// Deltas are always against a keyframe rather than the previous frame, so any frame can be restored with
+// one copy and one patch, no matter how much history there is.
+class RewindBuffer
+{
+public:
+    // Allocates all the memory up front. The budget is for stored snapshots, the oldest are dropped to stay under it.
+    // maxFrames caps how far back we can go even if there's memory left (ex 60 * seconds)
+    bool init(uint32 memoryBudget, uint32 maxFrames, uint32 keyframeInterval);
+    void shutdown();
+
+    bool isEnabled() { return data != 0; }
+
+    // Drops all history, needs to be called whenever the size of the state changes (ex new rom loaded)
+    void clear(uint32 stateSize);
+
+    // Where the next snapshot should be written before calling push
+    uint8* getCaptureBuffer() { return captureBuffer; }
+    uint32 getStateSize() { return stateSize; }
+
+    // Stores the capture buffer as the newest frame
+    void push();
+
+    // Drops the newest frame and returns the decoded one before it, or null if there's nothing to go back to
+    const uint8* stepBack();
+
+    uint32 getFrameCount() { return frameCount; }
+    uint32 getMemoryUsed() { return bytesStored; }
+
+private:
+    struct Frame
+    {
+        uint32 offset;
+        uint32 size;
+
+        // Index of the keyframe this is a delta against, keyframes point to themselves
+        uint32 keyframe;
+    };
+
+    // Ring of stored snapshot bytes, each frame is contiguous
+    uint8* data;
+    uint32 dataSize;
+    uint32 dataHead;
+    uint32 bytesStored;
+
+    // Ring of frames, oldest first
+    Frame* frames;
+    uint32 maxFrames;
+    uint32 oldestFrame;
+    uint32 frameCount;
+
+    uint32 keyframeInterval;
+    uint32 framesSinceKeyframe;
+
+    uint32 stateSize;
+    uint32 scratchSize;
+    uint8* captureBuffer;
+    uint8* deltaBuffer;
+    uint8* decodeBuffer;
+
+    uint32 newestFrame() { return (oldestFrame + frameCount - 1) % maxFrames; }
+
+    uint32 encodeDelta(const uint8* keyframe, const uint8* state);
+    void decodeFrame(uint32 index);
+
+    // Drops the oldest frame, along with any deltas that depended on it
+    void evictOldest();
+
+    // Finds room for a new frame, dropping old ones as needed. Fails rather than evict the given keyframe.
+    bool allocate(uint32 size, uint32 keepKeyframe, uint32* offset);
+};
@@ -0,0 +1,226 @@
+#include "romStore.h"
+#include "tileCache.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const uint32 INES_MAGIC = 0x1a53454e; // "NES" followed by MS-DOS end-of-file
+const uint32 NSF_MAGIC = 0x4d53454e;  // "NESM", followed by MS-DOS end-of-file
+const uint32 INES_HEADER_SIZE = 16;
+const uint32 NSF_HEADER_SIZE = 128;
+const uint32 TRAINER_SIZE = 512;
+
+// Maps the whole file read only, the view stays valid after the file itself is closed
+static const uint8* mapFile(const char* path, uint32* size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = 0;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && fileSize.HighPart == 0)
+    {
+        mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    }
+
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return 0;
+    }
+
+    const uint8* data = (const uint8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    *size = fileSize.LowPart;
+    return data;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        return 0;
+    }
+
+    struct stat fileInfo;
+    void* data = MAP_FAILED;
+    if (fstat(file, &fileInfo) == 0 && fileInfo.st_size > 0 && fileInfo.st_size <= 0xFFFFFFFF)
+    {
+        data = mmap(0, fileInfo.st_size, PROT_READ, MAP_SHARED, file, 0);
+    }
+
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    *size = (uint32)fileInfo.st_size;
+    return (const uint8*)data;
+#endif
+}
+
+// Only called once the header has been validated, so the chr rom is known to be in the file
+static void decodeChrRom(RomImage* image)
+{
+    const uint8* header = image->data;
+    uint32 chrSize = header[5] * kilobytes(8);
+    if (chrSize == 0)
+    {
+        return;
+    }
+
+    uint32 chrOffset = INES_HEADER_SIZE + (header[4] * kilobytes(16));
+    if (header[6] & 0x04)
+    {
+        chrOffset += TRAINER_SIZE;
+    }
+
+    uint8* tiles = new uint8[chrSize * 4];
+    TileCache::decodeTiles(image->data + chrOffset, chrSize, tiles);
+    image->chrTiles = tiles;
+}
+
+static void unmapFile(const uint8* data, uint32 size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap((void*)data, size);
+#endif
+}
+
+const RomImage* RomStore::acquire(const char* path)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    for (RomImage* image = images; image; image = image->next)
+    {
+        if (strcmp(image->path, path) == 0)
+        {
+            ++image->references;
+            return image;
+        }
+    }
+
+    uint32 pathLength = (uint32)strlen(path);
+    if (pathLength >= sizeof(RomImage::path))
+    {
+        logError("Rom path is too long: %s\n", path);
+        return 0;
+    }
+
+    RomImage* image = new RomImage();
+    memcpy(image->path, path, pathLength + 1);
+
+    image->data = mapFile(path, &image->size);
+    if (!image->data)
+    {
+        logError("Failed to map rom file %s\n", path);
+        delete image;
+        return 0;
+    }
+
+    if (!validate(image))
+    {
+        unmapFile(image->data, image->size);
+        delete image;
+        return 0;
+    }
+
+    if (image->format == ROM_INES)
+    {
+        decodeChrRom(image);
+    }
+
+    // Only needs to tell files apart not be secure
+    image->hash = 2166136261;
+    for (uint32 i = 0; i < image->size; ++i)
+    {
+        image->hash = (image->hash ^ image->data[i]) * 16777619;
+    }
+
+    image->references = 1;
+    image->next = images;
+    images = image;
+    ++imageCount;
+
+    return image;
+}
+
+void RomStore::release(const RomImage* released)
+{
+    if (!released)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    RomImage** link = &images;
+    while (*link && *link != released)
+    {
+        link = &(*link)->next;
+    }
+
+    RomImage* image = *link;
+    if (!image || --image->references > 0)
+    {
+        return;
+    }
+
+    *link = image->next;
+    --imageCount;
+
+    unmapFile(image->data, image->size);
+    delete[] image->chrTiles;
+    delete image;
+}
+
+bool RomStore::validate(RomImage* image)
+{
+    uint32 magic = 0;
+    if (image->size >= sizeof(magic))
+    {
+        memcpy(&magic, image->data, sizeof(magic));
+    }
+
+    if (magic == NSF_MAGIC && image->size > NSF_HEADER_SIZE)
+    {
+        image->format = ROM_NSF;
+        return true;
+    }
+
+    if (magic == INES_MAGIC && image->size >= INES_HEADER_SIZE)
+    {
+        // Make sure all of the banks the header claims are actually in the file
+        const uint8* header = image->data;
+        uint32 expectedSize = INES_HEADER_SIZE + (header[4] * kilobytes(16)) + (header[5] * kilobytes(8));
+        if (header[6] & 0x04)
+        {
+            expectedSize += TRAINER_SIZE;
+        }
+
+        if (image->size < expectedSize)
+        {
+            logError("Rom is truncated, expected %u bytes but found %u: %s\n", expectedSize, image->size, image->path);
+            return false;
+        }
+
+        image->format = ROM_INES;
+        return true;
+    }
+
+    logError("Not an iNES or NSF file: %s\n", image->path);
+    return false;
+}
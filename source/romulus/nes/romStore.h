@@ -0,0 +1,52 @@
+#pragma once
+#include "romulus.h"
+#include <mutex>
+
+enum RomFormat
+{
+    ROM_INES,
+    ROM_NSF
+};
+
+// A rom file mapped read only into memory. Everything in here is shared between every cartridge using it,
+// so prg and chr rom point straight into the file rather than being copied out per console.
+struct RomImage
+{
+    const uint8* data;
+    uint32 size;
+    RomFormat format;
+
+    // FNV-1a of the whole file, used to tell roms apart (ex: save states)
+    uint32 hash;
+
+    // Chr rom decoded to a palette index per pixel (see TileCache), 4x the size of the chr rom, so it's done once
+    // here instead of by every console. Null if the rom has none
+    const uint8* chrTiles;
+
+    // Bookkeeping for the store
+    char path[512];
+    uint32 references;
+    RomImage* next;
+};
+
+// Maps each rom file once and hands the same image out to every cartridge that loads it.
+// The header is checked when the file is first mapped, so a bad or truncated file fails up front.
+// Safe to share between consoles running on different threads.
+// Images are unmapped as soon as nothing is using them, so anything that's going to load the same rom
+// over and over (ex: batch runs) should hold on to its own reference for the duration.
+class RomStore
+{
+public:
+    // Returns null if the file can't be mapped or isn't a rom we know how to load
+    const RomImage* acquire(const char* path);
+    void release(const RomImage* image);
+
+    uint32 getImageCount() { return imageCount; }
+
+private:
+    std::mutex lock;
+    RomImage* images = 0;
+    uint32 imageCount = 0;
+
+    bool validate(RomImage* image);
+};
@@ -0,0 +1,52 @@
+#include "scheduler.h"
+
+void Scheduler::connect(MOS6502<CPUBus>* cpu, PPU<PPUBus>* ppu, APU* apu, Cartridge* cart)
+{
+    this->cpu = cpu;
+    this->ppu = ppu;
+    this->apu = apu;
+    this->cart = cart;
+}
+
+void Scheduler::reset()
+{
+    ppuDotsOwed = 0;
+    lockstep = cart->hasPPUClockedIrq();
+    ppuDotsUntilEvent = lockstep ? 1 : ppu->dotsUntilVBlank();
+}
+
+void Scheduler::syncPPU()
+{
+    ppuDotsRun += ppuDotsOwed;
+
+    while (ppuDotsOwed > 0)
+    {
+        // Interrupt lines can't change in the middle of a visible line, so checking them after the whole thing is the same
+        uint32 batchSize = (scanlineRendering && !lockstep) ? ppu->getScanlineBatchSize() : 0;
+        if (batchSize > 0 && batchSize <= ppuDotsOwed)
+        {
+            ppuDotsOwed -= ppu->renderScanline();
+        }
+        else
+        {
+            ppu->tick();
+            --ppuDotsOwed;
+        }
+
+        // Gather up all the potenial interrupt sources to assert the right status in the cpu
+        cpu->setIRQ(apu->isFrameInteruptFlagSet
+            || apu->dmc.isInterruptFlagSet
+            || cart->isIrqPending());
+
+        if (ppu->isNMISuppressed())
+        {
+            cpu->forceClearNMI();
+        }
+        else
+        {
+            cpu->setNMI(ppu->isNMIFlagSet());
+        }
+    }
+
+    ppuDotsUntilEvent = lockstep ? 1 : ppu->dotsUntilVBlank();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "romulus.h"
+#include "6502.h"
+#include "ppuBus.h"
+#include "apu/apu.h"
+#include "cartridge.h"
+
+class CPUBus;
+
+// Catch-up scheduler for the ppu
+// The cpu and apu are clocked together like they are on the 2A03, but the ppu is allowed to lag behind.
+// Dots get queued up as the master clock advances and are only run in bulk once something could observe them:
+//  - The cpu touching ppu registers, the controller ports (zapper) or cartridge space (bank switches)
+//  - The next vblank, since that is the only point the ppu can raise an interrupt on its own
+//  - Mappers that clock irqs off of ppu fetches (MMC3) can't be predicted, so those just run in lockstep
+// Running the dots late is exact since nothing they depend on changes without forcing a sync first.
+// That also means any whole visible scanline in the owed dots can be drawn in one go instead of dot by dot.
+class Scheduler
+{
+public:
+    void connect(MOS6502<CPUBus>* cpu, PPU<PPUBus>* ppu, APU* apu, Cartridge* cart);
+
+    // Drops any owed dots and recalculates deadlines for the loaded cartridge
+    void reset();
+
+    // Queues up dots that have happened on the master clock but haven't been simulated yet
+    void addPPUDots(uint32 count) { ppuDotsOwed += count; }
+
+    // Called before each cpu cycle, catches the ppu up if an interrupt could have been raised in the owed dots
+    void beforeCpuCycle()
+    {
+        if (ppuDotsOwed >= ppuDotsUntilEvent)
+        {
+            syncPPU();
+        }
+    }
+
+    // Runs all owed dots so the ppu is current with the cpu
+    void syncPPU();
+
+    // The cpu just changed something the ppu interrupt logic depends on,
+    // so run the next set of dots before the cpu gets to tick again
+    void requestSync() { ppuDotsUntilEvent = 1; }
+
+    uint32 getPPUDotsOwed() { return ppuDotsOwed; }
+
+    // Draw whole scanlines at once when possible, off forces every dot through PPU::tick for comparison
+    void setScanlineRendering(bool enable) { scanlineRendering = enable; }
+
+    // Lockstep is derived from the cartridge, so only the owed dots and deadline are part of the state
+    void serialize(SaveState* state)
+    {
+        state->value(ppuDotsOwed);
+        state->value(ppuDotsUntilEvent);
+    }
+
+    // Total dots simulated since the scheduler was created, used for throughput stats
+    uint64 getPPUDotsRun() { return ppuDotsRun; }
+
+private:
+    MOS6502<CPUBus>* cpu;
+    PPU<PPUBus>* ppu;
+    APU* apu;
+    Cartridge* cart;
+
+    uint32 ppuDotsOwed;
+    uint64 ppuDotsRun;
+
+    // Deadline in owed dots for the next point the cpu may observe the ppu
+    uint32 ppuDotsUntilEvent;
+
+    // Set for mappers that need the ppu and cpu interleaved every cycle
+    bool lockstep;
+
+    bool scanlineRendering;
+};
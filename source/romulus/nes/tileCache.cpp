@@ -0,0 +1,55 @@
+#include "tileCache.h"
+
+void TileCache::init(const uint8* chrMemory, uint32 size)
+{
+    shutdown();
+
+    chr = chrMemory;
+    tileCount = size / 16;
+    pixels = new uint8[tileCount * 64];
+    isDecoded = new bool[tileCount];
+    invalidateAll();
+}
+
+void TileCache::shutdown()
+{
+    delete[] pixels;
+    delete[] isDecoded;
+
+    chr = 0;
+    tileCount = 0;
+    pixels = 0;
+    isDecoded = 0;
+}
+
+void TileCache::invalidateAll()
+{
+    for (uint32 i = 0; i < tileCount; ++i)
+    {
+        isDecoded[i] = false;
+    }
+}
+
+// https://www.nesdev.org/wiki/PPU_pattern_tables
+// Each row is two bytes 8 apart, bit 7 is the leftmost pixel, the first byte holds bit 0 of the index
+void TileCache::decodeTile(const uint8* pattern, uint8* output)
+{
+    for (int row = 0; row < 8; ++row)
+    {
+        decodeRow(pattern[row], pattern[row + 8], output + (row * 8));
+    }
+}
+
+void TileCache::decode(uint32 tile)
+{
+    decodeTile(chr + (tile * 16), pixels + (tile * 64));
+    isDecoded[tile] = true;
+}
+
+void TileCache::decodeTiles(const uint8* chr, uint32 size, uint8* pixels)
+{
+    for (uint32 tile = 0; tile < size / 16; ++tile)
+    {
+        decodeTile(chr + (tile * 16), pixels + (tile * 64));
+    }
+}
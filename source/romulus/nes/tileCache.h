@@ -0,0 +1,61 @@
+#pragma once
+#include "romulus.h"
+
+// Pattern table tiles decoded to one palette index (0-3) per pixel, so a whole row of a tile can be copied at once
+// instead of shifting the bits out of the two bit planes. Tiles are keyed by where they sit in the cartridge's chr memory,
+// so bank switches never invalidate anything, only writes to chr ram do.
+// Tiles are decoded the first time they're asked for, most roms never touch a lot of their chr.
+// Consoles only keep one of these for chr ram. Chr rom never changes, so it's decoded once per rom image and shared
+// (see RomImage::chrTiles)
+class TileCache
+{
+public:
+    void init(const uint8* chrMemory, uint32 size);
+    void shutdown();
+
+    // Call whenever the byte at offset in chr memory changes
+    void invalidate(uint32 offset) { isDecoded[offset >> 4] = false; }
+    void invalidateAll();
+
+    // Returns the 8 pixels (left to right) of the tile row holding the pattern byte at offset.
+    // Either bit plane's offset gives the same row
+    const uint8* getRow(uint32 offset)
+    {
+        uint32 tile = offset >> 4;
+        if (!isDecoded[tile])
+        {
+            decode(tile);
+        }
+
+        return getDecodedRow(pixels, offset);
+    }
+
+    // Decodes every tile in chr up front, 64 bytes of pixels for each 16 byte tile
+    static void decodeTiles(const uint8* chr, uint32 size, uint8* pixels);
+
+    // Same as getRow, out of tiles that have all been decoded already
+    static const uint8* getDecodedRow(const uint8* pixels, uint32 offset)
+    {
+        return pixels + ((offset >> 4) * 64) + ((offset & 0x07) * 8);
+    }
+
+    // Decodes one row from its two bit plane bytes into 8 pixels
+    static void decodeRow(uint8 lo, uint8 hi, uint8* output)
+    {
+        for (int bit = 7; bit >= 0; --bit)
+        {
+            *output++ = ((lo >> bit) & BIT_0) | (((hi >> bit) & BIT_0) << 1);
+        }
+    }
+
+private:
+    const uint8* chr;
+    uint32 tileCount;
+
+    // 64 bytes per tile, 8 rows of 8 pixels
+    uint8* pixels;
+    bool* isDecoded;
+
+    void decode(uint32 tile);
+    static void decodeTile(const uint8* pattern, uint8* output);
+};
@@ -0,0 +1,238 @@
+#include "videoCapture.h"
+
+#include <string.h>
+#include <errno.h>
+
+// Each run is a byte with the palette index in the low 6 bits and the length in the top 2:
+// 0-2 are runs of 1-3, and 3 means the length is in the next byte (4-259)
+const uint32 SHORT_RUN_MAX = 3;
+const uint32 LONG_RUN_MIN = 4;
+const uint32 LONG_RUN_MAX = LONG_RUN_MIN + 255;
+
+uint32 encodeVideoRuns(const uint8* indices, uint32 count, uint8* output)
+{
+    uint8* start = output;
+
+    uint32 i = 0;
+    while (i < count)
+    {
+        uint8 value = indices[i] & 0x3F;
+        uint32 run = 1;
+        while (i + run < count && (indices[i + run] & 0x3F) == value && run < LONG_RUN_MAX)
+        {
+            ++run;
+        }
+
+        if (run <= SHORT_RUN_MAX)
+        {
+            *output++ = (uint8)(((run - 1) << 6) | value);
+        }
+        else
+        {
+            *output++ = (uint8)(0xC0 | value);
+            *output++ = (uint8)(run - LONG_RUN_MIN);
+        }
+
+        i += run;
+    }
+
+    return (uint32)(output - start);
+}
+
+bool decodeVideoRuns(const uint8* runs, uint32 size, uint8* indices, uint32 count)
+{
+    uint32 in = 0;
+    uint32 out = 0;
+    while (in < size)
+    {
+        uint8 value = runs[in] & 0x3F;
+        uint32 run = (runs[in] >> 6) + 1;
+        ++in;
+
+        if (run > SHORT_RUN_MAX)
+        {
+            if (in >= size)
+            {
+                return false;
+            }
+
+            run = runs[in++] + LONG_RUN_MIN;
+        }
+
+        if (out + run > count)
+        {
+            return false;
+        }
+
+        memset(indices + out, value, run);
+        out += run;
+    }
+
+    return out == count;
+}
+
+bool VideoCapture::open(const char* path)
+{
+    if (isOpen())
+    {
+        logError("Video capture is already open, close it before starting %s\n", path);
+        return false;
+    }
+
+    file = fopen(path, "wb");
+    if (!file)
+    {
+        logError("Failed to open %s for writing: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    header = {};
+    header.magic = VIDEO_CAPTURE_MAGIC;
+    header.version = VIDEO_CAPTURE_VERSION;
+    header.width = NES_SCREEN_WIDTH;
+    header.height = NES_SCREEN_HEIGHT;
+    fwrite(&header, sizeof(header), 1, file);
+
+    slots = new uint8[FRAME_SLOTS * VIDEO_FRAME_SIZE];
+    readSlot = 0;
+    writeSlot = 0;
+    queuedSlots = 0;
+    skippedFrames = 0;
+
+    // Doesn't match any frame number, so the first update always captures whatever is on screen
+    lastFrameNumber = 0xFFFFFFFF;
+
+    previousFrame = new uint8[VIDEO_FRAME_SIZE];
+    scratch = new uint8[VIDEO_FRAME_SIZE];
+    encoded = new uint8[VIDEO_FRAME_SIZE * 2];
+    framesSinceKey = 0;
+
+    isClosing = false;
+    writer = std::thread(&VideoCapture::writerLoop, this);
+
+    return true;
+}
+
+void VideoCapture::update(const uint8* frame, uint32 frameNumber)
+{
+    if (!isOpen() || frameNumber == lastFrameNumber)
+    {
+        return;
+    }
+
+    lastFrameNumber = frameNumber;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (queuedSlots == FRAME_SLOTS)
+        {
+            ++skippedFrames;
+            return;
+        }
+    }
+
+    // The writer never touches a slot until it's been queued, so the copy doesn't need the lock
+    memcpy(slots + (writeSlot * VIDEO_FRAME_SIZE), frame, VIDEO_FRAME_SIZE);
+    slotFrameNumbers[writeSlot] = frameNumber;
+    writeSlot = (writeSlot + 1) % FRAME_SLOTS;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        ++queuedSlots;
+    }
+
+    wake.notify_all();
+}
+
+uint32 VideoCapture::close()
+{
+    if (!isOpen())
+    {
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        isClosing = true;
+    }
+
+    wake.notify_all();
+    writer.join();
+
+    // Now that the count is known
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    file = 0;
+
+    delete[] slots;
+    delete[] previousFrame;
+    delete[] scratch;
+    delete[] encoded;
+    slots = 0;
+    previousFrame = 0;
+    scratch = 0;
+    encoded = 0;
+
+    if (skippedFrames > 0)
+    {
+        logWarn("Video capture fell behind and skipped %u frames\n", skippedFrames);
+    }
+
+    return skippedFrames;
+}
+
+void VideoCapture::writerLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        // Finishes off everything queued before stopping
+        wake.wait(guard, [this] { return queuedSlots > 0 || isClosing; });
+        if (queuedSlots == 0)
+        {
+            return;
+        }
+
+        guard.unlock();
+        writeFrame(slots + (readSlot * VIDEO_FRAME_SIZE), slotFrameNumbers[readSlot]);
+        readSlot = (readSlot + 1) % FRAME_SLOTS;
+        guard.lock();
+
+        --queuedSlots;
+    }
+}
+
+void VideoCapture::writeFrame(const uint8* frame, uint32 frameNumber)
+{
+    VideoFrameHeader frameHeader = {};
+    frameHeader.frameNumber = frameNumber;
+    frameHeader.type = VIDEO_KEY_FRAME;
+    frameHeader.size = encodeVideoRuns(frame, VIDEO_FRAME_SIZE, encoded);
+    uint8* runs = encoded;
+
+    // Most frames barely change, but a scene cut can be smaller as a key frame
+    if (header.frameCount > 0 && framesSinceKey < KEY_FRAME_INTERVAL)
+    {
+        for (uint32 i = 0; i < VIDEO_FRAME_SIZE; ++i)
+        {
+            scratch[i] = (frame[i] ^ previousFrame[i]) & 0x3F;
+        }
+
+        uint8* deltaRuns = encoded + VIDEO_FRAME_SIZE;
+        uint32 deltaSize = encodeVideoRuns(scratch, VIDEO_FRAME_SIZE, deltaRuns);
+        if (deltaSize < frameHeader.size)
+        {
+            frameHeader.type = VIDEO_DELTA_FRAME;
+            frameHeader.size = deltaSize;
+            runs = deltaRuns;
+        }
+    }
+
+    framesSinceKey = frameHeader.type == VIDEO_KEY_FRAME ? 0 : framesSinceKey + 1;
+    memcpy(previousFrame, frame, VIDEO_FRAME_SIZE);
+
+    fwrite(&frameHeader, sizeof(frameHeader), 1, file);
+    fwrite(runs, 1, frameHeader.size, file);
+    ++header.frameCount;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "romulus.h"
+#include "ppu/ppu.h"
+
+#include <stdio.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+// Capture files are a header followed by every frame, each with its own header and compressed palette indices.
+// Key frames are the frame's indices run length encoded, delta frames are the runs of the frame xor'd with the one
+// before it (so anything that didn't change is one long run of 0s). See romulus-videodecode for turning them back into rgb.
+const uint32 VIDEO_CAPTURE_MAGIC = fourCC('R', 'M', 'V', 'C');
+const uint16 VIDEO_CAPTURE_VERSION = 1;
+const uint32 VIDEO_FRAME_SIZE = NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT;
+
+enum VideoFrameType
+{
+    VIDEO_KEY_FRAME,
+    VIDEO_DELTA_FRAME
+};
+
+#pragma pack(push, 1)
+struct VideoCaptureHeader
+{
+    uint32 magic;
+    uint16 version;
+    uint16 width;
+    uint16 height;
+    uint32 frameCount;
+};
+
+struct VideoFrameHeader
+{
+    // The ppu's frame count. Frames that went by without being captured (ex: two finished in one update) leave a gap
+    uint32 frameNumber;
+    uint8 type;
+    uint32 size;
+};
+#pragma pack(pop)
+
+// A frame's palette indices, run length encoded 6 bits at a time. The output never needs more than count bytes
+uint32 encodeVideoRuns(const uint8* indices, uint32 count, uint8* output);
+
+// Returns false if the runs don't exactly fill count indices
+bool decodeVideoRuns(const uint8* runs, uint32 size, uint8* indices, uint32 count);
+
+// Streams every finished frame out to a file
+// The console thread just copies the frame into a free slot, the compressing and writing is done by a thread of its own.
+// If it falls behind far enough to run out of slots the frame is skipped rather than holding up emulation.
+class VideoCapture
+{
+public:
+    static const uint32 FRAME_SLOTS = 8;
+
+    // Always a key frame at least this often, so a damaged file can pick back up
+    static const uint32 KEY_FRAME_INTERVAL = 600;
+
+    // Joins the writer thread if the capture is still open, so a console torn down early still leaves a finished file
+    ~VideoCapture() { close(); }
+
+    bool open(const char* path);
+    bool isOpen() { return file != 0; }
+
+    // Queues the frame if it's one that hasn't been seen yet
+    void update(const uint8* frame, uint32 frameNumber);
+
+    // Writes out the queued frames and waits for the writer to finish. Returns the number of frames that had to be skipped
+    uint32 close();
+
+private:
+    FILE* file = 0;
+    VideoCaptureHeader header = {};
+    uint32 lastFrameNumber = 0;
+    uint32 skippedFrames = 0;
+
+    // Slots between the read and write positions are waiting on the writer, the rest belong to the console thread
+    uint8* slots = 0;
+    uint32 slotFrameNumbers[FRAME_SLOTS] = {};
+    uint32 readSlot = 0;
+    uint32 writeSlot = 0;
+    uint32 queuedSlots = 0;
+
+    // Only touched by the writer
+    uint8* previousFrame = 0;
+    uint8* scratch = 0;
+    uint8* encoded = 0;
+    uint32 framesSinceKey = 0;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread writer;
+    bool isClosing = false;
+
+    void writerLoop();
+    void writeFrame(const uint8* frame, uint32 frameNumber);
+};
@@ -33,8 +33,12 @@ typedef double real64;
      (uint32)((uint8)(C) << 16) | (uint32)((uint8)(D) << 24))
 
 #ifndef FINAL
-// TODO: This may be compiler dependant, if it is look at more general ways to manually breakpoint
-#define assert(expression) if(!(expression)) { __debugbreak(); }
+#ifdef _MSC_VER
+#define debugBreak() __debugbreak()
+#else
+#define debugBreak() __builtin_trap()
+#endif
+#define assert(expression) if(!(expression)) { debugBreak(); }
 #else
 #define assert(expression)
 #endif
@@ -149,10 +153,18 @@ struct InputState
 
 // Functions that the emulator exposes to the platform side
 
+// One emulated console. Each owns all of its own state, so any number of them can run side by side,
+// including on different threads as long as a given console is only used from one thread at a time
+struct Console;
+
+Console* createConsole();
+// Shuts the console down (battery saves included) and frees it
+void destroyConsole(Console* console);
+
 // Simulates forward by the given amount and renders whatever the end result was
-void updateAndRender(InputState* input, ScreenBuffer screen);
+void updateAndRender(Console* console, InputState* input, ScreenBuffer screen);
 // Copies the amount of audio requested from the currently playing sources
-void outputAudio(int16* buffer, int numSamples);
+void outputAudio(Console* console, int16* buffer, int numSamples);
 
 // Menu Commands and the like
 // 
@@ -161,15 +173,15 @@ void outputAudio(int16* buffer, int numSamples);
 
 // Detects the file type, loads the appropriate emulator, and starts it
 // TODO: May want a facility to not start immediately
-bool loadROM(const char* filePath);
-void unloadROM();
+bool loadROM(Console* console, const char* filePath);
+void unloadROM(Console* console);
 
 // Triggers the equivalent of hitting the reset button on the given console
 // TODO: Decide what to do if that doesn't exist. Maybe just a hard reboot to the loaded rom
-void consoleReset();
+void consoleReset(Console* console);
 
 // Shuts down the running console and does any last minute battery saves
-void consoleShutdown();
+void consoleShutdown(Console* console);
 
 // TODO: clean this up. I'm not a fan of it 
 enum InputType
@@ -179,5 +191,5 @@ enum InputType
     SOURCE_ZAPPER
 };
 
-InputType getMapping(int port);
-void setMapping(int port, InputType type);
+InputType getMapping(Console* console, int port);
+void setMapping(Console* console, int port, InputType type);
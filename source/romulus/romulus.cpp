@@ -2,12 +2,28 @@
 #include "nes/nes.h"
 #include "nes/input/inputBus.h"
 
-// TODO: Allocate this properly
-static NES nes;
-
 // NOTE: for now all of these things are forwarded to the NES enumlator
 // But having the application be a higher layer up will let other backends be
 // used as they come online
+struct Console
+{
+    NES nes;
+};
+
+Console* createConsole()
+{
+    // Too big for the stack, and value initialized so every register starts out zeroed
+    return new Console();
+}
+
+void destroyConsole(Console* console)
+{
+    if (console)
+    {
+        console->nes.shutdown();
+        delete console;
+    }
+}
 
 void DEBUG_renderMouse(InputState* input, ScreenBuffer screen)
 {
@@ -46,8 +62,10 @@ void DEBUG_renderMouse(InputState* input, ScreenBuffer screen)
     }
 }
 
-void updateAndRender(InputState* input, ScreenBuffer screen)
+void updateAndRender(Console* console, InputState* input, ScreenBuffer screen)
 {
+    NES& nes = console->nes;
+
     // TODO: Handle Mouse for any custom UI that might be useful later
     nes.processInput(input);
     nes.update(input->elapsedMs);
@@ -58,36 +76,37 @@ void updateAndRender(InputState* input, ScreenBuffer screen)
     // TODO: Memory/debugging view
 }
 
-bool loadROM(const char* filePath)
+bool loadROM(Console* console, const char* filePath)
 {
-    return nes.loadRom(filePath);
+    return console->nes.loadRom(filePath);
 }
 
-void unloadROM()
+void unloadROM(Console* console)
 {
-    nes.unloadRom();
+    console->nes.unloadRom();
 }
 
-void consoleReset()
+void consoleReset(Console* console)
 {
-    nes.reset();
+    console->nes.reset();
 }
 
-void outputAudio(int16* buffer, int numSamples)
+void outputAudio(Console* console, int16* buffer, int numSamples)
 {
-    nes.outputAudio(buffer, numSamples);
+    console->nes.outputAudio(buffer, numSamples);
 }
 
-void consoleShutdown()
+void consoleShutdown(Console* console)
 {
-    if (nes.isRunning)
+    if (console->nes.isRunning)
     {
-        nes.powerOff();
+        console->nes.powerOff();
     }
 }
 
-InputType getMapping(int port)
+InputType getMapping(Console* console, int port)
 {
+    NES& nes = console->nes;
     Port p = nes.inputBus.ports[port];
     if (p.device == ZAPPER)
     {
@@ -102,8 +121,9 @@ InputType getMapping(int port)
     return InputType::SOURCE_GAMEPAD;
 }
 
-void setMapping(int port, InputType type)
+void setMapping(Console* console, int port, InputType type)
 {
+    NES& nes = console->nes;
     if (type == SOURCE_ZAPPER)
     {
         nes.inputBus.ports[port].device = ZAPPER;
@@ -123,14 +143,19 @@ void setMapping(int port, InputType type)
 }
 
 // Evrything here is debug so definitely some platform specifics that should get pulled out
+#ifdef _MSC_VER
 #include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 
 // Only go 64 layers deep on timers, avoid recursion
 // TODO: Make this system more robust, Can use aggregation for repeat runs through blocks and the like
 // The perf monitoring in visual studio leaves a lot to be desired. only gives some rough "relative" metrics
 // so I want something specific. Probably make this more of a tree than a stack. works for general use for now
-static TimerBlock timerStack[64];
-static uint32 timerCount = 0;
+// Each thread gets its own stack so consoles running in parallel can time themselves
+static thread_local TimerBlock timerStack[64];
+static thread_local uint32 timerCount = 0;
 
 // NOTE: Timers are an area where you can use object constructor destructor pairs with scopes to
 // get possible wins, but begin end function pairs feels a bit better because its explicit
@@ -145,5 +170,5 @@ void endTimer()
 {
     --timerCount;
     uint64 cycleCount = __rdtsc() - timerStack[timerCount].cycleCount;
-    logInfo("[DBG] %s took %I64u\n", timerStack[timerCount].name, cycleCount);
+    logInfo("[DBG] %s took %llu\n", timerStack[timerCount].name, cycleCount);
 }
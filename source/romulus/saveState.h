@@ -0,0 +1,151 @@
+#pragma once
+#include "romulus.h"
+#include <string.h>
+
+// Walks a save state buffer in either direction so each component only has to list its state once.
+// Everything goes in order at a fixed size, so the layout only changes when the code listing it does.
+// Values are copied as they sit in memory (little endian on everything we target) and pointers are
+// stored as offsets from a known base, so a state doesn't depend on where anything was allocated.
+class SaveState
+{
+public:
+    // Passing a null buffer just counts the bytes that would be written
+    void beginWrite(uint8* buffer, uint32 size)
+    {
+        memory = buffer;
+        capacity = size;
+        cursor = 0;
+        loading = false;
+        validating = false;
+        failed = false;
+    }
+
+    void beginRead(const uint8* buffer, uint32 size)
+    {
+        memory = (uint8*)buffer;
+        capacity = size;
+        cursor = 0;
+        loading = true;
+        validating = false;
+        failed = false;
+    }
+
+    // Goes through the buffer checking everything a read would, without changing anything.
+    // A buffer that passes can then be read without failing part way through
+    void beginValidate(const uint8* buffer, uint32 size)
+    {
+        beginRead(buffer, size);
+        validating = true;
+    }
+
+    // Whether values are being restored from the buffer (not while validating)
+    bool isLoading() { return loading && !validating; }
+
+    // Set if the buffer ran out or a value was out of range, nothing gets read or written after that
+    bool hasFailed() { return failed; }
+    void fail() { failed = true; }
+
+    uint32 getSize() { return cursor; }
+
+    void bytes(void* data, uint32 size) { transfer(data, size, false); }
+
+    template <class T>
+    void value(T& data) { bytes(&data, sizeof(T)); }
+
+    // bools are compiler dependant in size, so they always get one byte
+    void value(bool& data)
+    {
+        uint8 raw = data ? 1 : 0;
+        bytes(&raw, 1);
+        if (isLoading())
+        {
+            data = raw != 0;
+        }
+    }
+
+    // Anything loaded past the last valid value fails the load
+    template <class T>
+    void enumValue(T& data, T last)
+    {
+        uint32 raw = (uint32)data;
+        transfer(&raw, sizeof(raw), true);
+
+        if (loading && raw > (uint32)last)
+        {
+            failed = true;
+        }
+        else if (isLoading())
+        {
+            data = (T)raw;
+        }
+    }
+
+    // For values that aren't restored but have to be the same to load (ex: the version), fails the load if they differ
+    template <class T>
+    void match(T expected)
+    {
+        T stored = expected;
+        transfer(&stored, sizeof(T), true);
+
+        if (loading && stored != expected)
+        {
+            failed = true;
+        }
+    }
+
+    // Stores a pointer to a size byte block inside [base, base + limit) as an offset from base.
+    // Anything loaded that doesn't fit fails the load
+    void pointer(uint8*& data, uint8* base, uint32 limit, uint32 size)
+    {
+        const uint32 nullOffset = 0xFFFFFFFF;
+
+        uint32 offset = data ? (uint32)(data - base) : nullOffset;
+        transfer(&offset, sizeof(offset), true);
+
+        if (!loading || failed)
+        {
+            return;
+        }
+
+        if (offset != nullOffset && (offset > limit || size > limit - offset))
+        {
+            failed = true;
+        }
+        else if (isLoading())
+        {
+            data = offset == nullOffset ? 0 : base + offset;
+        }
+    }
+
+private:
+    uint8* memory;
+    uint32 capacity;
+    uint32 cursor;
+    bool loading;
+    bool validating;
+    bool failed;
+
+    // Values that are only read to be checked still come out of the buffer while validating, the caller keeps them local
+    void transfer(void* data, uint32 size, bool isCheckedValue)
+    {
+        if (failed || (memory && cursor + size > capacity))
+        {
+            failed = true;
+            return;
+        }
+
+        if (memory)
+        {
+            if (!loading)
+            {
+                memcpy(memory + cursor, data, size);
+            }
+            else if (!validating || isCheckedValue)
+            {
+                memcpy(data, memory + cursor, size);
+            }
+        }
+
+        cursor += size;
+    }
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include "romulus.h"
+#include <string.h>
+
+// Builds a 64 bit hash of the console's state a piece at a time, the same way SaveState walks it.
+// It's for telling whether two runs have gone different ways, not for security, so it's built for speed:
+// 32 bytes at a time split over 4 independent lanes (the same rounds as xxHash64) so the multiplies
+// overlap instead of each one waiting on the last. A frame's worth of state takes a few microseconds.
+class StateHash
+{
+public:
+    void begin()
+    {
+        lanes[0] = PRIME_1 + PRIME_2;
+        lanes[1] = PRIME_2;
+        lanes[2] = 0;
+        lanes[3] = 0 - PRIME_1;
+        length = 0;
+    }
+
+    void bytes(const void* data, uint32 size)
+    {
+        const uint8* input = (const uint8*)data;
+        length += size;
+
+        while (size >= 32)
+        {
+            lanes[0] = round(lanes[0], read64(input));
+            lanes[1] = round(lanes[1], read64(input + 8));
+            lanes[2] = round(lanes[2], read64(input + 16));
+            lanes[3] = round(lanes[3], read64(input + 24));
+            input += 32;
+            size -= 32;
+        }
+
+        // Anything left over is small (registers and the like), so it just goes into the first lane
+        while (size >= 8)
+        {
+            lanes[0] = round(lanes[0], read64(input));
+            input += 8;
+            size -= 8;
+        }
+
+        while (size > 0)
+        {
+            lanes[0] = round(lanes[0], *input);
+            ++input;
+            --size;
+        }
+    }
+
+    template <class T>
+    void value(const T& data) { bytes(&data, sizeof(T)); }
+
+    uint64 get()
+    {
+        uint64 hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+        hash += length;
+
+        // Avalanche, so every input bit can flip any output bit
+        hash ^= hash >> 33;
+        hash *= PRIME_2;
+        hash ^= hash >> 29;
+        hash *= PRIME_3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+private:
+    static const uint64 PRIME_1 = 0x9E3779B185EBCA87ull;
+    static const uint64 PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+    static const uint64 PRIME_3 = 0x165667B19E3779F9ull;
+
+    uint64 lanes[4];
+    uint64 length;
+
+    static uint64 rotateLeft(uint64 value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    static uint64 round(uint64 lane, uint64 input)
+    {
+        lane += input * PRIME_2;
+        lane = rotateLeft(lane, 31);
+        return lane * PRIME_1;
+    }
+
+    // Memory isn't necessarily aligned, memcpy compiles down to a plain load
+    static uint64 read64(const uint8* input)
+    {
+        uint64 result;
+        memcpy(&result, input, sizeof(result));
+        return result;
+    }
+};
@@ -1,6 +1,8 @@
 #include "wavefile.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 
 enum WaveFormats
 {
@@ -11,31 +13,14 @@ enum WaveFormats
 	WAVE_EXTENSIBLE = 0xFFFE
 };
 
-#pragma pack(push, 1)
-struct WaveHeader
-{
-	uint32 riffChunkId;
-	uint32 chunkSize;
-	uint32 waveChunkId;
-	uint32 formatChunkId;
-	uint32 formatChunkSize; // 16, 18 or 40 depending on version
-	uint16 format;
-	uint16 numChannels;
-	uint32 samplesPerSecond;
-	uint32 bytesPerSec;
-	uint16 blockAlign;
-	uint16 bitsPerSample;
-	uint32 dataChunkId;
-	uint32 dataChunkSize;
-};
-#pragma pack(pop)
-
-FILE* fileHandle;
-WaveHeader header;
-
-void openStream(const char* filename, uint16 numChannels, uint32 samplesPerSecond)
+bool WaveFile::openStream(const char* filename, uint16 numChannels, uint32 samplesPerSecond)
 {
 	fileHandle = fopen(filename, "wb");
+	if (!fileHandle)
+	{
+		logError("Failed to open %s for writing: %s\n", filename, strerror(errno));
+		return false;
+	}
 
 	header = {};
 	header.riffChunkId = fourCC('R', 'I', 'F', 'F');
@@ -54,20 +39,32 @@ void openStream(const char* filename, uint16 numChannels, uint32 samplesPerSecon
 	header.dataChunkId = fourCC('d', 'a', 't', 'a');
 
 	fwrite(&header, sizeof(WaveHeader), 1, fileHandle);
+	return true;
 }
 
 // Writes the buffer to the file, Direct write so ignores channels
-void write(int16* buffer, uint32 length)
+void WaveFile::write(int16* buffer, uint32 length)
 {
+	if (!fileHandle)
+	{
+		return;
+	}
+
 	fwrite(buffer, sizeof(int16), length, fileHandle);
 	header.dataChunkSize += length * sizeof(int16);
 }
 
 // Update the appropriate sizes and close the file handle
-void finalizeStream()
+void WaveFile::finalizeStream()
 {
+	if (!fileHandle)
+	{
+		return;
+	}
+
 	fseek(fileHandle, 0, SEEK_SET);
 	header.chunkSize = 36 + header.dataChunkSize;
 	fwrite(&header, sizeof(WaveHeader), 1, fileHandle);
 	fclose(fileHandle);
+	fileHandle = 0;
 }
@@ -1,6 +1,35 @@
 #pragma once
 #include "romulus.h"
+#include <stdio.h>
 
-void openStream(const char* filename, uint16 numChannels, uint32 samplesPerSecond);
-void write(int16* buffer, uint32 length);
-void finalizeStream();
+#pragma pack(push, 1)
+struct WaveHeader
+{
+	uint32 riffChunkId;
+	uint32 chunkSize;
+	uint32 waveChunkId;
+	uint32 formatChunkId;
+	uint32 formatChunkSize; // 16, 18 or 40 depending on version
+	uint16 format;
+	uint16 numChannels;
+	uint32 samplesPerSecond;
+	uint32 bytesPerSec;
+	uint16 blockAlign;
+	uint16 bitsPerSample;
+	uint32 dataChunkId;
+	uint32 dataChunkSize;
+};
+#pragma pack(pop)
+
+// Streams 16 bit pcm out to a .wav file. The header gets rewritten with the final sizes once the stream is finalized
+class WaveFile
+{
+public:
+	bool openStream(const char* filename, uint16 numChannels, uint32 samplesPerSecond);
+	void write(int16* buffer, uint32 length);
+	void finalizeStream();
+
+private:
+	FILE* fileHandle = 0;
+	WaveHeader header = {};
+};
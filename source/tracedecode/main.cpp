@@ -0,0 +1,85 @@
+// Turns a cpu trace (see NES::startTrace) back into a text log, a line per instruction
+// ex: romulus-headless test/nestest/nestest.nes 1 --pc C000 --trace run.trace
+//     romulus-tracedecode run.trace run.log && head -n 8991 run.log | diff - test/nestest/nestest.log
+//
+// Lines match nestest.log by default, --fceux writes them the way FCEUX's trace logger does instead.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nes/cpuTrace.h"
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("usage: romulus-tracedecode <trace> <output.log> [--fceux]\n");
+        return 1;
+    }
+
+    bool isNestestLog = !(argc > 3 && strcmp(argv[3], "--fceux") == 0);
+
+    FILE* input = fopen(argv[1], "rb");
+    if (!input)
+    {
+        printf("Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    CPUTraceHeader header = {};
+    if (fread(&header, sizeof(header), 1, input) != 1 || header.magic != CPU_TRACE_MAGIC || header.version != CPU_TRACE_VERSION)
+    {
+        printf("%s isn't a cpu trace this version can read\n", argv[1]);
+        fclose(input);
+        return 1;
+    }
+
+    FILE* output = fopen(argv[2], "wb");
+    if (!output)
+    {
+        printf("Failed to open %s for writing\n", argv[2]);
+        fclose(input);
+        return 1;
+    }
+
+    static TraceRecord records[4096];
+    char line[128];
+
+    uint64 instructions = 0;
+    bool failed = false;
+
+    while (!failed)
+    {
+        size_t count = fread(records, sizeof(TraceRecord), sizeof(records) / sizeof(TraceRecord), input);
+        if (count == 0)
+        {
+            break;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            int32 length = formatTraceRecord(line, &records[i], isNestestLog);
+            if (fwrite(line, 1, length, output) != (size_t)length)
+            {
+                printf("Failed writing to %s\n", argv[2]);
+                failed = true;
+                break;
+            }
+        }
+
+        instructions += count;
+    }
+
+    // A crash can leave half a record on the end
+    long end = ftell(input);
+    if (!failed && end >= 0 && (end - (long)sizeof(header)) % sizeof(TraceRecord) != 0)
+    {
+        printf("Trace ends partway through a record, the rest is ignored\n");
+    }
+
+    fclose(input);
+    fclose(output);
+
+    printf("%llu instructions\n", (unsigned long long)instructions);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+// Expands a video capture (see NES::startVideoCapture) into raw 24 bit rgb frames
+// ex: romulus-videodecode run.rmv run.rgb && ffmpeg -f rawvideo -pixel_format rgb24 -video_size 256x240 -framerate 60 -i run.rgb run.mp4
+//
+// Frames the capture skipped are filled in with the one before, so the output keeps the console's timing.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nes/videoCapture.h"
+#include "nes/constants.h"
+
+static bool writeFrame(FILE* output, const uint8* indices)
+{
+    static uint8 rgb[VIDEO_FRAME_SIZE * 3];
+    for (uint32 i = 0; i < VIDEO_FRAME_SIZE; ++i)
+    {
+        uint32 color = palette[indices[i] & 0x3F];
+        rgb[(i * 3) + 0] = (uint8)(color >> 16);
+        rgb[(i * 3) + 1] = (uint8)(color >> 8);
+        rgb[(i * 3) + 2] = (uint8)color;
+    }
+
+    return fwrite(rgb, sizeof(rgb), 1, output) == 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("usage: romulus-videodecode <capture> <output.rgb>\n");
+        return 1;
+    }
+
+    FILE* input = fopen(argv[1], "rb");
+    if (!input)
+    {
+        printf("Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    VideoCaptureHeader header = {};
+    if (fread(&header, sizeof(header), 1, input) != 1 || header.magic != VIDEO_CAPTURE_MAGIC
+        || header.version != VIDEO_CAPTURE_VERSION || header.width * header.height != VIDEO_FRAME_SIZE)
+    {
+        printf("%s isn't a video capture this version can read\n", argv[1]);
+        fclose(input);
+        return 1;
+    }
+
+    FILE* output = fopen(argv[2], "wb");
+    if (!output)
+    {
+        printf("Failed to open %s for writing\n", argv[2]);
+        fclose(input);
+        return 1;
+    }
+
+    static uint8 runs[VIDEO_FRAME_SIZE * 2];
+    static uint8 frame[VIDEO_FRAME_SIZE];
+    static uint8 delta[VIDEO_FRAME_SIZE];
+
+    uint32 framesWritten = 0;
+    uint32 framesFilled = 0;
+    uint32 lastFrameNumber = 0;
+    uint64 capturedBytes = sizeof(header);
+    bool failed = false;
+
+    for (uint32 i = 0; i < header.frameCount && !failed; ++i)
+    {
+        VideoFrameHeader frameHeader = {};
+        if (fread(&frameHeader, sizeof(frameHeader), 1, input) != 1 || frameHeader.size > sizeof(runs)
+            || fread(runs, 1, frameHeader.size, input) != frameHeader.size)
+        {
+            printf("Capture ends early at frame %u of %u\n", i, header.frameCount);
+            failed = true;
+            break;
+        }
+
+        capturedBytes += sizeof(frameHeader) + frameHeader.size;
+
+        // Repeat the last frame over any gap so the timing holds
+        if (i > 0)
+        {
+            for (uint32 gap = lastFrameNumber + 1; gap < frameHeader.frameNumber; ++gap)
+            {
+                writeFrame(output, frame);
+                ++framesFilled;
+            }
+        }
+
+        if (frameHeader.type == VIDEO_DELTA_FRAME && i > 0)
+        {
+            if (!decodeVideoRuns(runs, frameHeader.size, delta, VIDEO_FRAME_SIZE))
+            {
+                failed = true;
+            }
+
+            for (uint32 p = 0; p < VIDEO_FRAME_SIZE; ++p)
+            {
+                frame[p] ^= delta[p];
+            }
+        }
+        else if (frameHeader.type != VIDEO_KEY_FRAME || !decodeVideoRuns(runs, frameHeader.size, frame, VIDEO_FRAME_SIZE))
+        {
+            failed = true;
+        }
+
+        if (failed)
+        {
+            printf("Frame %u is corrupt\n", frameHeader.frameNumber);
+            break;
+        }
+
+        if (!writeFrame(output, frame))
+        {
+            printf("Failed writing to %s\n", argv[2]);
+            failed = true;
+            break;
+        }
+
+        lastFrameNumber = frameHeader.frameNumber;
+        ++framesWritten;
+    }
+
+    fclose(input);
+    fclose(output);
+
+    uint64 rgbBytes = (uint64)(framesWritten + framesFilled) * VIDEO_FRAME_SIZE * sizeof(uint32);
+    printf("%u frames (%u filled in) from %llu bytes, %.1fx smaller than 32 bit frames\n", framesWritten + framesFilled,
+        framesFilled, (unsigned long long)capturedBytes, capturedBytes > 0 ? (real64)rgbBytes / capturedBytes : 0.0);
+
+    return failed ? 1 : 0;
+}
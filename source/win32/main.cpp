@@ -37,6 +37,9 @@ static bool isRunning = true;
 static GDIBackBuffer globalBackBuffer = {};
 static int64 cpuFreq = 1;
 
+// The one console the window is showing
+static Console* console;
+
 void resizeDIBSection(GDIBackBuffer* buffer, int width, int height)
 {
     if (buffer->memory)
@@ -120,10 +123,10 @@ void RecalculateSettings()
     CheckMenuItem(mainMenu, ID_CONTROLLER2_GAMEPAD, MF_BYCOMMAND | MF_UNCHECKED);
     CheckMenuItem(mainMenu, ID_CONTROLLER2_ZAPPER, MF_BYCOMMAND | MF_UNCHECKED);
 
-    uint8 controller1 = getMapping(0);
+    uint8 controller1 = getMapping(console, 0);
     CheckMenuItem(mainMenu, settingToMenuItem[controller1], MF_BYCOMMAND | MF_CHECKED);
 
-    uint8 controller2 = getMapping(1) + 3;
+    uint8 controller2 = getMapping(console, 1) + 3;
     CheckMenuItem(mainMenu, settingToMenuItem[controller2], MF_BYCOMMAND | MF_CHECKED);
 }
 
@@ -192,7 +195,7 @@ LRESULT windowProc(HWND window, UINT msg, WPARAM wParam, LPARAM lParam)
                         *titleWriter++ = "ROMulus"[i];
                     }
 
-                    if (loadROM(filename))
+                    if (loadROM(console, filename))
                     {
                         EnableMenuItem(mainMenu, MENU_FILE_CLOSE, MF_BYCOMMAND | MF_ENABLED);
                         char* start = filename;
@@ -229,7 +232,7 @@ LRESULT windowProc(HWND window, UINT msg, WPARAM wParam, LPARAM lParam)
             }
             else if (command == MENU_FILE_CLOSE)
             {
-                unloadROM();
+                unloadROM(console);
                 SetWindowTextA(window, "ROMulus");
                 EnableMenuItem(mainMenu, MENU_FILE_CLOSE, MF_BYCOMMAND | MF_GRAYED);
             }
@@ -239,7 +242,7 @@ LRESULT windowProc(HWND window, UINT msg, WPARAM wParam, LPARAM lParam)
             }
             else if (command == MENU_CONSOLE_RESET)
             {
-                consoleReset();
+                consoleReset(console);
             }
             else if (command == MENU_VIDEO_FULLSCREEN)
             {
@@ -259,66 +262,66 @@ LRESULT windowProc(HWND window, UINT msg, WPARAM wParam, LPARAM lParam)
             }
             else if (command == ID_CONTROLLER1_KEYBOARD)
             {
-                setMapping(0, SOURCE_KEYBOARD);
+                setMapping(console, 0, SOURCE_KEYBOARD);
 
-                if (getMapping(1) == SOURCE_KEYBOARD)
+                if (getMapping(console, 1) == SOURCE_KEYBOARD)
                 {
-                    setMapping(1, SOURCE_GAMEPAD);
+                    setMapping(console, 1, SOURCE_GAMEPAD);
                 }
 
                 RecalculateSettings();
             }
             else if (command == ID_CONTROLLER1_GAMEPAD)
             {
-                setMapping(0, SOURCE_GAMEPAD);
+                setMapping(console, 0, SOURCE_GAMEPAD);
 
-                if (getMapping(1) == SOURCE_GAMEPAD)
+                if (getMapping(console, 1) == SOURCE_GAMEPAD)
                 {
-                    setMapping(1, SOURCE_KEYBOARD);
+                    setMapping(console, 1, SOURCE_KEYBOARD);
                 }
 
                 RecalculateSettings();
             }
             else if (command == ID_CONTROLLER1_ZAPPER)
             {
-                setMapping(0, SOURCE_ZAPPER);
+                setMapping(console, 0, SOURCE_ZAPPER);
 
-                if (getMapping(1) == SOURCE_ZAPPER)
+                if (getMapping(console, 1) == SOURCE_ZAPPER)
                 {
-                    setMapping(1, SOURCE_KEYBOARD);
+                    setMapping(console, 1, SOURCE_KEYBOARD);
                 }
 
                 RecalculateSettings();
             }
             else if (command == ID_CONTROLLER2_KEYBOARD)
             {
-                setMapping(1, SOURCE_KEYBOARD);
+                setMapping(console, 1, SOURCE_KEYBOARD);
 
-                if (getMapping(0) == SOURCE_KEYBOARD)
+                if (getMapping(console, 0) == SOURCE_KEYBOARD)
                 {
-                    setMapping(0, SOURCE_GAMEPAD);
+                    setMapping(console, 0, SOURCE_GAMEPAD);
                 }
 
                 RecalculateSettings();
             }
             else if (command == ID_CONTROLLER2_GAMEPAD)
             {
-                setMapping(1, SOURCE_GAMEPAD);
+                setMapping(console, 1, SOURCE_GAMEPAD);
 
-                if (getMapping(0) == SOURCE_GAMEPAD)
+                if (getMapping(console, 0) == SOURCE_GAMEPAD)
                 {
-                    setMapping(0, SOURCE_KEYBOARD);
+                    setMapping(console, 0, SOURCE_KEYBOARD);
                 }
 
                 RecalculateSettings();
             }
             else if (command == ID_CONTROLLER2_ZAPPER)
             {
-                setMapping(1, SOURCE_ZAPPER);
+                setMapping(console, 1, SOURCE_ZAPPER);
 
-                if (getMapping(0) == SOURCE_ZAPPER)
+                if (getMapping(console, 0) == SOURCE_ZAPPER)
                 {
-                    setMapping(0, SOURCE_KEYBOARD);
+                    setMapping(console, 0, SOURCE_KEYBOARD);
                 }
 
                 RecalculateSettings();
@@ -418,6 +421,7 @@ int WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, int showC
 
     InitDirectSound(window, audio.samplesPerSecond, audio.bufferSize);
 
+    console = createConsole();
     RecalculateSettings();
 
     LARGE_INTEGER frameTime = getClockTime();
@@ -499,9 +503,9 @@ int WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, int showC
         screen.memory = globalBackBuffer.memory;
         screen.pitch = globalBackBuffer.pitch;
 
-        updateAndRender(&input, screen);
+        updateAndRender(console, &input, screen);
 
-        UpdateDirectSound(&audio, samples, outputAudio);
+        UpdateDirectSound(&audio, samples, console, outputAudio);
         
         // Sleep until the frame should display for proper frame pacing
         real32 frameElapsed = getSecondsElapsed(frameTime, getClockTime());
@@ -543,6 +547,6 @@ int WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, int showC
         displayTime = getClockTime();
     }
 
-    consoleShutdown();
+    destroyConsole(console);
     return 0;
 }
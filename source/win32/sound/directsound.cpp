@@ -159,7 +159,7 @@ void FillDirectSoundBuffer(AudioData* audio, DWORD startPosition, DWORD size, in
     }
 }
 
-void UpdateDirectSound(AudioData* audioSpec, int16* sampleBuffer, SampleCallback getSamples)
+void UpdateDirectSound(AudioData* audioSpec, int16* sampleBuffer, Console* console, SampleCallback getSamples)
 {
     // Audio output (Initial implementation from another project, will tweak as we go)
     //
@@ -194,7 +194,7 @@ void UpdateDirectSound(AudioData* audioSpec, int16* sampleBuffer, SampleCallback
         // Mix down application audio into a buffer
         // TODO: Pass in a generic audio spec/"device" so we can control things like sample rate
         // and such from the platform side
-        getSamples(sampleBuffer, bytesToWrite / audioSpec->bytesPerSample);
+        getSamples(console, sampleBuffer, bytesToWrite / audioSpec->bytesPerSample);
 
         FillDirectSoundBuffer(audioSpec, byteToLock, bytesToWrite, sampleBuffer);
     }
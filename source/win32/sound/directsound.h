@@ -18,6 +18,6 @@ bool InitDirectSound(HWND window, DWORD samplesPerSecond, DWORD bufferSize);
 void PlayDirectSound();
 void PauseDirectSound();
 
-typedef void (*SampleCallback)(int16*, int);
+typedef void (*SampleCallback)(Console*, int16*, int);
 
-void UpdateDirectSound(AudioData* audioSpec, int16* sampleBuffer, SampleCallback getSamples);
+void UpdateDirectSound(AudioData* audioSpec, int16* sampleBuffer, Console* console, SampleCallback getSamples);